@@ -59,11 +59,14 @@
 */
 
 #include "vsearch.h"
+#include "arena.h"
 #include "maps.h"
+#include <algorithm>  // std::sort
 #include <cstdint>  // int64_t, uint64_t
 #include <cstdio>  // std::printf, std::snprintf
 #include <cstring>  // std::memcpy, std::memmove, std::memset, std::strcpy, std::strlen
 #include <limits>
+#include <vector>
 
 
 /*
@@ -75,7 +78,24 @@
   maximize score
 */
 
+/*
+  On x86_64, this file is also compiled with AVX2 and with AVX-512BW
+  enabled, giving versions aligning 16 and 32 sequences at once
+  instead of 8. Each version is kept in its own namespace, and the
+  search16 functions at the end of the file use the widest version
+  supported by the cpu.
+*/
+
+#if defined(AVX512BW)
+#define ALIGN_SIMD_VARIANT align_simd_avx512bw
+constexpr auto CHANNELS = 32;
+#elif defined(AVX2)
+#define ALIGN_SIMD_VARIANT align_simd_avx2
+constexpr auto CHANNELS = 16;
+#else
+#define ALIGN_SIMD_VARIANT align_simd_128
 constexpr auto CHANNELS = 8;
+#endif
 constexpr auto CDEPTH = 4;
 
 /*
@@ -95,6 +115,8 @@ constexpr auto CDEPTH = 4;
 #include "align_simd.h"
 
 
+namespace ALIGN_SIMD_VARIANT {
+
 constexpr auto MAXSEQLENPRODUCT = 25000000LL;
 
 static int64_t scorematrix[16][16];
@@ -102,16 +124,89 @@ static int64_t scorematrix[16][16];
 /*
   The macros below usually operate on 128-bit vectors of 8 signed
   short 16-bit integers. Additions and subtractions should be
-  saturated.  The shift operation should shift left by 2 bytes (one
-  short int) and shift in zeros. The v_mask_gt operation should
-  compare two vectors of signed shorts and return a 16-bit bitmask
-  with pairs of 2 bits set for each element greater in the first than
-  in the second argument.
+  saturated. The v_mask_gt operation should compare two vectors of
+  signed shorts and return a bitmask (DIRWORD) with DIRBITS bits set
+  for each element greater in the first than in the second argument.
+  The v_eq operation returns a vector with all bits set in the
+  elements that are equal in both arguments, and zero elsewhere.
+
+  The v8 macros operate on vectors of unsigned 8-bit integers, with
+  saturated additions. The v8_match operation returns the third
+  argument in the elements where the nucleotide codes of the first two
+  arguments overlap, and 255 elsewhere.
 */
 
-#ifdef __PPC__
+#if defined(AVX512BW)
+
+using VECTOR_SHORT = __m512i;
+using DIRWORD = unsigned int;
+constexpr auto DIRBITS = 1U;
+
+#define v_load(a) _mm512_load_si512((VECTOR_SHORT *)(a))
+#define v_store(a, b) _mm512_store_si512((VECTOR_SHORT *)(a), (b))
+#define v_add(a, b) _mm512_adds_epi16((a), (b))
+#define v_sub(a, b) _mm512_subs_epi16((a), (b))
+#define v_sub_unsigned(a, b) _mm512_subs_epu16((a), (b))
+#define v_max(a, b) _mm512_max_epi16((a), (b))
+#define v_min(a, b) _mm512_min_epi16((a), (b))
+#define v_dup(a) _mm512_set1_epi16(a)
+#define v_zero v_dup(0)
+#define v_and(a, b) _mm512_and_si512((a), (b))
+#define v_xor(a, b) _mm512_xor_si512((a), (b))
+#define v_eq(a, b) _mm512_movm_epi16(_mm512_cmpeq_epi16_mask((a), (b)))
+#define v_gt(a, b) _mm512_movm_epi16(_mm512_cmpgt_epi16_mask((a), (b)))
+#define v_select(a, b, mask) _mm512_mask_blend_epi16(_mm512_movepi16_mask(mask), (a), (b))
+#define v_mask_gt(a, b) ((DIRWORD) _mm512_cmpgt_epi16_mask((a), (b)))
+
+using VECTOR_BYTE = __m512i;
+
+#define v8_load(a) _mm512_load_si512((VECTOR_BYTE *)(a))
+#define v8_store(a, b) _mm512_store_si512((VECTOR_BYTE *)(a), (b))
+#define v8_add(a, b) _mm512_adds_epu8((a), (b))
+#define v8_min(a, b) _mm512_min_epu8((a), (b))
+#define v8_dup(a) _mm512_set1_epi8((char) (a))
+#define v8_match(a, b, c) _mm512_mask_mov_epi8((c),                     \
+                                               _mm512_testn_epi8_mask((a), (b)), \
+                                               v8_dup(255))
+
+#elif defined(AVX2)
+
+using VECTOR_SHORT = __m256i;
+using DIRWORD = unsigned int;
+constexpr auto DIRBITS = 2U;
+
+#define v_load(a) _mm256_load_si256((VECTOR_SHORT *)(a))
+#define v_store(a, b) _mm256_store_si256((VECTOR_SHORT *)(a), (b))
+#define v_add(a, b) _mm256_adds_epi16((a), (b))
+#define v_sub(a, b) _mm256_subs_epi16((a), (b))
+#define v_sub_unsigned(a, b) _mm256_subs_epu16((a), (b))
+#define v_max(a, b) _mm256_max_epi16((a), (b))
+#define v_min(a, b) _mm256_min_epi16((a), (b))
+#define v_dup(a) _mm256_set1_epi16(a)
+#define v_zero v_dup(0)
+#define v_and(a, b) _mm256_and_si256((a), (b))
+#define v_xor(a, b) _mm256_xor_si256((a), (b))
+#define v_eq(a, b) _mm256_cmpeq_epi16((a), (b))
+#define v_gt(a, b) _mm256_cmpgt_epi16((a), (b))
+#define v_select(a, b, mask) _mm256_blendv_epi8((a), (b), (mask))
+#define v_mask_gt(a, b) ((DIRWORD) _mm256_movemask_epi8(_mm256_cmpgt_epi16((a), (b))))
+
+using VECTOR_BYTE = __m256i;
+
+#define v8_load(a) _mm256_load_si256((VECTOR_BYTE *)(a))
+#define v8_store(a, b) _mm256_store_si256((VECTOR_BYTE *)(a), (b))
+#define v8_add(a, b) _mm256_adds_epu8((a), (b))
+#define v8_min(a, b) _mm256_min_epu8((a), (b))
+#define v8_dup(a) _mm256_set1_epi8((char) (a))
+#define v8_match(a, b, c) _mm256_or_si256((c),                          \
+                                          _mm256_cmpeq_epi8(_mm256_and_si256((a), (b)), \
+                                                            v8_dup(0)))
+
+#elif defined __PPC__
 
 using VECTOR_SHORT = __vector signed short;
+using DIRWORD = unsigned short;
+constexpr auto DIRBITS = 2U;
 
 const __vector unsigned char perm_merge_long_low =
   {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
@@ -121,7 +216,6 @@ const __vector unsigned char perm_merge_long_high =
   {0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
    0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f};
 
-#define v_init(a,b,c,d,e,f,g,h) (const VECTOR_SHORT){a,b,c,d,e,f,g,h}
 #define v_load(a) vec_ld(0, (VECTOR_SHORT *)(a))
 #define v_store(a, b) vec_st((__vector unsigned char)(b), 0,    \
                              (__vector unsigned char *)(a))
@@ -136,16 +230,30 @@ const __vector unsigned char perm_merge_long_high =
 #define v_zero vec_splat_s16(0)
 #define v_and(a, b) vec_and((a), (b))
 #define v_xor(a, b) vec_xor((a), (b))
-#define v_shift_left(a) vec_sld((a), v_zero, 2)
+#define v_eq(a, b) ((VECTOR_SHORT) vec_cmpeq((a), (b)))
+#define v_gt(a, b) ((VECTOR_SHORT) vec_cmpgt((a), (b)))
+#define v_select(a, b, mask) vec_sel((a), (b), (__vector unsigned short)(mask))
+
+using VECTOR_BYTE = __vector unsigned char;
+
+#define v8_load(a) vec_ld(0, (VECTOR_BYTE *)(a))
+#define v8_store(a, b) vec_st((b), 0, (VECTOR_BYTE *)(a))
+#define v8_add(a, b) vec_adds((a), (b))
+#define v8_min(a, b) vec_min((a), (b))
+#define v8_dup(a) vec_splats((unsigned char) (a))
+#define v8_match(a, b, c) vec_or((c),                                   \
+                                 (VECTOR_BYTE) vec_cmpeq(vec_and((a), (b)), \
+                                                         v8_dup(0)))
 
 #elif defined __aarch64__
 
 using VECTOR_SHORT = int16x8_t;
+using DIRWORD = unsigned short;
+constexpr auto DIRBITS = 2U;
 
 const uint16x8_t neon_mask =
   {0x0003, 0x000c, 0x0030, 0x00c0, 0x0300, 0x0c00, 0x3000, 0xc000};
 
-#define v_init(a,b,c,d,e,f,g,h) (const VECTOR_SHORT){a,b,c,d,e,f,g,h}
 #define v_load(a) vld1q_s16((const int16_t *)(a))
 #define v_store(a, b) vst1q_s16((int16_t *)(a), (b))
 #define v_merge_lo_16(a, b) vzip1q_s16((a),(b))
@@ -163,14 +271,26 @@ const uint16x8_t neon_mask =
 #define v_zero v_dup(0)
 #define v_and(a, b) vandq_s16((a), (b))
 #define v_xor(a, b) veorq_s16((a), (b))
-#define v_shift_left(a) vextq_s16((v_zero), (a), 7)
+#define v_eq(a, b) vreinterpretq_s16_u16(vceqq_s16((a), (b)))
+#define v_gt(a, b) vreinterpretq_s16_u16(vcgtq_s16((a), (b)))
+#define v_select(a, b, mask) vbslq_s16(vreinterpretq_u16_s16(mask), (b), (a))
 #define v_mask_gt(a, b) vaddvq_u16(vandq_u16((vcgtq_s16((a), (b))), neon_mask))
 
+using VECTOR_BYTE = uint8x16_t;
+
+#define v8_load(a) vld1q_u8((const uint8_t *)(a))
+#define v8_store(a, b) vst1q_u8((uint8_t *)(a), (b))
+#define v8_add(a, b) vqaddq_u8((a), (b))
+#define v8_min(a, b) vminq_u8((a), (b))
+#define v8_dup(a) vdupq_n_u8(a)
+#define v8_match(a, b, c) vornq_u8((c), vtstq_u8((a), (b)))
+
 #elif defined(__x86_64__) || defined(SIMDE_VERSION)
 
 using VECTOR_SHORT = __m128i;
+using DIRWORD = unsigned short;
+constexpr auto DIRBITS = 2U;
 
-#define v_init(a,b,c,d,e,f,g,h) _mm_set_epi16(h,g,f,e,d,c,b,a)
 #define v_load(a) _mm_load_si128((VECTOR_SHORT *)(a))
 #define v_store(a, b) _mm_store_si128((VECTOR_SHORT *)(a), (b))
 #define v_merge_lo_16(a, b) _mm_unpacklo_epi16((a),(b))
@@ -188,9 +308,23 @@ using VECTOR_SHORT = __m128i;
 #define v_zero v_dup(0)
 #define v_and(a, b) _mm_and_si128((a), (b))
 #define v_xor(a, b) _mm_xor_si128((a), (b))
-#define v_shift_left(a) _mm_slli_si128((a), 2)
+#define v_eq(a, b) _mm_cmpeq_epi16((a), (b))
+#define v_gt(a, b) _mm_cmpgt_epi16((a), (b))
+#define v_select(a, b, mask) _mm_or_si128(_mm_andnot_si128((mask), (a)), \
+                                          _mm_and_si128((mask), (b)))
 #define v_mask_gt(a, b) _mm_movemask_epi8(_mm_cmpgt_epi16((a), (b)))
 
+using VECTOR_BYTE = __m128i;
+
+#define v8_load(a) _mm_load_si128((VECTOR_BYTE *)(a))
+#define v8_store(a, b) _mm_store_si128((VECTOR_BYTE *)(a), (b))
+#define v8_add(a, b) _mm_adds_epu8((a), (b))
+#define v8_min(a, b) _mm_min_epu8((a), (b))
+#define v8_dup(a) _mm_set1_epi8((char) (a))
+#define v8_match(a, b, c) _mm_or_si128((c),                             \
+                                       _mm_cmpeq_epi8(_mm_and_si128((a), (b)), \
+                                                      v8_dup(0)))
+
 #else
 
 #error Unknown Architecture
@@ -203,10 +337,24 @@ struct s16info_s
   VECTOR_SHORT * hearray;
   VECTOR_SHORT * dprofile;
   VECTOR_SHORT ** qtable;
-  unsigned short * dir;
+  DIRWORD * dir;
   char * qseq;
   uint64_t diralloc;
 
+  VECTOR_BYTE * qbytes;
+  VECTOR_BYTE * dbytes;
+
+  VECTOR_SHORT * pairrows;
+  BYTE * pairends;
+  int64_t pairrowsalloc;
+
+  VECTOR_SHORT * statsrows;
+  BYTE * statsends;
+  int64_t statsrowsalloc;
+
+  struct arena_s * arena;
+  int64_t xdrop;
+
   char * cigar;
   char * cigarend;
   int64_t cigaralloc;
@@ -295,6 +443,65 @@ auto dprofile_fill16(CELL * dprofile_word,
     }
 #endif
 
+#if defined(AVX512BW)
+
+  /*
+    The score matrix is symmetric, so the scores of the 16 symbols
+    against a given query symbol are found in its row. Use the target
+    symbols as indices into that row.
+  */
+
+  for (int j = 0; j < CDEPTH; j++)
+    {
+      const auto d = _mm512_cvtepu8_epi16
+        (_mm256_loadu_si256((__m256i *) (dseq + (j * CHANNELS))));
+      for (int i = 0; i < 16; i++)
+        {
+          const auto row = _mm512_castsi256_si512
+            (_mm256_loadu_si256((__m256i *) (score_matrix_word + (16 * i))));
+          v_store(dprofile_word + (CDEPTH * CHANNELS * i) + (CHANNELS * j),
+                  _mm512_permutexvar_epi16(d, row));
+        }
+    }
+
+#elif defined(AVX2)
+
+  /*
+    As above, but the rows of the symmetric score matrix are split
+    into tables of low and high bytes, used with byte shuffles.
+  */
+
+  const auto low_bytes = _mm_set1_epi16(0x00ff);
+  __m128i row_low[16];
+  __m128i row_high[16];
+
+  for (int i = 0; i < 16; i++)
+    {
+      const auto r0 = _mm_loadu_si128((__m128i *) (score_matrix_word + (16 * i)));
+      const auto r1 = _mm_loadu_si128((__m128i *) (score_matrix_word + (16 * i) + 8));
+      row_low[i] = _mm_packus_epi16(_mm_and_si128(r0, low_bytes),
+                                    _mm_and_si128(r1, low_bytes));
+      row_high[i] = _mm_packus_epi16(_mm_srli_epi16(r0, 8),
+                                     _mm_srli_epi16(r1, 8));
+    }
+
+  for (int j = 0; j < CDEPTH; j++)
+    {
+      const auto d = _mm_loadu_si128((__m128i *) (dseq + (j * CHANNELS)));
+      for (int i = 0; i < 16; i++)
+        {
+          const auto lo = _mm_shuffle_epi8(row_low[i], d);
+          const auto hi = _mm_shuffle_epi8(row_high[i], d);
+          const auto scores = _mm256_inserti128_si256
+            (_mm256_castsi128_si256(_mm_unpacklo_epi8(lo, hi)),
+             _mm_unpackhi_epi8(lo, hi), 1);
+          v_store(dprofile_word + (CDEPTH * CHANNELS * i) + (CHANNELS * j),
+                  scores);
+        }
+    }
+
+#else
+
   for (int j = 0; j < CDEPTH; j++)
     {
       int d[CHANNELS];
@@ -460,6 +667,9 @@ auto dprofile_fill16(CELL * dprofile_word,
           v_store(dprofile_word + (CDEPTH * CHANNELS * (i + 7)) + (CHANNELS * j), reg31);
         }
     }
+
+#endif
+
 #if 0
   dprofile_dump16(dprofile_word);
 #endif
@@ -581,7 +791,7 @@ auto aligncolumns_first(VECTOR_SHORT * Sm,
                         VECTOR_SHORT M_QR_q_interior,
                         VECTOR_SHORT M_QR_q_right,
                         int64_t ql,
-                        unsigned short * dir) -> void
+                        DIRWORD * dir) -> void
 {
 
   VECTOR_SHORT h4;
@@ -595,7 +805,7 @@ auto aligncolumns_first(VECTOR_SHORT * Sm,
   VECTOR_SHORT * vp = nullptr;
 
   VECTOR_SHORT h_min = v_zero;
-  VECTOR_SHORT h_max = v_zero;
+  VECTOR_SHORT h_max = v_dup(std::numeric_limits<short>::min());
 
 #ifdef __PPC__
   __vector unsigned long long RES1;
@@ -743,7 +953,7 @@ auto aligncolumns_rest(VECTOR_SHORT * Sm,
                        VECTOR_SHORT * _h_min,
                        VECTOR_SHORT * _h_max,
                        int64_t ql,
-                       unsigned short * dir) -> void
+                       DIRWORD * dir) -> void
 {
   VECTOR_SHORT h4;
   VECTOR_SHORT h5;
@@ -756,7 +966,7 @@ auto aligncolumns_rest(VECTOR_SHORT * Sm,
   VECTOR_SHORT * vp = nullptr;
 
   VECTOR_SHORT h_min = v_zero;
-  VECTOR_SHORT h_max = v_zero;
+  VECTOR_SHORT h_max = v_dup(std::numeric_limits<short>::min());
 
 #ifdef __PPC__
   __vector unsigned long long RES1;
@@ -854,6 +1064,143 @@ auto aligncolumns_rest(VECTOR_SHORT * Sm,
   *_h_max = h_max;
 }
 
+/*
+  Align four columns for channels holding pairs of different queries
+  and targets. The scores are computed from the symbol codes of each
+  query row and target column instead of a profile shared by all
+  channels. Each row has seven vectors: the query codes (-1 when
+  ambiguous), a mask of the unambiguous query symbols, H and E of the
+  previous column, the query gap penalties of the row and a mask of
+  the channels whose query ends there. In those rows, the right end
+  gap penalties are used and the H values are saved in Sm.
+*/
+
+auto aligncolumns_pairs(VECTOR_SHORT * Sm,
+                        VECTOR_SHORT * rows,
+                        BYTE const * ends,
+                        VECTOR_SHORT const * dcodes,
+                        VECTOR_SHORT const * dmismatch,
+                        VECTOR_SHORT matchdiff,
+                        VECTOR_SHORT QR_q_i,
+                        VECTOR_SHORT R_q_i,
+                        VECTOR_SHORT QR_t_0,
+                        VECTOR_SHORT R_t_0,
+                        VECTOR_SHORT QR_t_1,
+                        VECTOR_SHORT R_t_1,
+                        VECTOR_SHORT QR_t_2,
+                        VECTOR_SHORT R_t_2,
+                        VECTOR_SHORT QR_t_3,
+                        VECTOR_SHORT R_t_3,
+                        VECTOR_SHORT h0,
+                        VECTOR_SHORT h1,
+                        VECTOR_SHORT h2,
+                        VECTOR_SHORT h3,
+                        VECTOR_SHORT f0,
+                        VECTOR_SHORT f1,
+                        VECTOR_SHORT f2,
+                        VECTOR_SHORT f3,
+                        int64_t ql,
+                        DIRWORD * dir) -> void
+{
+  VECTOR_SHORT h4;
+  VECTOR_SHORT h5;
+  VECTOR_SHORT h6;
+  VECTOR_SHORT h7;
+  VECTOR_SHORT h8;
+  VECTOR_SHORT E;
+  VECTOR_SHORT HE;
+  VECTOR_SHORT HF;
+  VECTOR_SHORT V0;
+  VECTOR_SHORT V1;
+  VECTOR_SHORT V2;
+  VECTOR_SHORT V3;
+
+  /* overflow is excluded before alignment, see search16_pairable */
+  VECTOR_SHORT h_min = v_zero;
+  VECTOR_SHORT h_max = v_zero;
+
+#ifdef __PPC__
+  __vector unsigned long long RES1;
+  __vector unsigned long long RES2;
+  __vector unsigned long long RES;
+#endif
+
+  f0 = v_sub(f0, QR_t_0);
+  f1 = v_sub(f1, QR_t_1);
+  f2 = v_sub(f2, QR_t_2);
+  f3 = v_sub(f3, QR_t_3);
+
+  for (int64_t i = 0; i < ql; i++)
+    {
+      VECTOR_SHORT * row = rows + (7 * i);
+
+      /* match if the codes are equal, mismatch unless ambiguous */
+      VECTOR_SHORT const qcodes = row[0];
+      VECTOR_SHORT const qmask = row[1];
+      V0 = v_add(v_and(qmask, dmismatch[0]),
+                 v_and(v_eq(qcodes, dcodes[0]), matchdiff));
+      V1 = v_add(v_and(qmask, dmismatch[1]),
+                 v_and(v_eq(qcodes, dcodes[1]), matchdiff));
+      V2 = v_add(v_and(qmask, dmismatch[2]),
+                 v_and(v_eq(qcodes, dcodes[2]), matchdiff));
+      V3 = v_add(v_and(qmask, dmismatch[3]),
+                 v_and(v_eq(qcodes, dcodes[3]), matchdiff));
+
+      h4 = row[2];
+
+      E  = row[3];
+
+      VECTOR_SHORT QR_q = QR_q_i;
+      VECTOR_SHORT R_q = R_q_i;
+      if (ends[i])
+        {
+          QR_q = row[4];
+          R_q = row[5];
+        }
+
+#ifdef __PPC__
+      ALIGNCORE(h0, h5, f0, V0, RES1,
+                QR_q, R_q, QR_t_0, R_t_0, h_min, h_max);
+      ALIGNCORE(h1, h6, f1, V1, RES2,
+                QR_q, R_q, QR_t_1, R_t_1, h_min, h_max);
+      RES = vec_perm(RES1, RES2, perm_merge_long_low);
+      v_store((dir + 16 * i + 0), RES);
+      ALIGNCORE(h2, h7, f2, V2, RES1,
+                QR_q, R_q, QR_t_2, R_t_2, h_min, h_max);
+      ALIGNCORE(h3, h8, f3, V3, RES2,
+                QR_q, R_q, QR_t_3, R_t_3, h_min, h_max);
+      RES = vec_perm(RES1, RES2, perm_merge_long_low);
+      v_store((dir + 16 * i + 8), RES);
+#else
+      ALIGNCORE(h0, h5, f0, V0, dir + 16 * i + 0,
+                QR_q, R_q, QR_t_0, R_t_0, h_min, h_max);
+      ALIGNCORE(h1, h6, f1, V1, dir + 16 * i + 4,
+                QR_q, R_q, QR_t_1, R_t_1, h_min, h_max);
+      ALIGNCORE(h2, h7, f2, V2, dir + 16 * i + 8,
+                QR_q, R_q, QR_t_2, R_t_2, h_min, h_max);
+      ALIGNCORE(h3, h8, f3, V3, dir + 16 * i + 12,
+                QR_q, R_q, QR_t_3, R_t_3, h_min, h_max);
+#endif
+
+      row[2] = h8;
+      row[3] = E;
+
+      if (ends[i])
+        {
+          VECTOR_SHORT const M = row[6];
+          Sm[0] = v_xor(Sm[0], v_and(M, v_xor(Sm[0], h5)));
+          Sm[1] = v_xor(Sm[1], v_and(M, v_xor(Sm[1], h6)));
+          Sm[2] = v_xor(Sm[2], v_and(M, v_xor(Sm[2], h7)));
+          Sm[3] = v_xor(Sm[3], v_and(M, v_xor(Sm[3], h8)));
+        }
+
+      h0 = h4;
+      h1 = h5;
+      h2 = h6;
+      h3 = h7;
+    }
+}
+
 inline auto pushop(s16info_s * s, char newop) -> void
 {
   if (newop == s->op)
@@ -894,7 +1241,16 @@ inline auto finishop(s16info_s * s) -> void
     }
 }
 
+/*
+  The direction buffer holds 16 words for each of the rows of a block
+  of four columns. The query has qlen symbols and occupies the first
+  rows of the buffer.
+*/
+
 auto backtrack16(s16info_s * s,
+                 char * qseq,
+                 uint64_t qlen,
+                 uint64_t rows,
                  char * dseq,
                  uint64_t dlen,
                  uint64_t offset,
@@ -904,15 +1260,11 @@ auto backtrack16(s16info_s * s,
                  unsigned short * pmismatches,
                  unsigned short * pgaps) -> void
 {
-  unsigned short * dirbuffer = s->dir;
-  uint64_t const dirbuffersize = s->qlen * s->maxdlen * 4;
-  uint64_t const qlen = s->qlen;
-  char * qseq = s->qseq;
+  DIRWORD * dirbuffer = s->dir;
+  uint64_t const dirbuffersize = rows * s->maxdlen * 4;
 
-  uint64_t const maskup      = 3ULL << (2 * channel + 0);
-  uint64_t const maskleft    = 3ULL << (2 * channel + 16);
-  uint64_t const maskextup   = 3ULL << (2 * channel + 32);
-  uint64_t const maskextleft = 3ULL << (2 * channel + 48);
+  /* each cell has four words: up, left, extend up and extend left */
+  DIRWORD const mask = ((1U << DIRBITS) - 1) << (DIRBITS * channel);
 
 #if 0
 
@@ -922,17 +1274,17 @@ auto backtrack16(s16info_s * s,
     {
       for (uint64_t j = 0; j < dlen; j++)
         {
-          uint64_t d = *((uint64_t *) (dirbuffer +
-                                       (offset + 16 * s->qlen * (j / 4) +
-                                        16 * i + 4 * (j & 3)) % dirbuffersize));
-          if (d & maskup)
+          DIRWORD * d = dirbuffer +
+            (offset + 16 * rows * (j / 4) +
+             16 * i + 4 * (j & 3)) % dirbuffersize;
+          if (d[0] & mask)
             {
-              if (d & maskleft)
+              if (d[1] & mask)
                 printf("+");
               else
                 printf("^");
             }
-          else if (d & maskleft)
+          else if (d[1] & mask)
             {
               printf("<");
             }
@@ -950,17 +1302,17 @@ auto backtrack16(s16info_s * s,
     {
       for (uint64_t j = 0; j < dlen; j++)
         {
-          uint64_t d = *((uint64_t *) (dirbuffer +
-                                       (offset + 16 * s->qlen * (j / 4) +
-                                        16 * i + 4 * (j & 3)) % dirbuffersize));
-          if (d & maskextup)
+          DIRWORD * d = dirbuffer +
+            (offset + 16 * rows * (j / 4) +
+             16 * i + 4 * (j & 3)) % dirbuffersize;
+          if (d[2] & mask)
             {
-              if (d & maskextleft)
+              if (d[3] & mask)
                 printf("+");
               else
                 printf("^");
             }
-          else if (d & maskextleft)
+          else if (d[3] & mask)
             {
               printf("<");
             }
@@ -982,7 +1334,7 @@ auto backtrack16(s16info_s * s,
   int64_t i = qlen - 1;
   int64_t j = dlen - 1;
 
-  s->cigarend = s->cigar + s->qlen + s->maxdlen + 1;
+  s->cigarend = s->cigar + rows + s->maxdlen + 1;
   s->op = 0;
   s->opcount = 1;
 
@@ -990,21 +1342,21 @@ auto backtrack16(s16info_s * s,
     {
       ++aligned;
 
-      uint64_t const d = *((uint64_t *) (dirbuffer +
-                                   (offset + (16 * s->qlen * (j / 4)) +
-                                    (16 * i) + (4 * (j & 3))) % dirbuffersize));
+      DIRWORD const * d = dirbuffer +
+        ((offset + (16 * rows * (j / 4)) +
+          (16 * i) + (4 * (j & 3))) % dirbuffersize);
 
-      if ((s->op == 'I') && (d & maskextleft))
+      if ((s->op == 'I') && (d[3] & mask))
         {
           --j;
           pushop(s, 'I');
         }
-      else if ((s->op == 'D') && (d & maskextup))
+      else if ((s->op == 'D') && (d[2] & mask))
         {
           --i;
           pushop(s, 'D');
         }
-      else if (d & maskleft)
+      else if (d[1] & mask)
         {
           if (s->op != 'I')
             {
@@ -1013,7 +1365,7 @@ auto backtrack16(s16info_s * s,
           --j;
           pushop(s, 'I');
         }
-      else if (d & maskup)
+      else if (d[0] & mask)
         {
           if (s->op != 'D')
             {
@@ -1063,7 +1415,7 @@ auto backtrack16(s16info_s * s,
   finishop(s);
 
   /* move cigar to beginning of allocated memory area */
-  int const cigarlen = s->cigar + s->qlen + s->maxdlen - s->cigarend;
+  int const cigarlen = s->cigar + rows + s->maxdlen - s->cigarend;
   memmove(s->cigar, s->cigarend, cigarlen + 1);
 
   * paligned = aligned;
@@ -1092,9 +1444,11 @@ auto search16_init(CELL score_match,
 
   /* prepare alloc of qtable, dprofile, hearray, dir */
   auto * s = (struct s16info_s *)
-    xmalloc(sizeof(struct s16info_s));
+    xmalloc_aligned(sizeof(struct s16info_s), sizeof(VECTOR_SHORT));
 
-  s->dprofile = (VECTOR_SHORT *) xmalloc(2 * 4 * 8 * 16);
+  s->dprofile = (VECTOR_SHORT *)
+    xmalloc_aligned(sizeof(CELL) * CDEPTH * CHANNELS * 16,
+                    sizeof(VECTOR_SHORT));
   s->qlen = 0;
   s->qseq = nullptr;
   s->maxdlen = 0;
@@ -1105,6 +1459,16 @@ auto search16_init(CELL score_match,
   s->cigar = nullptr;
   s->cigarend = nullptr;
   s->cigaralloc = 0;
+  s->qbytes = nullptr;
+  s->dbytes = nullptr;
+  s->pairrows = nullptr;
+  s->pairends = nullptr;
+  s->pairrowsalloc = 0;
+  s->statsrows = nullptr;
+  s->statsends = nullptr;
+  s->statsrowsalloc = 0;
+  s->arena = nullptr;
+  s->xdrop = 0;
 
   for (int i = 0; i < 16; i++)
     {
@@ -1183,19 +1547,66 @@ auto search16_exit(s16info_s * s) -> void
     {
       xfree(s->cigar);
     }
+  if (s->qbytes)
+    {
+      xfree(s->qbytes);
+    }
+  if (s->dbytes)
+    {
+      xfree(s->dbytes);
+    }
+  if (s->pairrows)
+    {
+      xfree(s->pairrows);
+      xfree(s->pairends);
+    }
+  if (s->statsrows)
+    {
+      xfree(s->statsrows);
+      xfree(s->statsends);
+    }
   xfree(s);
 }
 
+auto search16_set_arena(s16info_s * s, struct arena_s * arena) -> void
+{
+  s->arena = arena;
+}
+
+auto search16_set_xdrop(s16info_s * s, int64_t xdrop) -> void
+{
+  s->xdrop = xdrop;
+}
+
+auto search16_cigar(s16info_s * s, const char * cigar) -> char *
+{
+  /* copy an alignment string to be returned to the caller */
+  return s->arena ? arena_strdup(s->arena, cigar) : xstrdup(cigar);
+}
+
 auto search16_qprep(s16info_s * s, char * qseq, int qlen) -> void
 {
   s->qlen = qlen;
   s->qseq = qseq;
 
+  /* the vectors for search8 are prepared when first needed */
+  if (s->qbytes)
+    {
+      xfree(s->qbytes);
+      s->qbytes = nullptr;
+    }
+  if (s->dbytes)
+    {
+      xfree(s->dbytes);
+      s->dbytes = nullptr;
+    }
+
   if (s->hearray)
     {
       xfree(s->hearray);
     }
-  s->hearray = (VECTOR_SHORT *) xmalloc(2 * s->qlen * sizeof(VECTOR_SHORT));
+  s->hearray = (VECTOR_SHORT *) xmalloc_aligned(2 * s->qlen * sizeof(VECTOR_SHORT),
+                                                sizeof(VECTOR_SHORT));
   memset(s->hearray, 0, 2 * s->qlen * sizeof(VECTOR_SHORT));
 
   if (s->qtable)
@@ -1250,21 +1661,12 @@ auto search16(s16info_s * s,
                     (length * s->penalty_gap_extension_target_right));
             }
 
-          char * cigar = nullptr;
+          char cigar[32] = "";
           if (length > 0)
             {
-              int const ret = xsprintf(&cigar, "%ldI", length);
-              if ((ret < 2) or not cigar)
-                {
-                  fatal("Unable to allocate enough memory.");
-                }
-            }
-          else
-            {
-              cigar = (char *) xmalloc(1);
-              cigar[0] = 0;
+              snprintf(cigar, sizeof(cigar), "%" PRId64 "I", length);
             }
-          pcigar[cand_id] = cigar;
+          pcigar[cand_id] = search16_cigar(s, cigar);
         }
       return;
     }
@@ -1294,11 +1696,10 @@ auto search16(s16info_s * s,
         {
           xfree(s->dir);
         }
-      s->dir = (unsigned short*) xmalloc(dirbuffersize *
-                                         sizeof(unsigned short));
+      s->dir = (DIRWORD *) xmalloc(dirbuffersize * sizeof(DIRWORD));
     }
 
-  unsigned short * dirbuffer = s->dir;
+  DIRWORD * dirbuffer = s->dir;
 
   if (s->qlen + s->maxdlen + 1 > s->cigaralloc)
     {
@@ -1311,7 +1712,7 @@ auto search16(s16info_s * s,
     }
 
   VECTOR_SHORT M;
-  VECTOR_SHORT T0;
+  alignas(VECTOR_SHORT) CELL lanes[CHANNELS];
 
   VECTOR_SHORT M_QR_target_left;
   VECTOR_SHORT M_R_target_left;
@@ -1342,6 +1743,8 @@ auto search16(s16info_s * s,
   uint64_t d_length[CHANNELS];
   int64_t seq_id[CHANNELS];
   bool overflow[CHANNELS];
+  bool dropped[CHANNELS];
+  int64_t best[CHANNELS];
 
   VECTOR_SHORT dseqalloc[CDEPTH];
   VECTOR_SHORT S[4];
@@ -1352,8 +1755,6 @@ auto search16(s16info_s * s,
   uint64_t next_id = 0;
   uint64_t done = 0;
 
-  T0 = v_init(-1, 0, 0, 0, 0, 0, 0, 0);
-
   R_query_left = v_dup(s->penalty_gap_extension_query_left);
 
   QR_query_interior = v_dup((s->penalty_gap_open_query_interior +
@@ -1388,6 +1789,8 @@ auto search16(s16info_s * s,
       d_length[c] = 0;
       seq_id[c] = -1;
       overflow[c] = false;
+      dropped[c] = false;
+      best[c] = std::numeric_limits<short>::min();
     }
 
   short gap_penalty_max = 0;
@@ -1432,7 +1835,7 @@ auto search16(s16info_s * s,
 
   bool easy = false;
 
-  unsigned short * dir = dirbuffer;
+  DIRWORD * dir = dirbuffer;
 
   while (true)
     {
@@ -1482,17 +1885,12 @@ auto search16(s16info_s * s,
                                            R_target_interior);
               for (unsigned int j = 0; j < CDEPTH; j++)
                 {
-                  VECTOR_SHORT MM = v_zero;
-                  VECTOR_SHORT TT = T0;
                   for (int c = 0; c < CHANNELS; c++)
                     {
-                      if ((d_begin[c] == d_end[c]) &&
-                          (j >= ((d_length[c] + 3) % 4)))
-                        {
-                          MM = v_xor(MM, TT);
-                        }
-                      TT = v_shift_left(TT);
+                      lanes[c] = ((d_begin[c] == d_end[c]) &&
+                                  (j >= ((d_length[c] + 3) % 4))) ? -1 : 0;
                     }
+                  VECTOR_SHORT const MM = v_load(lanes);
                   QR_target[j] = v_add(QR_target_interior,
                                        v_and(QR_diff, MM));
                   R_target[j]  = v_add(R_target_interior,
@@ -1530,6 +1928,20 @@ auto search16(s16info_s * s,
                     {
                       overflow[c] = true;
                     }
+                  else if (s->xdrop and (d_begin[c] < d_end[c]))
+                    {
+                      if (h_max_c < best[c] - s->xdrop)
+                        {
+                          /* x-drop: abandon the rest of this target */
+                          dropped[c] = true;
+                          d_begin[c] = d_end[c];
+                          easy = false;
+                        }
+                      else if (h_max_c > best[c])
+                        {
+                          best[c] = h_max_c;
+                        }
+                    }
                 }
             }
         }
@@ -1540,11 +1952,9 @@ auto search16(s16info_s * s,
 
           easy = true;
 
-          M = v_zero;
-
-          VECTOR_SHORT T = T0;
           for (int c = 0; c < CHANNELS; c++)
             {
+              lanes[c] = 0;
               if (d_begin[c] < d_end[c])
                 {
                   /* this channel has more sequence */
@@ -1569,7 +1979,7 @@ auto search16(s16info_s * s,
                 {
                   /* sequence in channel c ended. change of sequence */
 
-                  M = v_xor(M, T);
+                  lanes[c] = -1;
 
                   int64_t cand_id = seq_id[c];
 
@@ -1582,26 +1992,35 @@ auto search16(s16info_s * s,
                       int64_t const z = (dbseqlen + 3) % 4;
                       int64_t const score = ((CELL *) S)[(z * CHANNELS) + c];
 
-                      if (overflow[c])
+                      if (dropped[c])
+                        {
+                          /* abandoned by the x-drop test */
+                          pscores[cand_id] = std::numeric_limits<short>::min();
+                          paligned[cand_id] = 0;
+                          pmatches[cand_id] = 0;
+                          pmismatches[cand_id] = 0;
+                          pgaps[cand_id] = 0;
+                          pcigar[cand_id] = search16_cigar(s, "");
+                        }
+                      else if (overflow[c])
                         {
                           pscores[cand_id] = std::numeric_limits<short>::max();
                           paligned[cand_id] = 0;
                           pmatches[cand_id] = 0;
                           pmismatches[cand_id] = 0;
                           pgaps[cand_id] = 0;
-                          pcigar[cand_id] = xstrdup("");
+                          pcigar[cand_id] = search16_cigar(s, "");
                         }
                       else
                         {
                           pscores[cand_id] = score;
-                          backtrack16(s, dbseq, dbseqlen, d_offset[c], c,
+                          backtrack16(s, s->qseq, s->qlen, s->qlen,
+                                      dbseq, dbseqlen, d_offset[c], c,
                                       paligned + cand_id,
                                       pmatches + cand_id,
                                       pmismatches + cand_id,
                                       pgaps + cand_id);
-                          pcigar[cand_id] =
-                            (char *) xmalloc(strlen(s->cigar)+1);
-                          strcpy(pcigar[cand_id], s->cigar);
+                          pcigar[cand_id] = search16_cigar(s, s->cigar);
                         }
 
                       done++;
@@ -1622,7 +2041,7 @@ auto search16(s16info_s * s,
                           pmatches[cand_id] = 0;
                           pmismatches[cand_id] = 0;
                           pgaps[cand_id] = 0;
-                          pcigar[cand_id] = xstrdup("");
+                          pcigar[cand_id] = search16_cigar(s, "");
                           length = 0;
                           done++;
                         }
@@ -1638,6 +2057,8 @@ auto search16(s16info_s * s,
                       d_end[c] = (unsigned char *) address + length;
                       d_offset[c] = dir - dirbuffer;
                       overflow[c] = false;
+                      dropped[c] = false;
+                      best[c] = std::numeric_limits<short>::min();
 
                       ((CELL *) &H0)[c] = 0;
                       ((CELL *) &H1)[c] = - s->penalty_gap_open_query_left
@@ -1691,9 +2112,10 @@ auto search16(s16info_s * s,
                         }
                     }
                 }
-              T = v_shift_left(T);
             }
 
+          M = v_load(lanes);
+
           if (done == sequences)
             {
               break;
@@ -1732,17 +2154,12 @@ auto search16(s16info_s * s,
                                            R_target_interior);
               for (unsigned int j = 0; j < CDEPTH; j++)
                 {
-                  VECTOR_SHORT MM = v_zero;
-                  VECTOR_SHORT TT = T0;
                   for (int c = 0; c < CHANNELS; c++)
                     {
-                      if ((d_begin[c] == d_end[c]) &&
-                          (j >= ((d_length[c] + 3) % 4)))
-                        {
-                          MM = v_xor(MM, TT);
-                        }
-                      TT = v_shift_left(TT);
+                      lanes[c] = ((d_begin[c] == d_end[c]) &&
+                                  (j >= ((d_length[c] + 3) % 4))) ? -1 : 0;
                     }
+                  VECTOR_SHORT const MM = v_load(lanes);
                   QR_target[j] = v_add(QR_target_interior,
                                        v_and(QR_diff, MM));
                   R_target[j]  = v_add(R_target_interior,
@@ -1783,6 +2200,19 @@ auto search16(s16info_s * s,
                     {
                       overflow[c] = true;
                     }
+                  else if (s->xdrop and (d_begin[c] < d_end[c]))
+                    {
+                      if (h_max_c < best[c] - s->xdrop)
+                        {
+                          dropped[c] = true;
+                          d_begin[c] = d_end[c];
+                          easy = false;
+                        }
+                      else if (h_max_c > best[c])
+                        {
+                          best[c] = h_max_c;
+                        }
+                    }
                 }
             }
         }
@@ -1805,3 +2235,1358 @@ auto search16(s16info_s * s,
         }
     }
 }
+
+/*
+  Pairs of a query and a target can be aligned by search16_pairs,
+  with a different query in each channel, when none of the scores of
+  the alignment matrix can overflow. Neither search16 nor
+  search16_pairs will then saturate the scores, and both find the
+  same alignments. The same holds for search16_stats, whose counts
+  and gap lengths must fit in the channels as well.
+*/
+
+auto search16_pairable(s16info_s * s, int64_t qlen, int64_t dlen) -> bool
+{
+  if ((qlen == 0) or (dlen == 0) or (qlen * dlen > MAXSEQLENPRODUCT) or
+      (qlen + dlen >= std::numeric_limits<short>::max()))
+    {
+      return false;
+    }
+
+  int64_t gap_open_max = 0;
+  gap_open_max = MAX(gap_open_max, s->penalty_gap_open_query_left);
+  gap_open_max = MAX(gap_open_max, s->penalty_gap_open_query_interior);
+  gap_open_max = MAX(gap_open_max, s->penalty_gap_open_query_right);
+  gap_open_max = MAX(gap_open_max, s->penalty_gap_open_target_left);
+  gap_open_max = MAX(gap_open_max, s->penalty_gap_open_target_interior);
+  gap_open_max = MAX(gap_open_max, s->penalty_gap_open_target_right);
+
+  int64_t gap_extension_max = 0;
+  gap_extension_max = MAX(gap_extension_max,
+                          s->penalty_gap_extension_query_left);
+  gap_extension_max = MAX(gap_extension_max,
+                          s->penalty_gap_extension_query_interior);
+  gap_extension_max = MAX(gap_extension_max,
+                          s->penalty_gap_extension_query_right);
+  gap_extension_max = MAX(gap_extension_max,
+                          s->penalty_gap_extension_target_left);
+  gap_extension_max = MAX(gap_extension_max,
+                          s->penalty_gap_extension_target_interior);
+  gap_extension_max = MAX(gap_extension_max,
+                          s->penalty_gap_extension_target_right);
+
+  int64_t score_max = 0;
+  for (auto const & row : scorematrix)
+    {
+      for (auto const value : row)
+        {
+          score_max = MAX(score_max, value);
+        }
+    }
+
+  /*
+    Any cell, including the three extra columns of the last block, is
+    reached by a path of two gaps, and no path gains more than one
+    maximum score per query symbol.
+  */
+
+  int64_t const lowest = (3 * gap_open_max) +
+    ((qlen + dlen + 4) * gap_extension_max);
+  int64_t const highest = score_max * qlen;
+
+  return (lowest < std::numeric_limits<short>::max()) and
+    (highest < std::numeric_limits<short>::max());
+}
+
+auto search16_pairs_group(s16info_s * s,
+                          unsigned int count,
+                          unsigned int const * order,
+                          char ** qseqs,
+                          int const * qlens,
+                          unsigned int const * seqnos,
+                          CELL * pscores,
+                          unsigned short * paligned,
+                          unsigned short * pmatches,
+                          unsigned short * pmismatches,
+                          unsigned short * pgaps,
+                          char ** pcigar) -> void
+{
+  char * q_seq[CHANNELS];
+  int64_t q_len[CHANNELS];
+  char * d_seq[CHANNELS];
+  int64_t d_len[CHANNELS];
+
+  int64_t rows = 0;
+  int64_t maxdlen = 0;
+
+  for (int c = 0; c < CHANNELS; c++)
+    {
+      q_seq[c] = nullptr;
+      q_len[c] = 0;
+      d_seq[c] = nullptr;
+      d_len[c] = 0;
+      if (c < (int) count)
+        {
+          unsigned int const id = order[c];
+          q_seq[c] = qseqs[id];
+          q_len[c] = qlens[id];
+          d_seq[c] = db_getsequence(seqnos[id]);
+          d_len[c] = db_getsequencelen(seqnos[id]);
+          rows = MAX(rows, q_len[c]);
+          maxdlen = MAX(maxdlen, d_len[c]);
+        }
+    }
+
+  int64_t const blocks = (maxdlen + 3) / 4;
+  s->maxdlen = 4 * blocks;
+
+  uint64_t const dirbuffersize = rows * s->maxdlen * 4;
+  if (dirbuffersize > s->diralloc)
+    {
+      s->diralloc = dirbuffersize;
+      if (s->dir)
+        {
+          xfree(s->dir);
+        }
+      s->dir = (DIRWORD *) xmalloc(dirbuffersize * sizeof(DIRWORD));
+    }
+
+  if (rows + s->maxdlen + 1 > s->cigaralloc)
+    {
+      s->cigaralloc = rows + s->maxdlen + 1;
+      if (s->cigar)
+        {
+          xfree(s->cigar);
+        }
+      s->cigar = (char *) xmalloc(s->cigaralloc);
+    }
+
+  if (rows > s->pairrowsalloc)
+    {
+      s->pairrowsalloc = rows;
+      if (s->pairrows)
+        {
+          xfree(s->pairrows);
+          xfree(s->pairends);
+        }
+      s->pairrows = (VECTOR_SHORT *)
+        xmalloc_aligned(7 * rows * sizeof(VECTOR_SHORT), sizeof(VECTOR_SHORT));
+      s->pairends = (BYTE *) xmalloc(rows);
+    }
+
+  /* fill the query codes, gap penalties and left boundary of each row */
+
+  int64_t const QR_q_i = s->penalty_gap_open_query_interior +
+    s->penalty_gap_extension_query_interior;
+  int64_t const QR_q_r = s->penalty_gap_open_query_right +
+    s->penalty_gap_extension_query_right;
+  int64_t const QR_t_l = s->penalty_gap_open_target_left +
+    s->penalty_gap_extension_target_left;
+
+  int64_t const limit = std::numeric_limits<short>::max();
+
+  memset(s->pairends, 0, rows);
+
+  for (int64_t i = 0; i < rows; i++)
+    {
+      auto * r = (CELL *) (s->pairrows + (7 * i));
+      int64_t const h = QR_t_l + (i * s->penalty_gap_extension_target_left);
+
+      for (int c = 0; c < CHANNELS; c++)
+        {
+          CELL code = -1;
+          CELL known = 0;
+          if (i < q_len[c])
+            {
+              unsigned int const x = chrmap_4bit[(int) (q_seq[c][i])];
+              if (not ambiguous_4bit[x])
+                {
+                  code = x;
+                  known = -1;
+                }
+            }
+
+          bool const last = (i == q_len[c] - 1);
+          int64_t const QR_q = last ? QR_q_r : QR_q_i;
+
+          r[(0 * CHANNELS) + c] = code;
+          r[(1 * CHANNELS) + c] = known;
+          r[(2 * CHANNELS) + c] = - MIN(h, limit);
+          r[(3 * CHANNELS) + c] = - MIN(h + QR_q, limit);
+          r[(4 * CHANNELS) + c] = QR_q;
+          r[(5 * CHANNELS) + c] = last ?
+            s->penalty_gap_extension_query_right :
+            s->penalty_gap_extension_query_interior;
+          r[(6 * CHANNELS) + c] = last ? -1 : 0;
+
+          if (last)
+            {
+              s->pairends[i] = 1;
+            }
+        }
+    }
+
+  VECTOR_SHORT const R_query_left = v_dup(s->penalty_gap_extension_query_left);
+  VECTOR_SHORT const QR_query_interior = v_dup(QR_q_i);
+  VECTOR_SHORT const R_query_interior =
+    v_dup(s->penalty_gap_extension_query_interior);
+  VECTOR_SHORT const QR_target_interior =
+    v_dup((s->penalty_gap_open_target_interior +
+           s->penalty_gap_extension_target_interior));
+  VECTOR_SHORT const R_target_interior =
+    v_dup(s->penalty_gap_extension_target_interior);
+  VECTOR_SHORT const QR_target_right =
+    v_dup((s->penalty_gap_open_target_right +
+           s->penalty_gap_extension_target_right));
+  VECTOR_SHORT const R_target_right =
+    v_dup(s->penalty_gap_extension_target_right);
+  VECTOR_SHORT const QR_diff = v_sub(QR_target_right, QR_target_interior);
+  VECTOR_SHORT const R_diff  = v_sub(R_target_right, R_target_interior);
+
+  CELL const score_match = scorematrix[1][1];
+  CELL const score_mismatch = scorematrix[1][2];
+  VECTOR_SHORT const matchdiff = v_dup(score_match - score_mismatch);
+
+  /* the top row, as for a new sequence in search16 */
+
+  int64_t const go_q_l = s->penalty_gap_open_query_left;
+  int64_t const ge_q_l = s->penalty_gap_extension_query_left;
+
+  VECTOR_SHORT H0 = v_zero;
+  VECTOR_SHORT H1 = v_dup(- go_q_l - (1 * ge_q_l));
+  VECTOR_SHORT H2 = v_dup(- go_q_l - (2 * ge_q_l));
+  VECTOR_SHORT H3 = v_dup(- go_q_l - (3 * ge_q_l));
+
+  VECTOR_SHORT F0 = v_dup(- go_q_l - (1 * ge_q_l));
+  VECTOR_SHORT F1 = v_dup(- go_q_l - (2 * ge_q_l));
+  VECTOR_SHORT F2 = v_dup(- go_q_l - (3 * ge_q_l));
+  VECTOR_SHORT F3 = v_dup(- go_q_l - (4 * ge_q_l));
+
+  VECTOR_SHORT dcodes[CDEPTH];
+  VECTOR_SHORT dmismatch[CDEPTH];
+  VECTOR_SHORT QR_target[CDEPTH];
+  VECTOR_SHORT R_target[CDEPTH];
+  VECTOR_SHORT S[CDEPTH];
+  alignas(VECTOR_SHORT) CELL lanes[CHANNELS];
+
+  for (int64_t b = 0; b < blocks; b++)
+    {
+      for (int j = 0; j < CDEPTH; j++)
+        {
+          int64_t const col = (4 * b) + j;
+
+          /* target codes, never equal to the query codes if ambiguous */
+          for (int c = 0; c < CHANNELS; c++)
+            {
+              lanes[c] = -2;
+              if (col < d_len[c])
+                {
+                  unsigned int const x = chrmap_4bit[(int) (d_seq[c][col])];
+                  if (not ambiguous_4bit[x])
+                    {
+                      lanes[c] = x;
+                    }
+                }
+            }
+          dcodes[j] = v_load(lanes);
+
+          for (int c = 0; c < CHANNELS; c++)
+            {
+              lanes[c] = (lanes[c] >= 0) ? score_mismatch : 0;
+            }
+          dmismatch[j] = v_load(lanes);
+
+          /* gap penalties for the right end of the targets */
+          for (int c = 0; c < CHANNELS; c++)
+            {
+              lanes[c] = (col >= d_len[c] - 1) ? -1 : 0;
+            }
+          VECTOR_SHORT const MM = v_load(lanes);
+          QR_target[j] = v_add(QR_target_interior, v_and(QR_diff, MM));
+          R_target[j]  = v_add(R_target_interior, v_and(R_diff, MM));
+
+          S[j] = v_zero;
+        }
+
+      aligncolumns_pairs(S, s->pairrows, s->pairends,
+                         dcodes, dmismatch, matchdiff,
+                         QR_query_interior, R_query_interior,
+                         QR_target[0], R_target[0],
+                         QR_target[1], R_target[1],
+                         QR_target[2], R_target[2],
+                         QR_target[3], R_target[3],
+                         H0, H1, H2, H3,
+                         F0, F1, F2, F3,
+                         rows, s->dir + (16 * rows * b));
+
+      /* save the scores of the targets ending in this block */
+      for (int c = 0; c < (int) count; c++)
+        {
+          if ((d_len[c] - 1) / 4 == b)
+            {
+              pscores[order[c]] =
+                ((CELL *) S)[(((d_len[c] - 1) % 4) * CHANNELS) + c];
+            }
+        }
+
+      H0 = v_sub(H3, R_query_left);
+      H1 = v_sub(H0, R_query_left);
+      H2 = v_sub(H1, R_query_left);
+      H3 = v_sub(H2, R_query_left);
+
+      F0 = v_sub(F3, R_query_left);
+      F1 = v_sub(F0, R_query_left);
+      F2 = v_sub(F1, R_query_left);
+      F3 = v_sub(F2, R_query_left);
+    }
+
+  for (int c = 0; c < (int) count; c++)
+    {
+      unsigned int const id = order[c];
+      backtrack16(s, q_seq[c], q_len[c], rows,
+                  d_seq[c], d_len[c], 0, c,
+                  paligned + id,
+                  pmatches + id,
+                  pmismatches + id,
+                  pgaps + id);
+      pcigar[id] = search16_cigar(s, s->cigar);
+    }
+}
+
+/* sort the pairs by query length, then by target length */
+
+auto search16_pairs_order(std::vector<unsigned int> & order,
+                          int const * qlens,
+                          unsigned int const * seqnos) -> void
+{
+  for (unsigned int p = 0; p < order.size(); p++)
+    {
+      order[p] = p;
+    }
+
+  std::sort(order.begin(), order.end(),
+            [&](unsigned int const a, unsigned int const b) -> bool {
+              if (qlens[a] != qlens[b])
+                {
+                  return qlens[a] < qlens[b];
+                }
+              return db_getsequencelen(seqnos[a]) <
+                db_getsequencelen(seqnos[b]);
+            });
+}
+
+/*
+  Align pairs of queries and targets that may all differ, filling the
+  channels with pairs from several queries. The pairs must be
+  accepted by search16_pairable. They are sorted by length so that
+  pairs of similar size are aligned together.
+*/
+
+auto search16_pairs(s16info_s * s,
+                    unsigned int pairs,
+                    char ** qseqs,
+                    int * qlens,
+                    unsigned int * seqnos,
+                    CELL * pscores,
+                    unsigned short * paligned,
+                    unsigned short * pmatches,
+                    unsigned short * pmismatches,
+                    unsigned short * pgaps,
+                    char ** pcigar) -> void
+{
+  std::vector<unsigned int> order(pairs);
+  search16_pairs_order(order, qlens, seqnos);
+
+  unsigned int first = 0;
+  while (first < pairs)
+    {
+      /* take pairs until the channels are full or the matrix too large */
+      int64_t rows = 0;
+      int64_t maxdlen = 0;
+      unsigned int count = 0;
+      while ((count < CHANNELS) and (first + count < pairs))
+        {
+          unsigned int const id = order[first + count];
+          int64_t const r = MAX(rows, qlens[id]);
+          int64_t const d = MAX(maxdlen, (int64_t) db_getsequencelen(seqnos[id]));
+          if ((count > 0) and (r * d > MAXSEQLENPRODUCT))
+            {
+              break;
+            }
+          rows = r;
+          maxdlen = d;
+          ++count;
+        }
+
+      search16_pairs_group(s, count, order.data() + first,
+                           qseqs, qlens, seqnos,
+                           pscores, paligned, pmatches,
+                           pmismatches, pgaps, pcigar);
+      first += count;
+    }
+}
+
+/*
+  Alignment statistics without traceback.
+
+  Instead of the direction bits, the aligner below carries, for every
+  cell, the statistics of the path that backtrack16 would follow from
+  that cell: the number of matches, of aligned pairs of symbols
+  (matches and mismatches) and of gap openings, and the lengths of the
+  gaps at the start (lead) and at the end (tail) of the path. The
+  lengths are positive for gaps in the target (D) and negative for
+  gaps in the query (I). The statistics are selected with the same
+  comparisons and priorities as the direction bits, so they are those
+  of the alignment found with traceback.
+
+  Apart from the H and F values of the diagonal and the E value of the
+  left cell, a cell needs the statistics of the paths through them.
+  The paths through E and F have not opened a new gap yet.
+*/
+
+struct pathstats16
+{
+  VECTOR_SHORT matches;
+  VECTOR_SHORT pairs;
+  VECTOR_SHORT gaps;
+  VECTOR_SHORT lead;
+  VECTOR_SHORT tail;
+};
+
+inline auto pathstats16_select(pathstats16 & a,
+                               pathstats16 const & b,
+                               VECTOR_SHORT mask) -> void
+{
+  a.matches = v_select(a.matches, b.matches, mask);
+  a.pairs = v_select(a.pairs, b.pairs, mask);
+  a.gaps = v_select(a.gaps, b.gaps, mask);
+  a.lead = v_select(a.lead, b.lead, mask);
+  a.tail = v_select(a.tail, b.tail, mask);
+}
+
+inline auto alignstats_cell(VECTOR_SHORT & h,
+                            pathstats16 & hs,
+                            VECTOR_SHORT & f,
+                            pathstats16 & fs,
+                            VECTOR_SHORT & e,
+                            pathstats16 & es,
+                            VECTOR_SHORT v,
+                            VECTOR_SHORT match,
+                            VECTOR_SHORT QR_q,
+                            VECTOR_SHORT R_q,
+                            VECTOR_SHORT QR_t,
+                            VECTOR_SHORT R_t) -> void
+{
+  VECTOR_SHORT const one = v_dup(1);
+  VECTOR_SHORT const zero = v_zero;
+
+  /* diagonal */
+
+  h = v_add(h, v);
+  hs.matches = v_sub(hs.matches, match);
+  hs.pairs = v_add(hs.pairs, one);
+  hs.tail = zero;
+
+  /* gap in the target, must go up */
+
+  VECTOR_SHORT const up = v_gt(f, h);
+  h = v_max(h, f);
+  pathstats16 x = fs;
+  x.gaps = v_add(x.gaps, one);
+  x.tail = v_add(v_max(x.tail, zero), one);
+  pathstats16_select(hs, x, up);
+
+  /* gap in the query, must go left */
+
+  VECTOR_SHORT const left = v_gt(e, h);
+  h = v_max(h, e);
+  x = es;
+  x.gaps = v_add(x.gaps, one);
+  x.tail = v_sub(v_min(x.tail, zero), one);
+  pathstats16_select(hs, x, left);
+
+  /* the next F, extended or opened from H */
+
+  VECTOR_SHORT const hf = v_sub(h, QR_t);
+  f = v_sub(f, R_t);
+  VECTOR_SHORT const extend_up = v_gt(f, hf);
+  f = v_max(f, hf);
+  x = hs;
+  x.gaps = v_add(x.gaps, v_gt(hs.tail, zero));
+  fs.tail = v_add(v_max(fs.tail, zero), one);
+  pathstats16_select(x, fs, extend_up);
+  fs = x;
+
+  /* the next E, extended or opened from H */
+
+  VECTOR_SHORT const he = v_sub(h, QR_q);
+  e = v_sub(e, R_q);
+  VECTOR_SHORT const extend_left = v_gt(e, he);
+  e = v_max(e, he);
+  x = hs;
+  x.gaps = v_add(x.gaps, v_gt(zero, hs.tail));
+  es.tail = v_sub(v_min(es.tail, zero), one);
+  pathstats16_select(x, es, extend_left);
+  es = x;
+}
+
+/*
+  Align four columns like aligncolumns_pairs, but with statistics
+  instead of direction bits. Each row has eighteen vectors: the query
+  codes, the mask of the unambiguous query symbols, the nucleotide
+  bits of the query symbols, H and E of the previous column, the query
+  gap penalties of the row, the mask of the channels whose query ends
+  there, and the statistics of H and E. The values and statistics of
+  the rows where queries end are saved in Sm and Ss.
+*/
+
+auto alignstats_pairs(VECTOR_SHORT * Sm,
+                      pathstats16 * Ss,
+                      VECTOR_SHORT * rows,
+                      BYTE const * ends,
+                      VECTOR_SHORT const * dcodes,
+                      VECTOR_SHORT const * dmismatch,
+                      VECTOR_SHORT const * dbits,
+                      VECTOR_SHORT matchdiff,
+                      VECTOR_SHORT QR_q_i,
+                      VECTOR_SHORT R_q_i,
+                      VECTOR_SHORT const * QR_t,
+                      VECTOR_SHORT const * R_t,
+                      VECTOR_SHORT * h,
+                      pathstats16 * hs,
+                      VECTOR_SHORT * f,
+                      pathstats16 * fs,
+                      int64_t ql) -> void
+{
+  VECTOR_SHORT const zero = v_zero;
+
+  for (int j = 0; j < CDEPTH; j++)
+    {
+      f[j] = v_sub(f[j], QR_t[j]);
+    }
+
+  for (int64_t i = 0; i < ql; i++)
+    {
+      VECTOR_SHORT * row = rows + (18 * i);
+      auto * rowstats = (pathstats16 *) (row + 8);
+
+      VECTOR_SHORT const qcodes = row[0];
+      VECTOR_SHORT const qmask = row[1];
+      VECTOR_SHORT const qbits = row[2];
+
+      VECTOR_SHORT const h_left = row[3];
+      pathstats16 const hs_left = rowstats[0];
+
+      VECTOR_SHORT e = row[4];
+      pathstats16 es = rowstats[1];
+
+      VECTOR_SHORT QR_q = QR_q_i;
+      VECTOR_SHORT R_q = R_q_i;
+      if (ends[i])
+        {
+          QR_q = row[5];
+          R_q = row[6];
+        }
+
+      for (int j = 0; j < CDEPTH; j++)
+        {
+          /* scores as in aligncolumns_pairs, matches as in backtrack16 */
+          VECTOR_SHORT const v = v_add(v_and(qmask, dmismatch[j]),
+                                       v_and(v_eq(qcodes, dcodes[j]),
+                                             matchdiff));
+          VECTOR_SHORT const match = v_xor(v_eq(v_and(qbits, dbits[j]),
+                                                zero),
+                                           v_dup(-1));
+          alignstats_cell(h[j], hs[j], f[j], fs[j], e, es,
+                          v, match, QR_q, R_q, QR_t[j], R_t[j]);
+        }
+
+      row[3] = h[3];
+      rowstats[0] = hs[3];
+      row[4] = e;
+      rowstats[1] = es;
+
+      if (ends[i])
+        {
+          VECTOR_SHORT const M = row[7];
+          for (int j = 0; j < CDEPTH; j++)
+            {
+              Sm[j] = v_select(Sm[j], h[j], M);
+              pathstats16_select(Ss[j], hs[j], M);
+            }
+        }
+
+      /* the cells of this row are the diagonals of the next row */
+
+      h[3] = h[2];
+      h[2] = h[1];
+      h[1] = h[0];
+      h[0] = h_left;
+      hs[3] = hs[2];
+      hs[2] = hs[1];
+      hs[1] = hs[0];
+      hs[0] = hs_left;
+    }
+}
+
+auto search16_stats_group(s16info_s * s,
+                          unsigned int count,
+                          unsigned int const * order,
+                          char ** qseqs,
+                          int const * qlens,
+                          unsigned int const * seqnos,
+                          CELL * pscores,
+                          unsigned short * paligned,
+                          unsigned short * pmatches,
+                          unsigned short * pmismatches,
+                          unsigned short * pgaps,
+                          short * plead,
+                          short * ptail) -> void
+{
+  char * q_seq[CHANNELS];
+  int64_t q_len[CHANNELS];
+  char * d_seq[CHANNELS];
+  int64_t d_len[CHANNELS];
+
+  int64_t rows = 0;
+  int64_t maxdlen = 0;
+
+  for (int c = 0; c < CHANNELS; c++)
+    {
+      q_seq[c] = nullptr;
+      q_len[c] = 0;
+      d_seq[c] = nullptr;
+      d_len[c] = 0;
+      if (c < (int) count)
+        {
+          unsigned int const id = order[c];
+          q_seq[c] = qseqs[id];
+          q_len[c] = qlens[id];
+          d_seq[c] = db_getsequence(seqnos[id]);
+          d_len[c] = db_getsequencelen(seqnos[id]);
+          rows = MAX(rows, q_len[c]);
+          maxdlen = MAX(maxdlen, d_len[c]);
+        }
+    }
+
+  int64_t const blocks = (maxdlen + 3) / 4;
+
+  if (rows > s->statsrowsalloc)
+    {
+      s->statsrowsalloc = rows;
+      if (s->statsrows)
+        {
+          xfree(s->statsrows);
+          xfree(s->statsends);
+        }
+      s->statsrows = (VECTOR_SHORT *)
+        xmalloc_aligned(18 * rows * sizeof(VECTOR_SHORT),
+                        sizeof(VECTOR_SHORT));
+      s->statsends = (BYTE *) xmalloc(rows);
+    }
+
+  /* fill the query codes, gap penalties and left boundary of each row */
+
+  int64_t const QR_q_i = s->penalty_gap_open_query_interior +
+    s->penalty_gap_extension_query_interior;
+  int64_t const QR_q_r = s->penalty_gap_open_query_right +
+    s->penalty_gap_extension_query_right;
+  int64_t const QR_t_l = s->penalty_gap_open_target_left +
+    s->penalty_gap_extension_target_left;
+
+  int64_t const limit = std::numeric_limits<short>::max();
+
+  memset(s->statsends, 0, rows);
+
+  for (int64_t i = 0; i < rows; i++)
+    {
+      auto * r = (CELL *) (s->statsrows + (18 * i));
+      int64_t const h = QR_t_l + (i * s->penalty_gap_extension_target_left);
+
+      for (int c = 0; c < CHANNELS; c++)
+        {
+          CELL code = -1;
+          CELL known = 0;
+          CELL bits = 0;
+          if (i < q_len[c])
+            {
+              unsigned int const x = chrmap_4bit[(int) (q_seq[c][i])];
+              bits = x;
+              if (not ambiguous_4bit[x])
+                {
+                  code = x;
+                  known = -1;
+                }
+            }
+
+          bool const last = (i == q_len[c] - 1);
+          int64_t const QR_q = last ? QR_q_r : QR_q_i;
+
+          r[(0 * CHANNELS) + c] = code;
+          r[(1 * CHANNELS) + c] = known;
+          r[(2 * CHANNELS) + c] = bits;
+          r[(3 * CHANNELS) + c] = - MIN(h, limit);
+          r[(4 * CHANNELS) + c] = - MIN(h + QR_q, limit);
+          r[(5 * CHANNELS) + c] = QR_q;
+          r[(6 * CHANNELS) + c] = last ?
+            s->penalty_gap_extension_query_right :
+            s->penalty_gap_extension_query_interior;
+          r[(7 * CHANNELS) + c] = last ? -1 : 0;
+
+          if (last)
+            {
+              s->statsends[i] = 1;
+            }
+        }
+
+      /* the paths to the left boundary are gaps in the target */
+
+      auto * rowstats = (pathstats16 *) (s->statsrows + (18 * i) + 8);
+      for (int k = 0; k < 2; k++)
+        {
+          rowstats[k].matches = v_zero;
+          rowstats[k].pairs = v_zero;
+          rowstats[k].gaps = v_dup(1);
+          rowstats[k].lead = v_dup(i + 1);
+          rowstats[k].tail = v_dup(i + 1);
+        }
+    }
+
+  VECTOR_SHORT const QR_query_interior = v_dup(QR_q_i);
+  VECTOR_SHORT const R_query_interior =
+    v_dup(s->penalty_gap_extension_query_interior);
+  VECTOR_SHORT const QR_target_interior =
+    v_dup((s->penalty_gap_open_target_interior +
+           s->penalty_gap_extension_target_interior));
+  VECTOR_SHORT const R_target_interior =
+    v_dup(s->penalty_gap_extension_target_interior);
+  VECTOR_SHORT const QR_target_right =
+    v_dup((s->penalty_gap_open_target_right +
+           s->penalty_gap_extension_target_right));
+  VECTOR_SHORT const R_target_right =
+    v_dup(s->penalty_gap_extension_target_right);
+  VECTOR_SHORT const QR_diff = v_sub(QR_target_right, QR_target_interior);
+  VECTOR_SHORT const R_diff  = v_sub(R_target_right, R_target_interior);
+
+  CELL const score_match = scorematrix[1][1];
+  CELL const score_mismatch = scorematrix[1][2];
+  VECTOR_SHORT const matchdiff = v_dup(score_match - score_mismatch);
+
+  int64_t const go_q_l = s->penalty_gap_open_query_left;
+  int64_t const ge_q_l = s->penalty_gap_extension_query_left;
+
+  VECTOR_SHORT dcodes[CDEPTH];
+  VECTOR_SHORT dmismatch[CDEPTH];
+  VECTOR_SHORT dbits[CDEPTH];
+  VECTOR_SHORT QR_target[CDEPTH];
+  VECTOR_SHORT R_target[CDEPTH];
+  VECTOR_SHORT H[CDEPTH];
+  VECTOR_SHORT F[CDEPTH];
+  VECTOR_SHORT S[CDEPTH];
+  pathstats16 HS[CDEPTH];
+  pathstats16 FS[CDEPTH];
+  pathstats16 SS[CDEPTH];
+  alignas(VECTOR_SHORT) CELL lanes[CHANNELS];
+
+  for (int64_t b = 0; b < blocks; b++)
+    {
+      for (int j = 0; j < CDEPTH; j++)
+        {
+          int64_t const col = (4 * b) + j;
+
+          /* target codes, never equal to the query codes if ambiguous */
+          for (int c = 0; c < CHANNELS; c++)
+            {
+              lanes[c] = -2;
+              if (col < d_len[c])
+                {
+                  unsigned int const x = chrmap_4bit[(int) (d_seq[c][col])];
+                  if (not ambiguous_4bit[x])
+                    {
+                      lanes[c] = x;
+                    }
+                }
+            }
+          dcodes[j] = v_load(lanes);
+
+          for (int c = 0; c < CHANNELS; c++)
+            {
+              lanes[c] = (lanes[c] >= 0) ? score_mismatch : 0;
+            }
+          dmismatch[j] = v_load(lanes);
+
+          for (int c = 0; c < CHANNELS; c++)
+            {
+              lanes[c] = (col < d_len[c]) ?
+                chrmap_4bit[(int) (d_seq[c][col])] : 0;
+            }
+          dbits[j] = v_load(lanes);
+
+          /* gap penalties for the right end of the targets */
+          for (int c = 0; c < CHANNELS; c++)
+            {
+              lanes[c] = (col >= d_len[c] - 1) ? -1 : 0;
+            }
+          VECTOR_SHORT const MM = v_load(lanes);
+          QR_target[j] = v_add(QR_target_interior, v_and(QR_diff, MM));
+          R_target[j]  = v_add(R_target_interior, v_and(R_diff, MM));
+
+          /* the top row, gaps in the query, as in search16_pairs_group */
+
+          H[j] = (col == 0) ? v_zero : v_dup(- go_q_l - (col * ge_q_l));
+          F[j] = v_dup(- go_q_l - ((col + 1) * ge_q_l));
+
+          HS[j].matches = v_zero;
+          HS[j].pairs = v_zero;
+          HS[j].gaps = (col == 0) ? v_zero : v_dup(1);
+          HS[j].lead = v_dup(- col);
+          HS[j].tail = v_dup(- col);
+
+          FS[j].matches = v_zero;
+          FS[j].pairs = v_zero;
+          FS[j].gaps = v_dup(1);
+          FS[j].lead = v_dup(- (col + 1));
+          FS[j].tail = v_dup(- (col + 1));
+
+          S[j] = v_zero;
+          SS[j] = HS[j];
+        }
+
+      alignstats_pairs(S, SS, s->statsrows, s->statsends,
+                       dcodes, dmismatch, dbits, matchdiff,
+                       QR_query_interior, R_query_interior,
+                       QR_target, R_target,
+                       H, HS, F, FS,
+                       rows);
+
+      /* save the results of the targets ending in this block */
+      for (int c = 0; c < (int) count; c++)
+        {
+          if ((d_len[c] - 1) / 4 == b)
+            {
+              unsigned int const id = order[c];
+              int64_t const z = (d_len[c] - 1) % 4;
+              auto const pairs = (int64_t) ((CELL *) & SS[z].pairs)[c];
+              int64_t const indels = q_len[c] + d_len[c] - (2 * pairs);
+              pscores[id] = ((CELL *) & S[z])[c];
+              paligned[id] = pairs + indels;
+              pmatches[id] = ((CELL *) & SS[z].matches)[c];
+              pmismatches[id] = pairs - pmatches[id];
+              pgaps[id] = ((CELL *) & SS[z].gaps)[c];
+              plead[id] = ((CELL *) & SS[z].lead)[c];
+              ptail[id] = ((CELL *) & SS[z].tail)[c];
+            }
+        }
+    }
+}
+
+/*
+  Align pairs of queries and targets like search16_pairs, but compute
+  only the scores and the alignment statistics, without traceback and
+  without alignment strings. The ends of the alignments are described
+  by the signed lengths of their terminal gaps, positive for gaps in
+  the target, as in alignstats_pairs.
+*/
+
+auto search16_stats(s16info_s * s,
+                    unsigned int pairs,
+                    char ** qseqs,
+                    int * qlens,
+                    unsigned int * seqnos,
+                    CELL * pscores,
+                    unsigned short * paligned,
+                    unsigned short * pmatches,
+                    unsigned short * pmismatches,
+                    unsigned short * pgaps,
+                    short * plead,
+                    short * ptail) -> void
+{
+  std::vector<unsigned int> order(pairs);
+  search16_pairs_order(order, qlens, seqnos);
+
+  for (unsigned int first = 0; first < pairs; first += CHANNELS)
+    {
+      unsigned int const count = MIN(CHANNELS, pairs - first);
+      search16_stats_group(s, count, order.data() + first,
+                           qseqs, qlens, seqnos,
+                           pscores, paligned, pmatches,
+                           pmismatches, pgaps, plead, ptail);
+    }
+}
+
+/*
+  Compute an upper bound on the number of matches in any alignment of
+  the query with each of the target sequences, without traceback.
+
+  The bound is obtained from the indel distance, the number of
+  unmatched symbols (qlen + dlen - 2 * matches) when only matching
+  symbols may be aligned. Each channel holds a target and the
+  distances are computed with saturated unsigned 8-bit arithmetic,
+  with twice as many channels as search16. Saturated distances are
+  exactly min(distance, 255), so the bound remains valid, only weaker,
+  for long or dissimilar sequences.
+*/
+
+auto search8(s16info_s * s,
+             unsigned int sequences,
+             unsigned int * seqnos,
+             unsigned int * pmaxmatches) -> void
+{
+  constexpr auto channels8 = (int) sizeof(VECTOR_BYTE);
+  constexpr auto saturated = 255;
+  int const qlen = s->qlen;
+
+  if (s->qbytes == nullptr)
+    {
+      s->qbytes = (VECTOR_BYTE *) xmalloc_aligned(qlen * sizeof(VECTOR_BYTE),
+                                                  sizeof(VECTOR_BYTE));
+      s->dbytes = (VECTOR_BYTE *) xmalloc_aligned((qlen + 1) * sizeof(VECTOR_BYTE),
+                                                  sizeof(VECTOR_BYTE));
+      for (int i = 0; i < qlen; i++)
+        {
+          s->qbytes[i] = v8_dup(chrmap_4bit[(int) (s->qseq[i])]);
+        }
+    }
+
+  alignas(VECTOR_BYTE) unsigned char dsymbols[channels8];
+  alignas(VECTOR_BYTE) unsigned char distances[channels8];
+  char * dseq[channels8];
+  int64_t dlen[channels8];
+
+  VECTOR_BYTE const one = v8_dup(1);
+
+  for (unsigned int first = 0; first < sequences; first += channels8)
+    {
+      int const lanes = MIN(channels8, (int) (sequences - first));
+      int64_t maxdlen = 0;
+
+      for (int c = 0; c < channels8; c++)
+        {
+          if (c < lanes)
+            {
+              unsigned int const seqno = seqnos[first + c];
+              dseq[c] = db_getsequence(seqno);
+              dlen[c] = db_getsequencelen(seqno);
+              maxdlen = MAX(maxdlen, dlen[c]);
+              if (dlen[c] == 0)
+                {
+                  pmaxmatches[first + c] = 0;
+                }
+            }
+          else
+            {
+              dseq[c] = nullptr;
+              dlen[c] = 0;
+            }
+          dsymbols[c] = 0;
+        }
+
+      for (int i = 0; i <= qlen; i++)
+        {
+          s->dbytes[i] = v8_dup(MIN(i, saturated));
+        }
+
+      for (int64_t j = 0; j < maxdlen; j++)
+        {
+          for (int c = 0; c < lanes; c++)
+            {
+              dsymbols[c] = (j < dlen[c]) ? chrmap_4bit[(int) (dseq[c][j])] : 0;
+            }
+
+          VECTOR_BYTE const t = v8_load(dsymbols);
+          VECTOR_BYTE diag = s->dbytes[0];
+          VECTOR_BYTE h = v8_dup(MIN(j + 1, saturated));
+          s->dbytes[0] = h;
+
+          for (int i = 0; i < qlen; i++)
+            {
+              VECTOR_BYTE const left = s->dbytes[i + 1];
+              h = v8_min(v8_add(v8_min(h, left), one),
+                         v8_match(s->qbytes[i], t, diag));
+              s->dbytes[i + 1] = h;
+              diag = left;
+            }
+
+          bool stored = false;
+          for (int c = 0; c < lanes; c++)
+            {
+              if (dlen[c] == j + 1)
+                {
+                  if (not stored)
+                    {
+                      v8_store(distances, h);
+                      stored = true;
+                    }
+                  pmaxmatches[first + c] =
+                    (qlen + dlen[c] - distances[c]) / 2;
+                }
+            }
+        }
+    }
+}
+
+}  // namespace ALIGN_SIMD_VARIANT
+
+
+#if ! defined(AVX2) && ! defined(AVX512BW)
+
+/*
+  The functions below dispatch to the versions of the aligner
+  supported by the cpu. The wider versions only pay off when there are
+  enough target sequences to fill their channels, so each call to
+  search16 uses the narrowest version with at least as many channels
+  as there are sequences, or the widest one. The query is prepared for
+  a version the first time it is used.
+*/
+
+struct s16info_s
+{
+  align_simd_128::s16info_s * s128;
+#ifdef __x86_64__
+  align_simd_avx2::s16info_s * s256;
+  align_simd_avx512bw::s16info_s * s512;
+#endif
+  char * qseq;
+  int qlen;
+  bool prepared128;
+  bool prepared256;
+  bool prepared512;
+};
+
+
+auto search16_init(CELL score_match,
+                   CELL score_mismatch,
+                   CELL penalty_gap_open_query_left,
+                   CELL penalty_gap_open_target_left,
+                   CELL penalty_gap_open_query_interior,
+                   CELL penalty_gap_open_target_interior,
+                   CELL penalty_gap_open_query_right,
+                   CELL penalty_gap_open_target_right,
+                   CELL penalty_gap_extension_query_left,
+                   CELL penalty_gap_extension_target_left,
+                   CELL penalty_gap_extension_query_interior,
+                   CELL penalty_gap_extension_target_interior,
+                   CELL penalty_gap_extension_query_right,
+                   CELL penalty_gap_extension_target_right) -> struct s16info_s *
+{
+  auto * s = (struct s16info_s *) xmalloc(sizeof(struct s16info_s));
+
+  s->s128 = align_simd_128::search16_init(score_match,
+                                          score_mismatch,
+                                          penalty_gap_open_query_left,
+                                          penalty_gap_open_target_left,
+                                          penalty_gap_open_query_interior,
+                                          penalty_gap_open_target_interior,
+                                          penalty_gap_open_query_right,
+                                          penalty_gap_open_target_right,
+                                          penalty_gap_extension_query_left,
+                                          penalty_gap_extension_target_left,
+                                          penalty_gap_extension_query_interior,
+                                          penalty_gap_extension_target_interior,
+                                          penalty_gap_extension_query_right,
+                                          penalty_gap_extension_target_right);
+#ifdef __x86_64__
+  s->s256 = nullptr;
+  s->s512 = nullptr;
+  if (avx2_present)
+    {
+      s->s256 = align_simd_avx2::search16_init(score_match,
+                                               score_mismatch,
+                                               penalty_gap_open_query_left,
+                                               penalty_gap_open_target_left,
+                                               penalty_gap_open_query_interior,
+                                               penalty_gap_open_target_interior,
+                                               penalty_gap_open_query_right,
+                                               penalty_gap_open_target_right,
+                                               penalty_gap_extension_query_left,
+                                               penalty_gap_extension_target_left,
+                                               penalty_gap_extension_query_interior,
+                                               penalty_gap_extension_target_interior,
+                                               penalty_gap_extension_query_right,
+                                               penalty_gap_extension_target_right);
+    }
+  if (avx512bw_present)
+    {
+      s->s512 = align_simd_avx512bw::search16_init(score_match,
+                                                   score_mismatch,
+                                                   penalty_gap_open_query_left,
+                                                   penalty_gap_open_target_left,
+                                                   penalty_gap_open_query_interior,
+                                                   penalty_gap_open_target_interior,
+                                                   penalty_gap_open_query_right,
+                                                   penalty_gap_open_target_right,
+                                                   penalty_gap_extension_query_left,
+                                                   penalty_gap_extension_target_left,
+                                                   penalty_gap_extension_query_interior,
+                                                   penalty_gap_extension_target_interior,
+                                                   penalty_gap_extension_query_right,
+                                                   penalty_gap_extension_target_right);
+    }
+#endif
+  s->qseq = nullptr;
+  s->qlen = 0;
+  s->prepared128 = false;
+  s->prepared256 = false;
+  s->prepared512 = false;
+  return s;
+}
+
+
+auto search16_exit(struct s16info_s * s) -> void
+{
+  align_simd_128::search16_exit(s->s128);
+#ifdef __x86_64__
+  if (s->s256)
+    {
+      align_simd_avx2::search16_exit(s->s256);
+    }
+  if (s->s512)
+    {
+      align_simd_avx512bw::search16_exit(s->s512);
+    }
+#endif
+  xfree(s);
+}
+
+
+auto search16_set_arena(struct s16info_s * s, struct arena_s * arena) -> void
+{
+  /* with an arena, the alignment strings are allocated there instead
+     of individually, and must not be freed by the caller */
+  align_simd_128::search16_set_arena(s->s128, arena);
+#ifdef __x86_64__
+  if (s->s256)
+    {
+      align_simd_avx2::search16_set_arena(s->s256, arena);
+    }
+  if (s->s512)
+    {
+      align_simd_avx512bw::search16_set_arena(s->s512, arena);
+    }
+#endif
+}
+
+
+auto search16_set_xdrop(struct s16info_s * s, int64_t xdrop) -> void
+{
+  /* abandon the alignment of a target when the best score of a block
+     of columns drops more than xdrop below the best score so far */
+  align_simd_128::search16_set_xdrop(s->s128, xdrop);
+#ifdef __x86_64__
+  if (s->s256)
+    {
+      align_simd_avx2::search16_set_xdrop(s->s256, xdrop);
+    }
+  if (s->s512)
+    {
+      align_simd_avx512bw::search16_set_xdrop(s->s512, xdrop);
+    }
+#endif
+}
+
+
+auto search16_qprep(struct s16info_s * s, char * qseq, int qlen) -> void
+{
+  s->qseq = qseq;
+  s->qlen = qlen;
+  s->prepared128 = false;
+  s->prepared256 = false;
+  s->prepared512 = false;
+}
+
+
+auto search16(struct s16info_s * s,
+              unsigned int sequences,
+              unsigned int * seqnos,
+              CELL * pscores,
+              unsigned short * paligned,
+              unsigned short * pmatches,
+              unsigned short * pmismatches,
+              unsigned short * pgaps,
+              char ** pcigar) -> void
+{
+#ifdef __x86_64__
+  static constexpr auto channels128 = 8U;
+  static constexpr auto channels256 = 16U;
+
+  if (s->s512 and ((sequences > channels256) or
+                   ((sequences > channels128) and not s->s256)))
+    {
+      if (not s->prepared512)
+        {
+          align_simd_avx512bw::search16_qprep(s->s512, s->qseq, s->qlen);
+          s->prepared512 = true;
+        }
+      align_simd_avx512bw::search16(s->s512,
+                                    sequences, seqnos, pscores, paligned,
+                                    pmatches, pmismatches, pgaps, pcigar);
+      return;
+    }
+
+  if (s->s256 and (sequences > channels128))
+    {
+      if (not s->prepared256)
+        {
+          align_simd_avx2::search16_qprep(s->s256, s->qseq, s->qlen);
+          s->prepared256 = true;
+        }
+      align_simd_avx2::search16(s->s256,
+                                sequences, seqnos, pscores, paligned,
+                                pmatches, pmismatches, pgaps, pcigar);
+      return;
+    }
+#endif
+
+  if (not s->prepared128)
+    {
+      align_simd_128::search16_qprep(s->s128, s->qseq, s->qlen);
+      s->prepared128 = true;
+    }
+  align_simd_128::search16(s->s128,
+                           sequences, seqnos, pscores, paligned,
+                           pmatches, pmismatches, pgaps, pcigar);
+}
+
+
+auto search16_pairable(struct s16info_s * s, int64_t qlen, int64_t dlen) -> bool
+{
+  /* all versions use the same scores and limits */
+  return align_simd_128::search16_pairable(s->s128, qlen, dlen);
+}
+
+
+auto search16_pairs(struct s16info_s * s,
+                    unsigned int pairs,
+                    char ** qseqs,
+                    int * qlens,
+                    unsigned int * seqnos,
+                    CELL * pscores,
+                    unsigned short * paligned,
+                    unsigned short * pmatches,
+                    unsigned short * pmismatches,
+                    unsigned short * pgaps,
+                    char ** pcigar) -> void
+{
+  /* the queries of the pairs need no preparation */
+
+#ifdef __x86_64__
+  static constexpr auto channels128 = 8U;
+  static constexpr auto channels256 = 16U;
+
+  if (s->s512 and ((pairs > channels256) or
+                   ((pairs > channels128) and not s->s256)))
+    {
+      align_simd_avx512bw::search16_pairs(s->s512, pairs, qseqs, qlens,
+                                          seqnos, pscores, paligned,
+                                          pmatches, pmismatches, pgaps,
+                                          pcigar);
+      return;
+    }
+
+  if (s->s256 and (pairs > channels128))
+    {
+      align_simd_avx2::search16_pairs(s->s256, pairs, qseqs, qlens,
+                                      seqnos, pscores, paligned,
+                                      pmatches, pmismatches, pgaps,
+                                      pcigar);
+      return;
+    }
+#endif
+
+  align_simd_128::search16_pairs(s->s128, pairs, qseqs, qlens,
+                                 seqnos, pscores, paligned,
+                                 pmatches, pmismatches, pgaps,
+                                 pcigar);
+}
+
+
+auto search16_stats(struct s16info_s * s,
+                    unsigned int pairs,
+                    char ** qseqs,
+                    int * qlens,
+                    unsigned int * seqnos,
+                    CELL * pscores,
+                    unsigned short * paligned,
+                    unsigned short * pmatches,
+                    unsigned short * pmismatches,
+                    unsigned short * pgaps,
+                    short * plead,
+                    short * ptail) -> void
+{
+  /* the channels are filled as in search16_pairs */
+
+#ifdef __x86_64__
+  static constexpr auto channels128 = 8U;
+  static constexpr auto channels256 = 16U;
+
+  if (s->s512 and ((pairs > channels256) or
+                   ((pairs > channels128) and not s->s256)))
+    {
+      align_simd_avx512bw::search16_stats(s->s512, pairs, qseqs, qlens,
+                                          seqnos, pscores, paligned,
+                                          pmatches, pmismatches, pgaps,
+                                          plead, ptail);
+      return;
+    }
+
+  if (s->s256 and (pairs > channels128))
+    {
+      align_simd_avx2::search16_stats(s->s256, pairs, qseqs, qlens,
+                                      seqnos, pscores, paligned,
+                                      pmatches, pmismatches, pgaps,
+                                      plead, ptail);
+      return;
+    }
+#endif
+
+  align_simd_128::search16_stats(s->s128, pairs, qseqs, qlens,
+                                 seqnos, pscores, paligned,
+                                 pmatches, pmismatches, pgaps,
+                                 plead, ptail);
+}
+
+
+auto search8(struct s16info_s * s,
+             unsigned int sequences,
+             unsigned int * seqnos,
+             unsigned int * pmaxmatches) -> void
+{
+  /* search8 has twice as many channels as search16 */
+
+#ifdef __x86_64__
+  static constexpr auto channels128 = 16U;
+  static constexpr auto channels256 = 32U;
+
+  if (s->s512 and ((sequences > channels256) or
+                   ((sequences > channels128) and not s->s256)))
+    {
+      if (not s->prepared512)
+        {
+          align_simd_avx512bw::search16_qprep(s->s512, s->qseq, s->qlen);
+          s->prepared512 = true;
+        }
+      align_simd_avx512bw::search8(s->s512, sequences, seqnos, pmaxmatches);
+      return;
+    }
+
+  if (s->s256 and (sequences > channels128))
+    {
+      if (not s->prepared256)
+        {
+          align_simd_avx2::search16_qprep(s->s256, s->qseq, s->qlen);
+          s->prepared256 = true;
+        }
+      align_simd_avx2::search8(s->s256, sequences, seqnos, pmaxmatches);
+      return;
+    }
+#endif
+
+  if (not s->prepared128)
+    {
+      align_simd_128::search16_qprep(s->s128, s->qseq, s->qlen);
+      s->prepared128 = true;
+    }
+  align_simd_128::search8(s->s128, sequences, seqnos, pmaxmatches);
+}
+
+#endif
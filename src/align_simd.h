@@ -61,37 +61,22 @@
 using CELL = signed short;
 using WORD = unsigned short;
 using BYTE = unsigned char;
-struct s16info_s;
+struct arena_s;
 
 
-auto search16_init(CELL score_match,
-                   CELL score_mismatch,
-                   CELL penalty_gap_open_query_left,
-                   CELL penalty_gap_open_target_left,
-                   CELL penalty_gap_open_query_interior,
-                   CELL penalty_gap_open_target_interior,
-                   CELL penalty_gap_open_query_right,
-                   CELL penalty_gap_open_target_right,
-                   CELL penalty_gap_extension_query_left,
-                   CELL penalty_gap_extension_target_left,
-                   CELL penalty_gap_extension_query_interior,
-                   CELL penalty_gap_extension_target_interior,
-                   CELL penalty_gap_extension_query_right,
-                   CELL penalty_gap_extension_target_right) -> struct s16info_s *;
+#include "align_simd_api.h"
 
 
-auto search16_exit(s16info_s * s) -> void;
+/* wider versions of the aligner, selected at runtime by search16_init */
 
+#ifdef __x86_64__
 
-auto search16_qprep(s16info_s * s, char * qseq, int qlen) -> void;
+namespace align_simd_avx2 {
+#include "align_simd_api.h"
+}  // namespace align_simd_avx2
 
+namespace align_simd_avx512bw {
+#include "align_simd_api.h"
+}  // namespace align_simd_avx512bw
 
-auto search16(s16info_s * s,
-              unsigned int sequences,
-              unsigned int * seqnos,
-              CELL * pscores,
-              unsigned short * paligned,
-              unsigned short * pmatches,
-              unsigned short * pmismatches,
-              unsigned short * pgaps,
-              char * * pcigar) -> void;
+#endif
@@ -0,0 +1,132 @@
+/*
+
+  VSEARCH: a versatile open source tool for metagenomics
+
+  Copyright (C) 2014-2024, Torbjorn Rognes, Frederic Mahe and Tomas Flouri
+  All rights reserved.
+
+  Contact: Torbjorn Rognes <torognes@ifi.uio.no>,
+  Department of Informatics, University of Oslo,
+  PO Box 1080 Blindern, NO-0316 Oslo, Norway
+
+  This software is dual-licensed and available under a choice
+  of one of two licenses, either under the terms of the GNU
+  General Public License version 3 or the BSD 2-Clause License.
+
+
+  GNU General Public License version 3
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+  The BSD 2-Clause License
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*
+  Interface of one version of the SIMD aligner. Included by
+  align_simd.h at global scope, for the version selected at runtime,
+  and once inside the namespace of each wider version.
+*/
+
+struct s16info_s;
+
+auto search16_init(CELL score_match,
+                   CELL score_mismatch,
+                   CELL penalty_gap_open_query_left,
+                   CELL penalty_gap_open_target_left,
+                   CELL penalty_gap_open_query_interior,
+                   CELL penalty_gap_open_target_interior,
+                   CELL penalty_gap_open_query_right,
+                   CELL penalty_gap_open_target_right,
+                   CELL penalty_gap_extension_query_left,
+                   CELL penalty_gap_extension_target_left,
+                   CELL penalty_gap_extension_query_interior,
+                   CELL penalty_gap_extension_target_interior,
+                   CELL penalty_gap_extension_query_right,
+                   CELL penalty_gap_extension_target_right) -> struct s16info_s *;
+
+auto search16_exit(s16info_s * s) -> void;
+
+auto search16_qprep(s16info_s * s, char * qseq, int qlen) -> void;
+
+auto search16_set_arena(s16info_s * s, struct arena_s * arena) -> void;
+
+auto search16_set_xdrop(s16info_s * s, int64_t xdrop) -> void;
+
+auto search16(s16info_s * s,
+              unsigned int sequences,
+              unsigned int * seqnos,
+              CELL * pscores,
+              unsigned short * paligned,
+              unsigned short * pmatches,
+              unsigned short * pmismatches,
+              unsigned short * pgaps,
+              char * * pcigar) -> void;
+
+auto search16_pairable(s16info_s * s, int64_t qlen, int64_t dlen) -> bool;
+
+auto search16_pairs(s16info_s * s,
+                    unsigned int pairs,
+                    char * * qseqs,
+                    int * qlens,
+                    unsigned int * seqnos,
+                    CELL * pscores,
+                    unsigned short * paligned,
+                    unsigned short * pmatches,
+                    unsigned short * pmismatches,
+                    unsigned short * pgaps,
+                    char * * pcigar) -> void;
+
+auto search16_stats(s16info_s * s,
+                    unsigned int pairs,
+                    char * * qseqs,
+                    int * qlens,
+                    unsigned int * seqnos,
+                    CELL * pscores,
+                    unsigned short * paligned,
+                    unsigned short * pmatches,
+                    unsigned short * pmismatches,
+                    unsigned short * pgaps,
+                    short * plead,
+                    short * ptail) -> void;
+
+auto search8(s16info_s * s,
+             unsigned int sequences,
+             unsigned int * seqnos,
+             unsigned int * pmaxmatches) -> void;
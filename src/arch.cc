@@ -62,8 +62,16 @@
 #include "dynlibs.h"
 #include <cstdio>  // std::FILE
 #include <cstdint>  // uint64_t
-#include <cstdlib>  // std::realloc, std::free
+#include <cstdlib>  // std::realloc, std::free, std::getenv
 #include <string.h>  // strcasestr
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>  // _get_osfhandle
+#else
+#include <sys/mman.h>  // mmap, munmap, madvise
+#endif
 
 
 const int memalignment = 16;
@@ -211,15 +219,22 @@ auto arch_random() -> uint64_t
 
 auto xmalloc(size_t size) -> void *
 {
+  return xmalloc_aligned(size, memalignment);
+}
+
+auto xmalloc_aligned(size_t size, size_t alignment) -> void *
+{
+  /* alignment must be a power of two, at least memalignment */
+  /* the memory must not be reallocated with xrealloc */
   if (size == 0)
     {
       size = 1;
     }
   void * t = nullptr;
 #ifdef _WIN32
-  t = _aligned_malloc(size, memalignment);
+  t = _aligned_malloc(size, alignment);
 #else
-  if (posix_memalign(& t, memalignment, size))
+  if (posix_memalign(& t, alignment, size))
     {
       t = nullptr;
     }
@@ -301,6 +316,33 @@ auto xftello(std::FILE * stream) -> uint64_t
 #endif
 }
 
+auto xfseeko(std::FILE * stream, int64_t offset, int whence) -> int
+{
+#ifdef _WIN32
+  return _fseeki64(stream, offset, whence);
+#else
+  return fseeko(stream, offset, whence);
+#endif
+}
+
+auto xftruncate(int file_descriptor, uint64_t length) -> int
+{
+#ifdef _WIN32
+  return _chsize_s(file_descriptor, length);
+#else
+  return ftruncate(file_descriptor, length);
+#endif
+}
+
+auto xfsync(int file_descriptor) -> int
+{
+#ifdef _WIN32
+  return _commit(file_descriptor);
+#else
+  return fsync(file_descriptor);
+#endif
+}
+
 auto xopen_read(const char * path) -> int
 {
 #ifdef _WIN32
@@ -323,6 +365,103 @@ auto xopen_write(const char * path) -> int
 #endif
 }
 
+auto xtmpfile() -> std::FILE *
+{
+  /*
+    Open a new temporary file for reading and writing, in the
+    directory given by the TMPDIR environment variable or in /tmp.
+    The file is removed when it is closed.
+  */
+
+#ifdef _WIN32
+  return std::tmpfile();
+#else
+  char const * directory = std::getenv("TMPDIR");
+  if ((directory == nullptr) or (*directory == 0))
+    {
+      directory = "/tmp";
+    }
+  std::string const pattern = std::string(directory) + "/vsearch.XXXXXX";
+  std::vector<char> path(pattern.begin(), pattern.end());
+  path.push_back('\0');
+  int const file_descriptor = mkstemp(path.data());
+  if (file_descriptor < 0)
+    {
+      return nullptr;
+    }
+  unlink(path.data());
+  return fdopen(file_descriptor, "w+b");
+#endif
+}
+
+auto xmmap_read(int file_descriptor, uint64_t length) -> void *
+{
+  /*
+    Map a file read-only into memory. The pages are shared with the
+    page cache and with other processes mapping the same file, and
+    must never be written to. Returns nullptr if the file cannot be
+    mapped.
+  */
+
+  if (length == 0)
+    {
+      return nullptr;
+    }
+#ifdef _WIN32
+  auto * file_handle = (HANDLE) _get_osfhandle(file_descriptor);
+  HANDLE mapping = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY,
+                                      0, 0, nullptr);
+  if (mapping == nullptr)
+    {
+      return nullptr;
+    }
+  void * address = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, length);
+  CloseHandle(mapping);
+  return address;
+#else
+  void * address = mmap(nullptr, length, PROT_READ,
+                        MAP_PRIVATE, file_descriptor, 0);
+  if (address == MAP_FAILED)
+    {
+      return nullptr;
+    }
+  return address;
+#endif
+}
+
+auto xmunmap(void * address, uint64_t length) -> void
+{
+#ifdef _WIN32
+  (void) length;
+  UnmapViewOfFile(address);
+#else
+  munmap(address, length);
+#endif
+}
+
+auto xmadvise_dontneed(void * address, uint64_t length) -> void
+{
+  /*
+    Release the pages of a read-only file mapping that lie entirely
+    within the given range. They are read again from the file if
+    accessed later.
+  */
+
+#ifdef _WIN32
+  (void) address;
+  (void) length;
+#else
+  auto const page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+  auto const start = reinterpret_cast<uintptr_t>(address);
+  uintptr_t const first = (start + page - 1) & ~(page - 1);
+  uintptr_t const last = (start + length) & ~(page - 1);
+  if (first < last)
+    {
+      madvise(reinterpret_cast<void *>(first), last - first, MADV_DONTNEED);
+    }
+#endif
+}
+
 auto xstrcasestr(const char * haystack, const char * needle) -> const char *
 {
 #ifdef _WIN32
@@ -75,6 +75,7 @@ auto arch_get_user_system_time(double * user_time, double * system_time) -> void
 auto arch_srandom() -> void;
 auto arch_random() -> uint64_t;
 auto xmalloc(std::size_t size) -> void *;
+auto xmalloc_aligned(std::size_t size, std::size_t alignment) -> void *;
 auto xrealloc(void * ptr, std::size_t size) -> void *;
 auto xfree(void * ptr) -> void;
 
@@ -82,9 +83,17 @@ auto xfstat(int file_descriptor, xstat_t * buf) -> int;
 auto xstat(const char * path, xstat_t  * buf) -> int;
 auto xlseek(int file_descriptor, uint64_t offset, int whence) -> uint64_t;
 auto xftello(std::FILE * stream) -> uint64_t;
+auto xfseeko(std::FILE * stream, int64_t offset, int whence) -> int;
+auto xftruncate(int file_descriptor, uint64_t length) -> int;
+auto xfsync(int file_descriptor) -> int;
 
 auto xopen_read(const char * path) -> int;
 auto xopen_write(const char * path) -> int;
+auto xtmpfile() -> std::FILE *;
+
+auto xmmap_read(int file_descriptor, uint64_t length) -> void *;
+auto xmunmap(void * address, uint64_t length) -> void;
+auto xmadvise_dontneed(void * address, uint64_t length) -> void;
 
 auto xstrcasestr(const char * haystack, const char * needle) -> const char *;
 
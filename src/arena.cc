@@ -0,0 +1,148 @@
+/*
+
+  VSEARCH: a versatile open source tool for metagenomics
+
+  Copyright (C) 2014-2024, Torbjorn Rognes, Frederic Mahe and Tomas Flouri
+  All rights reserved.
+
+  Contact: Torbjorn Rognes <torognes@ifi.uio.no>,
+  Department of Informatics, University of Oslo,
+  PO Box 1080 Blindern, NO-0316 Oslo, Norway
+
+  This software is dual-licensed and available under a choice
+  of one of two licenses, either under the terms of the GNU
+  General Public License version 3 or the BSD 2-Clause License.
+
+
+  GNU General Public License version 3
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+  The BSD 2-Clause License
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "vsearch.h"
+#include "arena.h"
+#include <algorithm>  // std::max
+#include <cstddef>  // std::size_t
+#include <cstring>  // std::memcpy, std::strlen
+#include <vector>
+
+
+/* smallest chunk, larger requests get a chunk of their own size */
+constexpr std::size_t arena_chunk_size = 1 << 16;
+
+/* all allocations are aligned to this size */
+constexpr std::size_t arena_alignment = alignof(std::max_align_t);
+
+struct arena_chunk_s
+{
+  char * memory;
+  std::size_t size;
+};
+
+struct arena_s
+{
+  std::vector<struct arena_chunk_s> chunks;
+  std::size_t current;  /* chunk in use */
+  std::size_t used;     /* bytes used in that chunk */
+};
+
+
+auto arena_init() -> struct arena_s *
+{
+  auto * a = new struct arena_s;
+  a->current = 0;
+  a->used = 0;
+  return a;
+}
+
+
+auto arena_exit(struct arena_s * a) -> void
+{
+  for (auto & chunk : a->chunks)
+    {
+      xfree(chunk.memory);
+    }
+  delete a;
+}
+
+
+auto arena_alloc(struct arena_s * a, std::size_t size) -> void *
+{
+  size = (size + arena_alignment - 1) & ~(arena_alignment - 1);
+
+  /* move on to the next chunk large enough, allocate one if needed */
+  while ((a->current < a->chunks.size()) and
+         (a->used + size > a->chunks[a->current].size))
+    {
+      ++a->current;
+      a->used = 0;
+    }
+
+  if (a->current == a->chunks.size())
+    {
+      struct arena_chunk_s chunk;
+      chunk.size = std::max(size, arena_chunk_size);
+      chunk.memory = (char *) xmalloc(chunk.size);
+      a->chunks.push_back(chunk);
+      a->used = 0;
+    }
+
+  void * p = a->chunks[a->current].memory + a->used;
+  a->used += size;
+  return p;
+}
+
+
+auto arena_strdup(struct arena_s * a, const char * s) -> char *
+{
+  std::size_t const size = std::strlen(s) + 1;
+  auto * p = (char *) arena_alloc(a, size);
+  std::memcpy(p, s, size);
+  return p;
+}
+
+
+auto arena_reset(struct arena_s * a) -> void
+{
+  a->current = 0;
+  a->used = 0;
+}
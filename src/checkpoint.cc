@@ -0,0 +1,434 @@
+/*
+
+  VSEARCH: a versatile open source tool for metagenomics
+
+  Copyright (C) 2014-2024, Torbjorn Rognes, Frederic Mahe and Tomas Flouri
+  All rights reserved.
+
+  Contact: Torbjorn Rognes <torognes@ifi.uio.no>,
+  Department of Informatics, University of Oslo,
+  PO Box 1080 Blindern, NO-0316 Oslo, Norway
+
+  This software is dual-licensed and available under a choice
+  of one of two licenses, either under the terms of the GNU
+  General Public License version 3 or the BSD 2-Clause License.
+
+
+  GNU General Public License version 3
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+  The BSD 2-Clause License
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "vsearch.h"
+#include "checkpoint.h"
+#include "md5.h"
+#include <algorithm>  // std::sort, std::find
+#include <cstdint>  // uint32_t, uint64_t
+#include <cstdio>  // std::FILE, std::fopen, std::fread, std::fwrite
+#include <cstring>  // std::memcmp, std::memcpy, std::strcmp, std::strncpy
+#include <ctime>  // std::time
+#include <iterator>  // std::begin, std::end
+#include <string>
+#include <vector>
+
+
+/* all numbers are stored in the byte order of the machine */
+constexpr uint32_t checkpoint_magic = 0x50435356;  /* "VSCP" */
+constexpr uint32_t checkpoint_version = 2;
+constexpr uint32_t checkpoint_block_start = 0x4b4c4342;  /* "BCLK" */
+constexpr uint32_t checkpoint_block_end = 0x444e4542;  /* "BEND" */
+constexpr std::size_t checkpoint_command_length = 32;
+
+struct checkpoint_header_s
+{
+  uint32_t magic;
+  uint32_t version;
+  char command[checkpoint_command_length];
+  unsigned char options[md5_digest_length];  /* digest of the options */
+  uint64_t input_size;  /* 0 if unknown, e.g. for stdin */
+  int64_t input_mtime;
+  uint64_t sequences;
+  uint64_t nucleotides;
+  uint64_t outputs;
+};
+
+/* options that cannot change the results or the output files */
+static char const * const checkpoint_ignored_options[] =
+  {
+    "checkpoint",
+    "checkpoint_interval",
+    "log",
+    "no_progress",
+    "quiet",
+    "resume",
+    "threads"
+  };
+
+/* followed by the records, the output lengths and the end mark */
+struct checkpoint_block_s
+{
+  uint32_t magic;
+  uint32_t outputs;
+  uint64_t sequences;  /* processed so far */
+  uint64_t length;     /* of the records */
+};
+
+static std::FILE * fp_checkpoint = nullptr;
+static std::vector<std::FILE *> checkpoint_outputs;
+static std::vector<char> checkpoint_records;   /* since the last block */
+static std::vector<char> checkpoint_restored;  /* of all blocks, on resume */
+static std::size_t checkpoint_restored_used = 0;
+static uint64_t checkpoint_sequences = 0;
+static std::time_t checkpoint_last = 0;
+static std::vector<std::string> checkpoint_options;  /* "name=value" */
+
+
+auto checkpoint_option(const char * name, const char * value) -> void
+{
+  if (std::find_if(std::begin(checkpoint_ignored_options),
+                   std::end(checkpoint_ignored_options),
+                   [name](char const * ignored) {
+                     return std::strcmp(name, ignored) == 0;
+                   }) != std::end(checkpoint_ignored_options))
+    {
+      return;
+    }
+  checkpoint_options.push_back(std::string(name) + "=" +
+                               (value != nullptr ? value : ""));
+}
+
+
+auto checkpoint_options_digest(unsigned char * digest) -> void
+{
+  /* the order of the options on the command line does not matter */
+  std::vector<std::string> options = checkpoint_options;
+  std::sort(options.begin(), options.end());
+  std::string all;
+  for (auto const & option : options)
+    {
+      all += option;
+      all += '\n';
+    }
+  MD5_CTX context;
+  MD5_Init(&context);
+  MD5_Update(&context, &all[0], all.size());
+  MD5_Final(digest, &context);
+}
+
+
+auto checkpoint_fopen_output(const char * filename) -> std::FILE *
+{
+  /*
+    Open an output file written while the sequences are processed.
+    With --resume the existing file is opened for update and cut to
+    its checkpointed length later by checkpoint_open.
+  */
+
+  if (not opt_checkpoint)
+    {
+      return fopen_output(filename);
+    }
+
+  if (std::strcmp(filename, "-") == 0)
+    {
+      fatal("Output to stdout is not possible with --checkpoint");
+    }
+
+  std::FILE * fp = std::fopen(filename, opt_resume ? "r+" : "w");
+  if (fp)
+    {
+      checkpoint_outputs.push_back(fp);
+    }
+  return fp;
+}
+
+
+auto checkpoint_file_size(std::FILE * fp) -> uint64_t
+{
+  xstat_t fs;
+  if (xfstat(fileno(fp), &fs) != 0)
+    {
+      fatal("Unable to get size of checkpoint or output file");
+    }
+  return fs.st_size;
+}
+
+
+auto checkpoint_restore(struct checkpoint_header_s const & header) -> void
+{
+  fp_checkpoint = std::fopen(opt_checkpoint, "r+b");
+  if (not fp_checkpoint)
+    {
+      fatal("Unable to open checkpoint file %s for reading", opt_checkpoint);
+    }
+
+  struct checkpoint_header_s saved;
+  if ((std::fread(&saved, sizeof(saved), 1, fp_checkpoint) != 1) or
+      (saved.magic != checkpoint_magic) or
+      (saved.version != checkpoint_version))
+    {
+      fatal("Invalid checkpoint file %s", opt_checkpoint);
+    }
+
+  if ((std::strncmp(saved.command, header.command,
+                    checkpoint_command_length) != 0) or
+      (saved.sequences != header.sequences) or
+      (saved.nucleotides != header.nucleotides) or
+      (saved.outputs != header.outputs))
+    {
+      fatal("The checkpoint file %s is from another command, input or "
+            "set of output files", opt_checkpoint);
+    }
+
+  if ((std::memcmp(saved.options, header.options, md5_digest_length) != 0) or
+      (saved.input_size != header.input_size) or
+      (saved.input_mtime != header.input_mtime))
+    {
+      fatal("The checkpoint file %s was written with other options or "
+            "another version of the input file", opt_checkpoint);
+    }
+
+  /* read the complete blocks, the last one may be incomplete if the
+     run was stopped while it was written */
+
+  uint64_t const size = checkpoint_file_size(fp_checkpoint);
+  uint64_t end = sizeof(saved);
+  std::vector<uint64_t> lengths(header.outputs, 0);
+  std::vector<uint64_t> block_lengths(header.outputs);
+
+  while (true)
+    {
+      struct checkpoint_block_s block;
+      if ((std::fread(&block, sizeof(block), 1, fp_checkpoint) != 1) or
+          (block.magic != checkpoint_block_start) or
+          (block.outputs != header.outputs) or
+          (block.length > size - end))
+        {
+          break;
+        }
+
+      auto const used = checkpoint_restored.size();
+      checkpoint_restored.resize(used + block.length);
+      uint32_t tail = 0;
+      if (((block.length > 0) and
+           (std::fread(checkpoint_restored.data() + used,
+                       block.length, 1, fp_checkpoint) != 1)) or
+          ((header.outputs > 0) and
+           (std::fread(block_lengths.data(), sizeof(uint64_t),
+                       header.outputs, fp_checkpoint) != header.outputs)) or
+          (std::fread(&tail, sizeof(tail), 1, fp_checkpoint) != 1) or
+          (tail != checkpoint_block_end))
+        {
+          checkpoint_restored.resize(used);
+          break;
+        }
+
+      lengths = block_lengths;
+      checkpoint_sequences = block.sequences;
+      end += sizeof(block) + block.length +
+        header.outputs * sizeof(uint64_t) + sizeof(tail);
+    }
+
+  /* drop any incomplete block, new blocks are appended after the
+     last complete one */
+
+  if (xftruncate(fileno(fp_checkpoint), end) != 0)
+    {
+      fatal("Unable to truncate checkpoint file %s", opt_checkpoint);
+    }
+  std::fseek(fp_checkpoint, 0, SEEK_END);
+
+  /* remove the output written after the last checkpoint */
+
+  for (std::size_t i = 0; i < checkpoint_outputs.size(); i++)
+    {
+      std::FILE * fp = checkpoint_outputs[i];
+      if (checkpoint_file_size(fp) < lengths[i])
+        {
+          fatal("An output file is shorter than recorded in the checkpoint");
+        }
+      if (xftruncate(fileno(fp), lengths[i]) != 0)
+        {
+          fatal("Unable to truncate output file");
+        }
+      std::fseek(fp, 0, SEEK_END);
+    }
+}
+
+
+auto checkpoint_open(const char * command,
+                     const char * input_filename,
+                     uint64_t sequences,
+                     uint64_t nucleotides) -> void
+{
+  if (not opt_checkpoint)
+    {
+      return;
+    }
+
+  struct checkpoint_header_s header;
+  std::memset(&header, 0, sizeof(header));
+  header.magic = checkpoint_magic;
+  header.version = checkpoint_version;
+  std::strncpy(header.command, command, checkpoint_command_length - 1);
+  checkpoint_options_digest(header.options);
+  xstat_t fs;
+  if ((std::strcmp(input_filename, "-") != 0) and
+      (xstat(input_filename, &fs) == 0))
+    {
+      header.input_size = fs.st_size;
+      header.input_mtime = fs.st_mtime;
+    }
+  header.sequences = sequences;
+  header.nucleotides = nucleotides;
+  header.outputs = checkpoint_outputs.size();
+
+  if (opt_resume)
+    {
+      checkpoint_restore(header);
+    }
+  else
+    {
+      fp_checkpoint = std::fopen(opt_checkpoint, "wb");
+      if (not fp_checkpoint)
+        {
+          fatal("Unable to open checkpoint file %s for writing",
+                opt_checkpoint);
+        }
+      if ((std::fwrite(&header, sizeof(header), 1, fp_checkpoint) != 1) or
+          (std::fflush(fp_checkpoint) != 0))
+        {
+          fatal("Unable to write to checkpoint file %s", opt_checkpoint);
+        }
+    }
+
+  checkpoint_last = std::time(nullptr);
+}
+
+
+auto checkpoint_close() -> void
+{
+  if (fp_checkpoint)
+    {
+      std::fclose(fp_checkpoint);
+      fp_checkpoint = nullptr;
+    }
+  checkpoint_outputs.clear();
+  checkpoint_records.clear();
+  checkpoint_restored.clear();
+  checkpoint_restored.shrink_to_fit();
+  checkpoint_restored_used = 0;
+  checkpoint_sequences = 0;
+}
+
+
+auto checkpoint_resumed() -> uint64_t
+{
+  /* number of sequences processed before the resumed run */
+  return checkpoint_sequences;
+}
+
+
+auto checkpoint_read(void * data, std::size_t length) -> void
+{
+  if (checkpoint_restored_used + length > checkpoint_restored.size())
+    {
+      fatal("Invalid checkpoint file %s", opt_checkpoint);
+    }
+  std::memcpy(data,
+              checkpoint_restored.data() + checkpoint_restored_used,
+              length);
+  checkpoint_restored_used += length;
+}
+
+
+auto checkpoint_write(const void * data, std::size_t length) -> void
+{
+  auto const * bytes = static_cast<const char *>(data);
+  checkpoint_records.insert(checkpoint_records.end(), bytes, bytes + length);
+}
+
+
+auto checkpoint_due() -> bool
+{
+  return (fp_checkpoint != nullptr) and
+    (std::time(nullptr) - checkpoint_last >= opt_checkpoint_interval);
+}
+
+
+auto checkpoint_commit(uint64_t sequences) -> void
+{
+  /* the output must be on disk before the block refers to it */
+
+  std::vector<uint64_t> lengths;
+  for (std::FILE * fp : checkpoint_outputs)
+    {
+      if ((std::fflush(fp) != 0) or (xfsync(fileno(fp)) != 0))
+        {
+          fatal("Unable to write to output file");
+        }
+      lengths.push_back(xftello(fp));
+    }
+
+  struct checkpoint_block_s block;
+  block.magic = checkpoint_block_start;
+  block.outputs = checkpoint_outputs.size();
+  block.sequences = sequences;
+  block.length = checkpoint_records.size();
+
+  if ((std::fwrite(&block, sizeof(block), 1, fp_checkpoint) != 1) or
+      ((block.length > 0) and
+       (std::fwrite(checkpoint_records.data(), block.length, 1,
+                    fp_checkpoint) != 1)) or
+      (std::fwrite(lengths.data(), sizeof(uint64_t), lengths.size(),
+                   fp_checkpoint) != lengths.size()) or
+      (std::fwrite(&checkpoint_block_end, sizeof(checkpoint_block_end), 1,
+                   fp_checkpoint) != 1) or
+      (std::fflush(fp_checkpoint) != 0) or
+      (xfsync(fileno(fp_checkpoint)) != 0))
+    {
+      fatal("Unable to write to checkpoint file %s", opt_checkpoint);
+    }
+
+  checkpoint_records.clear();
+  checkpoint_last = std::time(nullptr);
+}
@@ -0,0 +1,98 @@
+/*
+
+  VSEARCH: a versatile open source tool for metagenomics
+
+  Copyright (C) 2014-2024, Torbjorn Rognes, Frederic Mahe and Tomas Flouri
+  All rights reserved.
+
+  Contact: Torbjorn Rognes <torognes@ifi.uio.no>,
+  Department of Informatics, University of Oslo,
+  PO Box 1080 Blindern, NO-0316 Oslo, Norway
+
+  This software is dual-licensed and available under a choice
+  of one of two licenses, either under the terms of the GNU
+  General Public License version 3 or the BSD 2-Clause License.
+
+
+  GNU General Public License version 3
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+  The BSD 2-Clause License
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <cstddef>  // std::size_t
+#include <cstdint>  // uint64_t
+#include <cstdio>  // std::FILE
+
+
+/*
+  Checkpoints of long clustering and chimera detection runs
+  (--checkpoint, --resume). The checkpoint file is a journal, written
+  sequentially: a header identifying the command, a digest of the
+  options given (see checkpoint_option) and the size and modification
+  time of the input file, followed by a block at each checkpoint with
+  the records of the sequences processed since the previous one, the
+  number of sequences processed so far and the length of each output
+  file.
+  When resuming, the records of all complete blocks are read back,
+  and the output files are cut to the lengths of the last block.
+*/
+
+auto checkpoint_option(const char * name, const char * value) -> void;
+
+auto checkpoint_fopen_output(const char * filename) -> std::FILE *;
+
+auto checkpoint_open(const char * command,
+                     const char * input_filename,
+                     uint64_t sequences,
+                     uint64_t nucleotides) -> void;
+
+auto checkpoint_close() -> void;
+
+auto checkpoint_resumed() -> uint64_t;
+
+auto checkpoint_read(void * data, std::size_t length) -> void;
+
+auto checkpoint_write(const void * data, std::size_t length) -> void;
+
+auto checkpoint_due() -> bool;
+
+auto checkpoint_commit(uint64_t sequences) -> void;
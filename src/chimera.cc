@@ -60,7 +60,9 @@
 
 #include "vsearch.h"
 #include "align_simd.h"
+#include "arena.h"
 #include "attributes.h"
+#include "checkpoint.h"
 #include "chimera.h"
 #include "dbindex.h"
 #include "maps.h"
@@ -1682,9 +1684,12 @@ auto query_init(struct searchinfo_s * si) -> void
   si->qsequence = nullptr;
   si->kmers = nullptr;
   si->hits = (struct hit *) xmalloc(sizeof(struct hit) * tophits);
-  si->kmers = (count_t *) xmalloc((db_getsequencecount() * sizeof(count_t)) + 32);
+  search_kmers_init(si, db_getsequencecount());
   si->hit_count = 0;
   si->uh = unique_init();
+  si->lma = nullptr;
+  si->lma_scorematrix = nullptr;
+  si->arena = arena_init();
   si->s = search16_init(opt_match,
                         opt_mismatch,
                         opt_gap_open_query_left,
@@ -1699,6 +1704,8 @@ auto query_init(struct searchinfo_s * si) -> void
                         opt_gap_extension_target_interior,
                         opt_gap_extension_query_right,
                         opt_gap_extension_target_right);
+  search16_set_arena(si->s, si->arena);
+  si->stats_only = false;
   si->m = minheap_init(tophits);
 }
 
@@ -1706,6 +1713,8 @@ auto query_init(struct searchinfo_s * si) -> void
 auto query_exit(struct searchinfo_s * si) -> void
 {
   search16_exit(si->s);
+  search_lma_exit(si);
+  arena_exit(si->arena);
   unique_exit(si->uh);
   minheap_exit(si->m);
 
@@ -1719,11 +1728,7 @@ auto query_exit(struct searchinfo_s * si) -> void
       xfree(si->hits);
       si->hits = nullptr;
     }
-  if (si->kmers)
-    {
-      xfree(si->kmers);
-      si->kmers = nullptr;
-    }
+  search_kmers_exit(si);
 }
 
 
@@ -1975,7 +1980,6 @@ auto chimera_thread_core(struct chimera_info_s * ci) -> uint64_t
                       allhits_list[allhits_count++] = hits[j];
                     }
                 }
-              xfree(hits);
             }
         }
 
@@ -1997,13 +2001,12 @@ auto chimera_thread_core(struct chimera_info_s * ci) -> uint64_t
             {
               ci->cand_list[ci->cand_count++] = target;
             }
+        }
 
-          /* deallocate cigar */
-          if (allhits_list[i].nwalignment)
-            {
-              xfree(allhits_list[i].nwalignment);
-              allhits_list[i].nwalignment = nullptr;
-            }
+      /* release the hits and cigars of the partial searches */
+      for (int i = 0; i < parts; i++)
+        {
+          arena_reset(ci->si[i].arena);
         }
 
 
@@ -2219,6 +2222,16 @@ auto chimera_thread_core(struct chimera_info_s * ci) -> uint64_t
             }
         }
 
+      if (opt_checkpoint)
+        {
+          auto const record = static_cast<char>(status);
+          checkpoint_write(&record, 1);
+          if (checkpoint_due())
+            {
+              checkpoint_commit(seqno + 1);
+            }
+        }
+
       for (int i = 0; i < ci->cand_count; i++)
         {
           if (ci->nwcigar[i])
@@ -2283,11 +2296,53 @@ auto chimera_threads_run() -> void
   xpthread_attr_destroy(&attr);
 }
 
+
+auto chimera_resume() -> void
+{
+  /*
+    Restore the state after the queries processed before the last
+    checkpoint in the de novo modes: the counts, and the non-chimeras
+    added to the database. Their output is already in the files.
+  */
+
+  auto const resumed = checkpoint_resumed();
+
+  for (seqno = 0; seqno < resumed; seqno++)
+    {
+      char status = 0;
+      checkpoint_read(&status, 1);
+
+      int64_t const size = db_getabundance(seqno);
+      ++total_count;
+      total_abundance += size;
+
+      if (status == 4)
+        {
+          ++chimera_count;
+          chimera_abundance += size;
+        }
+      else if (status == 3)
+        {
+          ++borderline_count;
+          borderline_abundance += size;
+        }
+      else
+        {
+          ++nonchimera_count;
+          nonchimera_abundance += size;
+          dbindex_addsequence(seqno, opt_qmask);
+        }
+
+      progress += db_getsequencelen(seqno);
+    }
+}
+
+
 auto open_chimera_file(FILE ** f, char * name) -> void
 {
   if (name)
     {
-      *f = fopen_output(name);
+      *f = checkpoint_fopen_output(name);
       if (not *f)
         {
           fatal("Unable to open file %s for writing", name);
@@ -2363,10 +2418,14 @@ auto chimera() -> void
   xpthread_mutex_init(&mutex_output, nullptr);
 
   char * denovo_dbname = nullptr;
+  char const * denovo_command = nullptr;
 
   /* prepare queries / database */
   if (opt_uchime_ref)
     {
+      /* keep the k-mer index compressed while it is built or read */
+      dbindex_setcompressed(opt_compress_index);
+
       /* check if the reference database may be an UDB file */
 
       auto const is_udb = udb_detect_isudb(opt_db);
@@ -2399,18 +2458,22 @@ auto chimera() -> void
       if (opt_uchime_denovo)
         {
           denovo_dbname = opt_uchime_denovo;
+          denovo_command = "uchime_denovo";
         }
       else if (opt_uchime2_denovo)
         {
           denovo_dbname = opt_uchime2_denovo;
+          denovo_command = "uchime2_denovo";
         }
       else if (opt_uchime3_denovo)
         {
           denovo_dbname = opt_uchime3_denovo;
+          denovo_command = "uchime3_denovo";
         }
       else if (opt_chimeras_denovo)
         {
           denovo_dbname = opt_chimeras_denovo;
+          denovo_command = "chimeras_denovo";
         }
       else {
         fatal("Internal error");
@@ -2427,9 +2490,13 @@ auto chimera() -> void
           hardmask_all();
         }
 
-      db_sortbyabundance();
+      db_sortbyabundance(0);
       dbindex_prepare(1, opt_qmask);
       progress_total = db_getnucleotidecount();
+
+      checkpoint_open(denovo_command, denovo_dbname,
+                      db_getsequencecount(), progress_total);
+      chimera_resume();
     }
 
   if (opt_log)
@@ -2474,6 +2541,8 @@ auto chimera() -> void
 
   progress_done();
 
+  checkpoint_close();
+
   if (not opt_quiet)
     {
       if (total_count > 0)
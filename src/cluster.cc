@@ -61,13 +61,15 @@
 #include "vsearch.h"
 #include "align_simd.h"
 #include "attributes.h"
+#include "checkpoint.h"
 #include "dbindex.h"
 #include "mask.h"
 #include "minheap.h"
 #include "msa.h"
 #include "otutable.h"
+#include "udb.h"
 #include "unique.h"
-#include <algorithm>  // std::count, std::minmax_element, std::max_element, std::min
+#include <algorithm>  // std::count, std::minmax_element, std::min
 #include <cinttypes>  // macros PRIu64 and PRId64
 #include <climits>  // INT_MAX, LONG_MAX
 #include <cstdint>  // int64_t, uint64_t
@@ -76,12 +78,13 @@
 #include <cstring>  // std::strcpy, std::strlen
 #include <limits>
 #include <pthread.h>
-#include <utility>  // std::get
+#include <utility>  // std::get, std::move
 #include <vector>
 
 
 static int tophits; /* the maximum number of hits to keep */
 static int seqcount; /* number of database sequences */
+static int fixedcount = 0; /* centroids read with --db, before the input */
 
 struct clusterinfo_s
 {
@@ -121,6 +124,19 @@ static pthread_attr_t attr;
 static struct searchinfo_s * si_plus;
 static struct searchinfo_s * si_minus;
 
+/* the most queries per thread in a round of cluster_core_parallel */
+constexpr auto cluster_max_queries_per_thread = 4;
+
+/* work of the threads: searching the queries of the round, or
+   comparing them with the earlier queries of the round, or aligning
+   the clusters of a round of multiple alignments */
+constexpr auto cluster_work_search = 1;
+constexpr auto cluster_work_compare = 2;
+constexpr auto cluster_work_msa = 3;
+
+/* the most sequences in a round of multiple alignments */
+constexpr auto cluster_msa_round_sequences = 1 << 14;
+
 struct thread_info_s
 {
   pthread_t thread;
@@ -131,6 +147,41 @@ struct thread_info_s
   int query_count;
 };
 
+/* comparison of a query with an earlier query of the same round */
+
+struct cluster_pair_s
+{
+  int first;                       /* round index of the earlier query */
+  unsigned int shared;             /* number of shared unique kmers */
+  bool aligned;                    /* the results of search16 are set */
+  CELL score;
+  unsigned short alignmentlength;
+  unsigned short matches;
+  unsigned short mismatches;
+  unsigned short gaps;
+  char * cigar;
+};
+
+/* round indices of the queries that found no hit in their search */
+static std::vector<int> round_candidates;
+
+/* comparisons with the candidates, for each query and strand */
+static std::vector<std::vector<struct cluster_pair_s>> round_pairs;
+
+/* a cluster of a round of multiple alignments: its sequences in
+   clusterinfo, and its alignment once computed */
+
+struct cluster_msa_s
+{
+  int first;
+  int count;
+  struct msa_s * msa;
+};
+
+static std::vector<struct cluster_msa_s> round_msa;
+static int round_msa_next;
+static pthread_mutex_t mutex_msa;
+
 using thread_info_t = struct thread_info_s;
 
 static thread_info_t * ti;
@@ -219,6 +270,92 @@ inline auto cluster_query_core(struct searchinfo_s * si) -> void
   search_onequery(si, opt_qmask);
 }
 
+inline auto cluster_compare_worker(int64_t t) -> void
+{
+  /*
+    Compare the queries of the thread with the candidates found earlier
+    in the round. These are the queries most likely to become new
+    centroids, and the main thread must then count their shared kmers
+    with the later queries of the round and align them. The results
+    are the same as the ones it would compute, so they are done here
+    in parallel and kept in round_pairs.
+  */
+  for (int q = 0; q < ti[t].query_count; q++)
+    {
+      int const i = ti[t].query_first + q;
+      for (int s = 0; s < opt_strand; s++)
+        {
+          struct searchinfo_s * si = s ? si_minus + i : si_plus + i;
+          auto & pairs = round_pairs[(i * opt_strand) + s];
+
+          for (int const k : round_candidates)
+            {
+              if (k >= i)
+                {
+                  break;
+                }
+
+              struct searchinfo_s * sic = si_plus + k;
+              struct cluster_pair_s pair {};
+              pair.first = k;
+              pair.shared = unique_count_shared(si->uh,
+                                                opt_wordlength,
+                                                sic->kmersamplecount,
+                                                sic->kmersample);
+              pair.aligned = false;
+              pair.cigar = nullptr;
+
+              if (search_enough_kmers(si, pair.shared) and
+                  search_acceptable_unaligned(si, sic->query_no))
+                {
+                  unsigned int target = sic->query_no;
+                  search16(si->s,
+                           1,
+                           & target,
+                           & pair.score,
+                           & pair.alignmentlength,
+                           & pair.matches,
+                           & pair.mismatches,
+                           & pair.gaps,
+                           & pair.cigar);
+                  pair.aligned = true;
+                }
+
+              pairs.push_back(pair);
+            }
+        }
+    }
+}
+
+inline auto cluster_pair_find(int query, int strand, int first)
+  -> struct cluster_pair_s *
+{
+  for (auto & pair : round_pairs[(query * opt_strand) + strand])
+    {
+      if (pair.first == first)
+        {
+          return & pair;
+        }
+    }
+  return nullptr;
+}
+
+inline auto cluster_pairs_free(int query) -> void
+{
+  for (int s = 0; s < opt_strand; s++)
+    {
+      auto & pairs = round_pairs[(query * opt_strand) + s];
+      for (auto & pair : pairs)
+        {
+          if (pair.cigar)
+            {
+              xfree(pair.cigar);
+            }
+        }
+      pairs.clear();
+    }
+}
+
 inline auto cluster_worker(int64_t t) -> void
 {
   /* wrapper for the main threaded core function for clustering */
@@ -232,6 +369,40 @@ inline auto cluster_worker(int64_t t) -> void
     }
 }
 
+auto cluster_msa_compute(struct cluster_msa_s & c) -> void
+{
+  std::vector<struct msa_target_s> targets(c.count);
+  for (int j = 0; j < c.count; j++)
+    {
+      clusterinfo_t const & info = clusterinfo[c.first + j];
+      targets[j].seqno = info.seqno;
+      targets[j].cigar = info.cigar;
+      targets[j].strand = info.strand;
+    }
+  int const clusterno = clusterinfo[c.first].clusterno;
+  c.msa = msa_compute(clusterno, std::move(targets),
+                      cluster_abundance[clusterno]);
+}
+
+
+inline auto cluster_msa_worker() -> void
+{
+  /* take the clusters of the round in turn, they vary in size */
+  while (true)
+    {
+      xpthread_mutex_lock(&mutex_msa);
+      int const i = round_msa_next;
+      ++round_msa_next;
+      xpthread_mutex_unlock(&mutex_msa);
+
+      if (i >= static_cast<int>(round_msa.size()))
+        {
+          break;
+        }
+      cluster_msa_compute(round_msa[i]);
+    }
+}
+
 auto threads_worker(void * vp) -> void *
 {
   auto t = (int64_t) vp;
@@ -247,7 +418,18 @@ auto threads_worker(void * vp) -> void *
         }
       if (tip->work > 0)
         {
-          cluster_worker(t);
+          if (tip->work == cluster_work_compare)
+            {
+              cluster_compare_worker(t);
+            }
+          else if (tip->work == cluster_work_msa)
+            {
+              cluster_msa_worker();
+            }
+          else
+            {
+              cluster_worker(t);
+            }
           tip->work = 0;
           xpthread_cond_signal(&tip->cond);
         }
@@ -256,7 +438,7 @@ auto threads_worker(void * vp) -> void *
   return nullptr;
 }
 
-auto threads_wakeup(int queries) -> void
+auto threads_wakeup(int queries, int work) -> void
 {
   int const threads = queries > opt_threads ? opt_threads : queries;
   int queries_rest = queries;
@@ -275,7 +457,7 @@ auto threads_wakeup(int queries) -> void
       --threads_rest;
 
       xpthread_mutex_lock(&tip->mutex);
-      tip->work = 1;
+      tip->work = work;
       xpthread_cond_signal(&tip->cond);
       xpthread_mutex_unlock(&tip->mutex);
     }
@@ -342,6 +524,9 @@ auto cluster_query_init(struct searchinfo_s * si) -> void
 
   si->qsize = 1;
   si->nw = nullptr;
+  si->lma = nullptr;
+  si->lma_scorematrix = nullptr;
+  si->arena = nullptr;
   si->hit_count = 0;
 
   /* allocate memory for sequence */
@@ -349,7 +534,7 @@ auto cluster_query_init(struct searchinfo_s * si) -> void
   si->seq_alloc = db_getlongestsequence() + 1;
   si->qsequence = (char *) xmalloc(si->seq_alloc);
 
-  si->kmers = (count_t *) xmalloc((seqcount * sizeof(count_t)) + 32);
+  search_kmers_init(si, seqcount);
   si->hits = (struct hit *) xmalloc(sizeof(struct hit) * tophits);
 
   si->uh = unique_init();
@@ -368,6 +553,8 @@ auto cluster_query_init(struct searchinfo_s * si) -> void
                         opt_gap_extension_target_interior,
                         opt_gap_extension_query_right,
                         opt_gap_extension_target_right);
+  search16_set_xdrop(si->s, opt_xdrop_nw);
+  si->stats_only = not search_alignments_needed();
 }
 
 
@@ -376,6 +563,7 @@ auto cluster_query_exit(struct searchinfo_s * si) -> void
   /* clean up after thread execution; called once per thread */
 
   search16_exit(si->s);
+  search_lma_exit(si);
   unique_exit(si->uh);
   minheap_exit(si->m);
 
@@ -387,10 +575,7 @@ auto cluster_query_exit(struct searchinfo_s * si) -> void
     {
       xfree(si->hits);
     }
-  if (si->kmers)
-    {
-      xfree(si->kmers);
-    }
+  search_kmers_exit(si);
 }
 
 
@@ -423,6 +608,26 @@ auto relabel_otu(int clusterno, char * sequence, int seqlen) -> char *
 }
 
 
+auto cluster_otutable_add(char * query_head,
+                          int centroid,
+                          int clusterno,
+                          int64_t qsize) -> void
+{
+  if (opt_relabel or opt_relabel_self or opt_relabel_sha1 or opt_relabel_md5)
+    {
+      char * label = relabel_otu(clusterno,
+                                 db_getsequence(centroid),
+                                 db_getsequencelen(centroid));
+      otutable_add(query_head, label, qsize);
+      xfree(label);
+    }
+  else
+    {
+      otutable_add(query_head, db_getheader(centroid), qsize);
+    }
+}
+
+
 auto cluster_core_results_hit(struct hit * best,
                               int clusterno,
                               char * query_head,
@@ -435,20 +640,7 @@ auto cluster_core_results_hit(struct hit * best,
 
   if (opt_otutabout or opt_mothur_shared_out or opt_biomout)
     {
-      if (opt_relabel or opt_relabel_self or opt_relabel_sha1 or opt_relabel_md5)
-        {
-          char * label = relabel_otu(clusterno,
-                                     db_getsequence(best->target),
-                                     db_getsequencelen(best->target));
-          otutable_add(query_head, label, qsize);
-          xfree(label);
-        }
-      else
-        {
-          otutable_add(query_head,
-                       db_getheader(best->target),
-                       qsize);
-        }
+      cluster_otutable_add(query_head, best->target, clusterno, qsize);
     }
 
   if (fp_uc)
@@ -592,6 +784,19 @@ auto cluster_core_results_nohit(int clusterno,
 }
 
 
+auto cluster_checkpoint_write(int seqno) -> void
+{
+  /* the clustering of a query, as needed to resume after it */
+  clusterinfo_t const & info = clusterinfo[seqno];
+  int32_t const record[3] =
+    { info.clusterno,
+      info.strand,
+      info.cigar ? static_cast<int32_t>(strlen(info.cigar)) : 0 };
+  checkpoint_write(record, sizeof(record));
+  checkpoint_write(info.cigar, record[2]);
+}
+
+
 auto compare_kmersample(const void * a, const void * b) -> int
 {
   unsigned int const x = * (unsigned int *) a;
@@ -612,13 +817,15 @@ auto compare_kmersample(const void * a, const void * b) -> int
 }
 
 
-auto cluster_core_parallel() -> void
+auto cluster_core_parallel(int first) -> void
 {
   /* create threads and set them in stand-by mode */
   threads_init();
 
-  constexpr static int queries_per_thread = 1;
-  const int max_queries = queries_per_thread * opt_threads;
+  /* queries per thread in a round, adapted to the rate of new
+     centroids at the end of each round */
+  int queries_per_thread = 1;
+  const int max_queries = cluster_max_queries_per_thread * opt_threads;
 
   /* allocate memory for the search information for each query;
      and initialize it */
@@ -641,6 +848,7 @@ auto cluster_core_parallel() -> void
     }
 
   std::vector<int> extra_list(max_queries);
+  round_pairs.resize(max_queries * opt_strand);
 
   LinearMemoryAligner lma;
   int64_t * scorematrix = lma.scorematrix_create(opt_match, opt_mismatch);
@@ -658,11 +866,16 @@ auto cluster_core_parallel() -> void
                      opt_gap_extension_query_right,
                      opt_gap_extension_target_right);
 
-  int lastlength = INT_MAX;
+  int lastlength = (first > fixedcount) ?
+    db_getsequencelen(first - 1) : INT_MAX;
 
-  int seqno = 0;
+  int seqno = first;
 
   int64_t sum_nucleotides = 0;
+  for (int i = 0; i < first; i++)
+    {
+      sum_nucleotides += db_getsequencelen(i);
+    }
 
   progress_init("Clustering", db_getnucleotidecount());
 
@@ -673,7 +886,7 @@ auto cluster_core_parallel() -> void
 
       int queries = 0;
 
-      for (int i = 0; i < max_queries; i++)
+      for (int i = 0; i < queries_per_thread * opt_threads; i++)
         {
           if (seqno < seqcount)
             {
@@ -703,7 +916,26 @@ auto cluster_core_parallel() -> void
         }
 
       /* perform work in threads */
-      threads_wakeup(queries);
+      threads_wakeup(queries, cluster_work_search);
+
+      /* compare the queries with the earlier queries of the round that
+         found no hit, as these will probably become new centroids */
+      round_candidates.clear();
+      for (int i = 0; i < queries - 1; i++)
+        {
+          if ((si_plus[i].accepts == 0) and
+              ((opt_strand == 1) or (si_minus[i].accepts == 0)))
+            {
+              round_candidates.push_back(i);
+            }
+        }
+
+      if (not round_candidates.empty())
+        {
+          threads_wakeup(queries, cluster_work_compare);
+        }
+
+      int const round_first = si_plus[0].query_no;
 
       /* analyse results */
       int extra_count = 0;
@@ -727,13 +959,15 @@ auto cluster_core_parallel() -> void
                   for (int j = 0; j < extra_count; j++)
                     {
                       struct searchinfo_s * sic = si_plus + extra_list[j];
+                      struct cluster_pair_s const * pair
+                        = cluster_pair_find(i, s, extra_list[j]);
 
                       /* find the number of shared unique kmers */
-                      unsigned int const shared
-                        = unique_count_shared(si->uh,
-                                              opt_wordlength,
-                                              sic->kmersamplecount,
-                                              sic->kmersample);
+                      unsigned int const shared = pair ? pair->shared :
+                        unique_count_shared(si->uh,
+                                            opt_wordlength,
+                                            sic->kmersamplecount,
+                                            sic->kmersample);
 
                       /* check if min number of shared kmers is satisfied */
                       if (search_enough_kmers(si, shared))
@@ -842,15 +1076,46 @@ auto cluster_core_parallel() -> void
                               unsigned short snwmismatches = 0;
                               unsigned short snwgaps = 0;
 
-                              search16(si->s,
-                                       1,
-                                       & nwtarget,
-                                       & snwscore,
-                                       & snwalignmentlength,
-                                       & snwmatches,
-                                       & snwmismatches,
-                                       & snwgaps,
-                                       & nwcigar);
+                              /* the target may have been aligned
+                                 already by cluster_compare_worker */
+                              struct cluster_pair_s * pair = nullptr;
+                              if ((int) target >= round_first)
+                                {
+                                  pair = cluster_pair_find(i, s,
+                                                           target - round_first);
+                                }
+
+                              if (pair and pair->aligned)
+                                {
+                                  snwscore = pair->score;
+                                  snwalignmentlength = pair->alignmentlength;
+                                  snwmatches = pair->matches;
+                                  snwmismatches = pair->mismatches;
+                                  snwgaps = pair->gaps;
+                                  nwcigar = pair->cigar;
+                                  pair->cigar = nullptr;
+                                }
+                              else
+                                {
+                                  search16(si->s,
+                                           1,
+                                           & nwtarget,
+                                           & snwscore,
+                                           & snwalignmentlength,
+                                           & snwmatches,
+                                           & snwmismatches,
+                                           & snwgaps,
+                                           & nwcigar);
+                                }
+
+                              if (snwscore == std::numeric_limits<short>::min())
+                                {
+                                  /* abandoned by the x-drop test */
+                                  xfree(nwcigar);
+                                  hit->rejected = true;
+                                  ++si->rejects;
+                                  continue;
+                                }
 
                               int64_t const tseqlen = db_getsequencelen(target);
 
@@ -1017,6 +1282,11 @@ auto cluster_core_parallel() -> void
               ++clusters;
             }
 
+          if (opt_checkpoint)
+            {
+              cluster_checkpoint_write(myseqno);
+            }
+
           /* free alignments */
           for (int s = 0; s < opt_strand; s++)
             {
@@ -1033,13 +1303,37 @@ auto cluster_core_parallel() -> void
                 }
             }
 
+          cluster_pairs_free(i);
+
           sum_nucleotides += si_p->qseqlen;
         }
 
+      /* The main thread compares each query with the new centroids
+         found earlier in its round, so the rounds are made longer
+         while few queries become centroids, and shorter when many do.
+         The results do not depend on the length of the rounds. */
+      if ((extra_count * 8 < queries) and
+          (queries_per_thread < cluster_max_queries_per_thread))
+        {
+          queries_per_thread *= 2;
+        }
+      else if ((extra_count * 2 > queries) and (queries_per_thread > 1))
+        {
+          queries_per_thread /= 2;
+        }
+
       progress_update(sum_nucleotides);
+
+      if (checkpoint_due())
+        {
+          checkpoint_commit(seqno);
+        }
     }
   progress_done();
 
+  round_pairs.clear();
+  round_candidates.clear();
+
   /* clean up search info */
   for (int i = 0; i < max_queries; i++)
     {
@@ -1065,7 +1359,7 @@ auto cluster_core_parallel() -> void
 }
 
 
-auto cluster_core_serial() -> void
+auto cluster_core_serial(int first) -> void
 {
   struct searchinfo_s si_p[1];
   struct searchinfo_s si_m[1];
@@ -1076,10 +1370,11 @@ auto cluster_core_serial() -> void
       cluster_query_init(si_m);
     }
 
-  int lastlength = INT_MAX;
+  int lastlength = (first > fixedcount) ?
+    db_getsequencelen(first - 1) : INT_MAX;
 
   progress_init("Clustering", seqcount);
-  for (int seqno=0; seqno<seqcount; seqno++)
+  for (int seqno = first; seqno < seqcount; seqno++)
     {
       int const length = db_getsequencelen(seqno);
 
@@ -1145,6 +1440,15 @@ auto cluster_core_serial() -> void
           ++clusters;
         }
 
+      if (opt_checkpoint)
+        {
+          cluster_checkpoint_write(seqno);
+          if (checkpoint_due())
+            {
+              checkpoint_commit(seqno + 1);
+            }
+        }
+
       /* free alignments */
       for (int s = 0; s < opt_strand; s++)
         {
@@ -1173,13 +1477,105 @@ auto cluster_core_serial() -> void
 }
 
 
+auto cluster_core_fixed() -> void
+{
+  /*
+    The centroids read with --db are the first sequences, each one
+    starts its own cluster in the given order. They are added to the
+    index without any search and are not reported as queries, so
+    only the new sequences are clustered, in the usual greedy order.
+  */
+
+  for (int seqno = 0; seqno < fixedcount; seqno++)
+    {
+      clusterinfo[seqno].seqno = seqno;
+      clusterinfo[seqno].clusterno = clusters;
+      clusterinfo[seqno].cigar = nullptr;
+      clusterinfo[seqno].strand = 0;
+      dbindex_addsequence(seqno, opt_qmask);
+      ++clusters;
+    }
+}
+
+
+auto cluster_core_resume() -> int
+{
+  /*
+    Restore the clustering of the queries processed before the last
+    checkpoint: their cluster info, the new centroids in the index,
+    the counts of matched and unmatched queries and the OTU table.
+    Their output is already in the output files. Returns the first
+    query left to cluster.
+  */
+
+  int const resumed = checkpoint_resumed();
+  if (resumed <= fixedcount)
+    {
+      return fixedcount;
+    }
+
+  std::vector<int> centroids(fixedcount);
+  for (int i = 0; i < fixedcount; i++)
+    {
+      centroids[i] = i;
+    }
+
+  for (int seqno = fixedcount; seqno < resumed; seqno++)
+    {
+      int32_t record[3];
+      checkpoint_read(record, sizeof(record));
+      int const clusterno = record[0];
+
+      if ((clusterno < 0) or (clusterno > clusters) or (record[2] < 0))
+        {
+          fatal("Invalid checkpoint file %s", opt_checkpoint);
+        }
+
+      char * cigar = nullptr;
+      if (record[2] > 0)
+        {
+          cigar = (char *) xmalloc(record[2] + 1);
+          checkpoint_read(cigar, record[2]);
+          cigar[record[2]] = 0;
+        }
+
+      clusterinfo[seqno].seqno = seqno;
+      clusterinfo[seqno].clusterno = clusterno;
+      clusterinfo[seqno].cigar = cigar;
+      clusterinfo[seqno].strand = record[1];
+
+      if (clusterno == clusters)
+        {
+          dbindex_addsequence(seqno, opt_qmask);
+          centroids.push_back(seqno);
+          ++count_notmatched;
+          ++clusters;
+        }
+      else
+        {
+          ++count_matched;
+        }
+
+      if (opt_otutabout or opt_mothur_shared_out or opt_biomout)
+        {
+          cluster_otutable_add(db_getheader(seqno),
+                               centroids[clusterno],
+                               clusterno,
+                               db_getabundance(seqno));
+        }
+    }
+
+  return resumed;
+}
+
+
 auto cluster(char * dbname,
              char * cmdline,
              char * progheader) -> void
 {
   if (opt_centroids)
     {
-      fp_centroids = fopen_output(opt_centroids);
+      fp_centroids = checkpoint_fopen_output(opt_centroids);
       if (not fp_centroids)
         {
           fatal("Unable to open centroids file for writing");
@@ -1188,7 +1584,7 @@ auto cluster(char * dbname,
 
   if (opt_uc)
     {
-      fp_uc = fopen_output(opt_uc);
+      fp_uc = checkpoint_fopen_output(opt_uc);
       if (not fp_uc)
         {
           fatal("Unable to open uc file for writing");
@@ -1197,19 +1593,22 @@ auto cluster(char * dbname,
 
   if (opt_alnout)
     {
-      fp_alnout = fopen_output(opt_alnout);
+      fp_alnout = checkpoint_fopen_output(opt_alnout);
       if (not fp_alnout)
         {
           fatal("Unable to open alignment output file for writing");
         }
 
-      fprintf(fp_alnout, "%s\n", cmdline);
-      fprintf(fp_alnout, "%s\n", progheader);
+      if (not opt_resume)
+        {
+          fprintf(fp_alnout, "%s\n", cmdline);
+          fprintf(fp_alnout, "%s\n", progheader);
+        }
     }
 
   if (opt_samout)
     {
-      fp_samout = fopen_output(opt_samout);
+      fp_samout = checkpoint_fopen_output(opt_samout);
       if (not fp_samout)
         {
           fatal("Unable to open SAM output file for writing");
@@ -1218,7 +1617,7 @@ auto cluster(char * dbname,
 
   if (opt_userout)
     {
-      fp_userout = fopen_output(opt_userout);
+      fp_userout = checkpoint_fopen_output(opt_userout);
       if (not fp_userout)
         {
           fatal("Unable to open user-defined output file for writing");
@@ -1227,7 +1626,7 @@ auto cluster(char * dbname,
 
   if (opt_blast6out)
     {
-      fp_blast6out = fopen_output(opt_blast6out);
+      fp_blast6out = checkpoint_fopen_output(opt_blast6out);
       if (not fp_blast6out)
         {
           fatal("Unable to open blast6-like output file for writing");
@@ -1236,7 +1635,7 @@ auto cluster(char * dbname,
 
   if (opt_fastapairs)
     {
-      fp_fastapairs = fopen_output(opt_fastapairs);
+      fp_fastapairs = checkpoint_fopen_output(opt_fastapairs);
       if (not fp_fastapairs)
         {
           fatal("Unable to open fastapairs output file for writing");
@@ -1245,7 +1644,7 @@ auto cluster(char * dbname,
 
   if (opt_qsegout)
     {
-      fp_qsegout = fopen_output(opt_qsegout);
+      fp_qsegout = checkpoint_fopen_output(opt_qsegout);
       if (not fp_qsegout)
         {
           fatal("Unable to open qsegout output file for writing");
@@ -1254,7 +1653,7 @@ auto cluster(char * dbname,
 
   if (opt_tsegout)
     {
-      fp_tsegout = fopen_output(opt_tsegout);
+      fp_tsegout = checkpoint_fopen_output(opt_tsegout);
       if (not fp_tsegout)
         {
           fatal("Unable to open tsegout output file for writing");
@@ -1263,7 +1662,7 @@ auto cluster(char * dbname,
 
   if (opt_matched)
     {
-      fp_matched = fopen_output(opt_matched);
+      fp_matched = checkpoint_fopen_output(opt_matched);
       if (not fp_matched)
         {
           fatal("Unable to open matched output file for writing");
@@ -1272,7 +1671,7 @@ auto cluster(char * dbname,
 
   if (opt_notmatched)
     {
-      fp_notmatched = fopen_output(opt_notmatched);
+      fp_notmatched = checkpoint_fopen_output(opt_notmatched);
       if (not fp_notmatched)
         {
           fatal("Unable to open notmatched output file for writing");
@@ -1281,7 +1680,7 @@ auto cluster(char * dbname,
 
   if (opt_otutabout)
     {
-      fp_otutabout = fopen_output(opt_otutabout);
+      fp_otutabout = checkpoint_fopen_output(opt_otutabout);
       if (not fp_otutabout)
         {
           fatal("Unable to open OTU table (text format) output file for writing");
@@ -1290,7 +1689,7 @@ auto cluster(char * dbname,
 
   if (opt_mothur_shared_out)
     {
-      fp_mothur_shared_out = fopen_output(opt_mothur_shared_out);
+      fp_mothur_shared_out = checkpoint_fopen_output(opt_mothur_shared_out);
       if (not fp_mothur_shared_out)
         {
           fatal("Unable to open OTU table (mothur format) output file for writing");
@@ -1299,18 +1698,41 @@ auto cluster(char * dbname,
 
   if (opt_biomout)
     {
-      fp_biomout = fopen_output(opt_biomout);
+      fp_biomout = checkpoint_fopen_output(opt_biomout);
       if (not fp_biomout)
         {
           fatal("Unable to open OTU table (biom 1.0 format) output file for writing");
         }
     }
 
-  db_read(dbname, 0);
+  if (opt_db)
+    {
+      /* existing centroids first, then the new sequences */
+      if (udb_detect_isudb(opt_db))
+        {
+          udb_read(opt_db, false, true);
+          fixedcount = db_getsequencecount();
+          db_append(dbname, 0);
+          dbindex_free();
+        }
+      else
+        {
+          db_read(opt_db, 0);
+          fixedcount = db_getsequencecount();
+          db_append(dbname, 0);
+        }
+    }
+  else
+    {
+      db_read(dbname, 0);
+    }
 
   otutable_init();
 
-  results_show_samheader(fp_samout, cmdline, dbname);
+  if (not opt_resume)
+    {
+      results_show_samheader(fp_samout, cmdline, dbname);
+    }
 
   if (opt_qmask == MASK_DUST)
     {
@@ -1327,11 +1749,11 @@ auto cluster(char * dbname,
 
   if (opt_cluster_fast)
     {
-      db_sortbylength();
+      db_sortbylength(fixedcount);
     }
   else if (opt_cluster_size or opt_cluster_unoise)
     {
-      db_sortbyabundance();
+      db_sortbyabundance(fixedcount);
     }
 
   dbindex_prepare(1, opt_qmask);
@@ -1370,28 +1792,39 @@ auto cluster(char * dbname,
       fprintf(fp_log, "\n");
     }
 
+  cluster_core_fixed();
+
+  checkpoint_open(opt_cluster_fast ? "cluster_fast" :
+                  opt_cluster_size ? "cluster_size" :
+                  opt_cluster_unoise ? "cluster_unoise" : "cluster_smallmem",
+                  dbname,
+                  seqcount,
+                  db_getnucleotidecount());
+
+  int const first = cluster_core_resume();
+
   if (opt_threads == 1)
     {
-      cluster_core_serial();
+      cluster_core_serial(first);
     }
   else
     {
-      cluster_core_parallel();
+      cluster_core_parallel(first);
     }
 
+  checkpoint_close();
+
 
-  /* find size and abundance of each cluster and save stats */
+  /* find abundance of each cluster and save stats */
 
   std::vector<int64_t> cluster_abundance_v(clusters);
   cluster_abundance = cluster_abundance_v.data();
-  std::vector<int> cluster_size(clusters);
 
   for (int i = 0; i < seqcount; i++)
     {
       int const seqno = clusterinfo_v[i].seqno;
       int const clusterno = clusterinfo_v[i].clusterno;
       cluster_abundance_v[clusterno] += opt_sizein ? db_getabundance(seqno) : 1;
-      ++cluster_size[clusterno];
     }
 
   auto const minmax_elements = std::minmax_element(cluster_abundance_v.cbegin(),
@@ -1400,9 +1833,6 @@ auto cluster(char * dbname,
   auto const abundance_max = *std::get<1>(minmax_elements);
   int const singletons = std::count(cluster_abundance_v.cbegin(),
                                     cluster_abundance_v.cend(), int64_t{1});
-  auto const max_element = std::max_element(cluster_size.cbegin(),
-                                            cluster_size.cend());
-  auto const size_max = *max_element;
 
 
   /* Sort sequences in clusters by their abundance or ordinal number */
@@ -1577,8 +2007,6 @@ auto cluster(char * dbname,
 
   if (opt_msaout or opt_consout or opt_profile)
     {
-      int msa_target_count = 0;
-      std::vector<struct msa_target_s> msa_target_list_v(size_max);
       progress_init("Multiple alignments", seqcount);
 
       std::FILE * fp_msaout = nullptr;
@@ -1612,47 +2040,67 @@ auto cluster(char * dbname,
             }
         }
 
-      lastcluster = -1;
+      /* The clusters are aligned in rounds, in parallel with several
+         threads, and written in their order at the end of each round */
 
-      for (int i = 0; i < seqcount; i++)
+      if (opt_threads > 1)
         {
-          int const clusterno = clusterinfo_v[i].clusterno;
-          int const seqno = clusterinfo_v[i].seqno;
-          char * cigar = clusterinfo_v[i].cigar;
-          int const strand = clusterinfo_v[i].strand;
+          threads_init();
+          xpthread_mutex_init(&mutex_msa, nullptr);
+        }
 
-          if (clusterno != lastcluster)
+      int i = 0;
+      while (i < seqcount)
+        {
+          round_msa.clear();
+          int round_sequences = 0;
+          while ((i < seqcount) and
+                 (round_sequences < cluster_msa_round_sequences))
             {
-              if (lastcluster != -1)
+              struct cluster_msa_s c;
+              c.first = i;
+              c.count = 0;
+              c.msa = nullptr;
+              int const clusterno = clusterinfo_v[i].clusterno;
+              while ((i < seqcount) and
+                     (clusterinfo_v[i].clusterno == clusterno))
                 {
-                  /* compute msa & consensus */
-                  msa(fp_msaout, fp_consout, fp_profile,
-                      lastcluster,
-                      msa_target_count, msa_target_list_v,
-                      cluster_abundance_v[lastcluster]);
+                  ++c.count;
+                  ++i;
                 }
+              round_sequences += c.count;
+              round_msa.push_back(c);
+            }
 
-              /* start new cluster */
-              msa_target_count = 0;
-              lastcluster = clusterno;
+          if (opt_threads > 1)
+            {
+              round_msa_next = 0;
+              threads_wakeup(std::min(static_cast<int>(round_msa.size()),
+                                      static_cast<int>(opt_threads)),
+                             cluster_work_msa);
+            }
+          else
+            {
+              for (auto & c : round_msa)
+                {
+                  cluster_msa_compute(c);
+                }
             }
 
-          /* add current sequence to the cluster */
-          msa_target_list_v[msa_target_count].seqno = seqno;
-          msa_target_list_v[msa_target_count].cigar = cigar;
-          msa_target_list_v[msa_target_count].strand = strand;
-          ++msa_target_count;
+          for (auto & c : round_msa)
+            {
+              msa_print(c.msa, fp_msaout, fp_consout, fp_profile);
+            }
 
           progress_update(i);
         }
 
-      if (lastcluster != -1)
+      round_msa.clear();
+
+      if (opt_threads > 1)
         {
-          /* compute msa & consensus */
-          msa(fp_msaout, fp_consout, fp_profile,
-              lastcluster,
-              msa_target_count, msa_target_list_v,
-              cluster_abundance_v[lastcluster]);
+          xpthread_mutex_destroy(&mutex_msa);
+          threads_exit();
         }
 
       progress_done();
@@ -1674,7 +2122,6 @@ auto cluster(char * dbname,
     }
 
   // cluster_abundance not used below that point
-  // cluster_size not used below that point
 
   /* free cigar strings for all aligned sequences */
 
@@ -60,6 +60,7 @@
 
 #include "vsearch.h"
 #include <cstdint>  // int32_t
+#include <cstring>  // std::memcpy
 
 
 /* This file contains code dependent on special cpu features. */
@@ -150,6 +151,101 @@ void increment_counters_from_bitmap(count_t * counters,
     }
 }
 
+#elif defined(AVX2)
+
+#include <immintrin.h>
+
+void increment_counters_from_bitmap_avx2(count_t * counters,
+                                         unsigned char * bitmap,
+                                         unsigned int totalbits)
+{
+  /*
+    Same as the SSSE3 version below, but 32 bits of the bitmap are
+    expanded at a time into 32 bytes with either 0x00 or 0xFF, and
+    then sign-extended into 32 words. The last 1 to 31 bits are
+    handled 16 at a time with 128-bit vectors, so no more counters
+    are accessed than by the other versions.
+  */
+
+  const auto c1 = _mm256_set_epi32(0x03030303, 0x03030303,
+                                   0x02020202, 0x02020202,
+                                   0x01010101, 0x01010101,
+                                   0x00000000, 0x00000000);
+  const auto c2 = _mm256_set1_epi64x(static_cast<int64_t>(0x8040201008040201));
+
+  auto * p = bitmap;
+  auto * q = counters;
+  const auto r = totalbits / 32;
+
+  for(auto j = 0U; j < r; j++)
+    {
+      int32_t bits = 0;
+      std::memcpy(&bits, p, sizeof(bits));
+      p += 4;
+      const auto ymm0 = _mm256_set1_epi32(bits);
+      const auto ymm1 = _mm256_shuffle_epi8(ymm0, c1);
+      const auto ymm2 = _mm256_and_si256(ymm1, c2);
+      const auto ymm3 = _mm256_cmpeq_epi8(ymm2, c2);
+      const auto ymm4 = _mm256_cvtepi8_epi16(_mm256_castsi256_si128(ymm3));
+      const auto ymm5 = _mm256_cvtepi8_epi16(_mm256_extracti128_si256(ymm3, 1));
+      auto * q0 = (__m256i *) q;
+      auto * q1 = (__m256i *) (q + 16);
+      _mm256_storeu_si256(q0, _mm256_subs_epi16(_mm256_loadu_si256(q0), ymm4));
+      _mm256_storeu_si256(q1, _mm256_subs_epi16(_mm256_loadu_si256(q1), ymm5));
+      q += 32;
+    }
+
+  const auto c3 = _mm256_castsi256_si128(c1);
+  const auto c4 = _mm256_castsi256_si128(c2);
+  const auto rest = ((totalbits % 32) + 15) / 16;
+
+  for(auto j = 0U; j < rest; j++)
+    {
+      int16_t bits = 0;
+      std::memcpy(&bits, p, sizeof(bits));
+      p += 2;
+      const auto xmm0 = _mm_set1_epi16(bits);
+      const auto xmm1 = _mm_shuffle_epi8(xmm0, c3);
+      const auto xmm2 = _mm_and_si128(xmm1, c4);
+      const auto xmm3 = _mm_cmpeq_epi8(xmm2, c4);
+      const auto ymm4 = _mm256_cvtepi8_epi16(xmm3);
+      auto * q0 = (__m256i *) q;
+      _mm256_storeu_si256(q0, _mm256_subs_epi16(_mm256_loadu_si256(q0), ymm4));
+      q += 16;
+    }
+}
+
+#elif defined(AVX512BW)
+
+#include <immintrin.h>
+
+void increment_counters_from_bitmap_avx512bw(count_t * counters,
+                                             unsigned char * bitmap,
+                                             unsigned int totalbits)
+{
+  /*
+    With AVX-512BW, 32 bits of the bitmap are used directly as a mask
+    register. Only the selected counters are loaded, incremented with
+    signed saturation like in the other versions, and stored back.
+  */
+
+  const auto ones = _mm512_set1_epi16(1);
+
+  for(auto i = 0U; i < totalbits; i += 32)
+    {
+      uint32_t bits = 0;
+      std::memcpy(&bits, bitmap + (i / 8), sizeof(bits));
+      if (totalbits - i < 32)
+        {
+          bits &= (1U << (totalbits - i)) - 1;
+        }
+      const auto k = static_cast<__mmask32>(bits);
+      const auto zmm0 = _mm512_maskz_loadu_epi16(k, counters + i);
+      const auto zmm1 = _mm512_adds_epi16(zmm0, ones);
+      _mm512_mask_storeu_epi16(counters + i, k, zmm1);
+    }
+}
+
 #elif __x86_64__ || defined(SIMDE_VERSION)
 
 #ifdef __x86_64__
@@ -229,6 +325,86 @@ void increment_counters_from_bitmap_sse2(count_t * counters,
     }
 }
 
+#if defined(SSSE3)
+
+struct packed_tables_s
+{
+  unsigned char shuffle[256][16];
+  unsigned char length[256];
+
+  packed_tables_s() : shuffle(), length()
+  {
+    /* for each control byte: where to find the bytes of each value,
+       0x80 gives zero bytes */
+    for (auto control = 0U; control < 256; control++)
+      {
+        auto position = 0U;
+        for (auto value = 0U; value < 4; value++)
+          {
+            auto const bytes = ((control >> (2 * value)) & 3U) + 1;
+            for (auto byte = 0U; byte < 4; byte++)
+              {
+                shuffle[control][(4 * value) + byte] =
+                  (byte < bytes) ? position + byte : 0x80;
+              }
+            position += bytes;
+          }
+        length[control] = position;
+      }
+  }
+};
+
+void increment_counters_from_packed_ssse3(count_t * counters,
+                                          unsigned char const * packed,
+                                          unsigned int count)
+{
+  /*
+    Increment the counters of the sequences listed in a packed posting
+    list (see dbindex_pack_lists). Groups of four delta-encoded values
+    are stored as a control byte with the length (1-4 bytes) of each
+    value, followed by the value bytes. Each group is expanded with
+    one shuffle and turned back into sequence numbers with a prefix
+    sum. The list is padded so reading 16 bytes past a group is safe.
+  */
+
+  static const packed_tables_s tables;
+
+  auto previous = _mm_setzero_si128();
+  alignas(16) unsigned int values[4];
+
+  for (auto i = 0U; i < count; i += 4)
+    {
+      unsigned int const control = *packed;
+      ++packed;
+      const auto xmm0 = _mm_loadu_si128((__m128i const *) packed);
+      const auto xmm1 = _mm_shuffle_epi8(xmm0,
+                                         _mm_loadu_si128((__m128i const *) tables.shuffle[control]));
+      packed += tables.length[control];
+      const auto xmm2 = _mm_add_epi32(xmm1, _mm_slli_si128(xmm1, 4));
+      const auto xmm3 = _mm_add_epi32(xmm2, _mm_slli_si128(xmm2, 8));
+      const auto xmm4 = _mm_add_epi32(xmm3, previous);
+      previous = _mm_shuffle_epi32(xmm4, 0xff);
+      _mm_store_si128((__m128i *) values, xmm4);
+
+      if (count - i >= 4)
+        {
+          counters[values[0]]++;
+          counters[values[1]]++;
+          counters[values[2]]++;
+          counters[values[3]]++;
+        }
+      else
+        {
+          for (auto j = 0U; j < count - i; j++)
+            {
+              counters[values[j]]++;
+            }
+        }
+    }
+}
+
+#endif
+
 #else
 
 #error Unknown architecture
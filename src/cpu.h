@@ -68,6 +68,15 @@ auto increment_counters_from_bitmap_sse2(count_t * counters,
 auto increment_counters_from_bitmap_ssse3(count_t * counters,
                                           unsigned char * bitmap,
                                           unsigned int totalbits) -> void;
+auto increment_counters_from_bitmap_avx2(count_t * counters,
+                                         unsigned char * bitmap,
+                                         unsigned int totalbits) -> void;
+auto increment_counters_from_bitmap_avx512bw(count_t * counters,
+                                             unsigned char * bitmap,
+                                             unsigned int totalbits) -> void;
+auto increment_counters_from_packed_ssse3(count_t * counters,
+                                          unsigned char const * packed,
+                                          unsigned int count) -> void;
 #else
 auto increment_counters_from_bitmap(count_t * counters,
                                     unsigned char * bitmap,
@@ -77,6 +77,7 @@ static uint64_t nucleotides = 0;
 static uint64_t longest = 0;
 static uint64_t shortest = 0;
 static uint64_t longestheader = 0;
+static bool is_mapped = false;
 
 static uint64_t dataalloc = 0;
 static uint64_t datalen = 0;
@@ -84,6 +85,7 @@ static size_t seqindex_alloc = 0;
 
 seqinfo_t * seqindex = nullptr;
 char * datap = nullptr;
+bool db_abundances = true;
 
 auto db_setinfo(bool new_is_fastq,
                 uint64_t new_sequences,
@@ -98,6 +100,21 @@ auto db_setinfo(bool new_is_fastq,
   longest = new_longest;
   shortest = new_shortest;
   longestheader = new_longestheader;
+
+  /* the data and index belong to the UDB reader */
+  dataalloc = 0;
+  datalen = 0;
+  seqindex_alloc = 0;
+}
+
+auto db_setmapped(bool mapped) -> void
+{
+  is_mapped = mapped;
+}
+
+auto db_setabundances(bool use_abundances) -> void
+{
+  db_abundances = use_abundances;
 }
 
 auto db_is_fastq() -> bool
@@ -207,7 +224,7 @@ auto db_add(bool is_fastq,
 }
 
 
-auto db_read(const char * filename, int upcase) -> void
+auto db_load(const char * filename, int upcase, bool append) -> void
 {
   h = fastx_open(filename);
 
@@ -216,7 +233,8 @@ auto db_read(const char * filename, int upcase) -> void
       fatal("Unrecognized file type (not proper FASTA or FASTQ format)");
     }
 
-  is_fastq = fastx_is_fastq(h);
+  /* qualities are only kept if all the sequences have them */
+  is_fastq = fastx_is_fastq(h) and ((not append) or is_fastq);
 
   int64_t const filesize = fastx_get_size(h);
 
@@ -228,25 +246,30 @@ auto db_read(const char * filename, int upcase) -> void
 
   progress_init(prompt, filesize);
 
-  longest = 0;
-  shortest = LONG_MAX;
-  longestheader = 0;
-  sequences = 0;
-  nucleotides = 0;
+  if (not append)
+    {
+      is_mapped = false;
+
+      longest = 0;
+      shortest = LONG_MAX;
+      longestheader = 0;
+      sequences = 0;
+      nucleotides = 0;
+
+      /* allocate space for data */
+      dataalloc = 0;
+      datap = nullptr;
+      datalen = 0;
+
+      /* allocate space for index */
+      seqindex_alloc = 0;
+      seqindex = nullptr;
+    }
 
   int64_t discarded_short = 0;
   int64_t discarded_long = 0;
   int64_t discarded_unoise = 0;
 
-  /* allocate space for data */
-  dataalloc = 0;
-  datap = nullptr;
-  datalen = 0;
-
-  /* allocate space for index */
-  seqindex_alloc = 0;
-  seqindex = nullptr;
-
   while(fastx_next(h,
                    not opt_notrunclabels,
                    upcase ? chrmap_upcase : chrmap_no_change))
@@ -386,6 +409,55 @@ auto db_read(const char * filename, int upcase) -> void
   show_rusage();
 }
 
+auto db_read(const char * filename, int upcase) -> void
+{
+  db_load(filename, upcase, false);
+}
+
+auto db_append(const char * filename, int upcase) -> void
+{
+  if ((sequences > 0) and (dataalloc == 0))
+    {
+      /* read from a UDB file: copy the sequences to memory that can
+         grow, the file data is released with the index */
+
+      char * const udb_datap = datap;
+      seqinfo_t * const udb_seqindex = seqindex;
+      uint64_t const udb_sequences = sequences;
+      bool const udb_mapped = is_mapped;
+
+      is_mapped = false;
+      datap = nullptr;
+      seqindex = nullptr;
+      sequences = 0;
+      nucleotides = 0;
+      longest = 0;
+      shortest = LONG_MAX;
+      longestheader = 0;
+
+      for (uint64_t i = 0; i < udb_sequences; i++)
+        {
+          seqinfo_t const & info = udb_seqindex[i];
+          db_add(false,
+                 udb_datap + info.header_p,
+                 udb_datap + info.seq_p,
+                 nullptr,
+                 info.headerlen,
+                 info.seqlen,
+                 db_abundances ? info.size : 1);
+        }
+      db_abundances = true;
+
+      if (not udb_mapped)
+        {
+          xfree(udb_datap);
+          xfree(udb_seqindex);
+        }
+    }
+
+  db_load(filename, upcase, true);
+}
+
 auto db_getsequencecount() -> uint64_t
 {
   return sequences;
@@ -413,6 +485,15 @@ auto db_getshortestsequence() -> uint64_t
 
 auto db_free() -> void
 {
+  if (is_mapped)
+    {
+      /* memory belongs to the mapped UDB file */
+      datap = nullptr;
+      seqindex = nullptr;
+      is_mapped = false;
+      db_abundances = true;
+      return;
+    }
   if (datap)
     {
       xfree(datap);
@@ -565,11 +646,11 @@ inline auto compare_byabundance(const void * a, const void * b) -> int
     }
 }
 
-auto db_sortbylength() -> void
+auto db_sortbylength(uint64_t first) -> void
 {
   progress_init("Sorting by length", 100);
-  qsort(seqindex,
-        sequences,
+  qsort(seqindex + first,
+        sequences - first,
         sizeof(seqinfo_t),
         compare_bylength);
   progress_done();
@@ -585,11 +666,11 @@ auto db_sortbylength_shortest_first() -> void
   progress_done();
 }
 
-auto db_sortbyabundance() -> void
+auto db_sortbyabundance(uint64_t first) -> void
 {
   progress_init("Sorting by abundance", 100);
-  qsort(seqindex,
-        sequences,
+  qsort(seqindex + first,
+        sequences - first,
         sizeof(seqinfo_t),
         compare_byabundance);
   progress_done();
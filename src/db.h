@@ -87,9 +87,11 @@ inline auto db_getsequence(uint64_t seqno) -> char *
   return datap + seqindex[seqno].seq_p;
 }
 
+extern bool db_abundances;  /* false: every sequence has abundance 1 */
+
 inline auto db_getabundance(uint64_t seqno) -> uint64_t
 {
-  return seqindex[seqno].size;
+  return db_abundances ? seqindex[seqno].size : 1;
 }
 
 inline auto db_getsequencelen(uint64_t seqno) -> uint64_t
@@ -103,6 +105,7 @@ inline auto db_getheaderlen(uint64_t seqno) -> uint64_t
 }
 
 auto db_read(const char * filename, int upcase) -> void;
+auto db_append(const char * filename, int upcase) -> void;
 auto db_free() -> void;
 
 auto db_getsequencecount() -> uint64_t;
@@ -112,12 +115,13 @@ auto db_getlongestsequence() -> uint64_t;
 auto db_getshortestsequence() -> uint64_t;
 
 /* Note: the sorting functions below must be called after db_read,
-   but before dbindex_prepare */
+   but before dbindex_prepare; the ones with a first argument leave
+   the sequences before it in place */
 
-auto db_sortbylength() -> void;
+auto db_sortbylength(uint64_t first) -> void;
 auto db_sortbylength_shortest_first() -> void;
 
-auto db_sortbyabundance() -> void;
+auto db_sortbyabundance(uint64_t first) -> void;
 
 auto db_is_fastq() -> bool;
 auto db_getquality(uint64_t seqno) -> char *;
@@ -128,3 +132,13 @@ auto db_setinfo(bool new_is_fastq,
                 uint64_t new_longest,
                 uint64_t new_shortest,
                 uint64_t new_longestheader) -> void;
+
+/* Note: a mapped database (see udb_read) points datap and seqindex
+   into a file mapping owned by the index; db_free leaves it alone */
+
+auto db_setmapped(bool mapped) -> void;
+
+/* Note: a mapped database cannot be written to; db_setabundances(false)
+   makes db_getabundance ignore the abundances stored in the file */
+
+auto db_setabundances(bool use_abundances) -> void;
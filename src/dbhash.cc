@@ -128,8 +128,10 @@ auto dbhash_search_first(char * seq,
                          uint64_t seqlen,
                          struct dbhash_search_info_s * info) -> int64_t
 {
+  /* seq may be raw; it is hashed in normalized form and compared
+     case-insensitively with U equal to T */
 
-  uint64_t const hash = hash_cityhash64(seq, seqlen);
+  uint64_t const hash = hash_cityhash64_normalized(seq, seqlen);
   info->hash = hash;
   info->seq = seq;
   info->seqlen = seqlen;
@@ -208,23 +210,18 @@ auto dbhash_add_one(uint64_t seqno) -> void
 {
   char * seq = db_getsequence(seqno);
   uint64_t const seqlen = db_getsequencelen(seqno);
-  char * normalized = (char *) xmalloc(seqlen + 1);
-  string_normalize(normalized, seq, seqlen);
-  dbhash_add(normalized, seqlen, seqno);
+  dbhash_add(seq, seqlen, seqno);
 }
 
 auto dbhash_add_all() -> void
 {
   progress_init("Hashing database sequences", db_getsequencecount());
-  char * normalized = (char *) xmalloc(db_getlongestsequence() + 1);
   for (uint64_t seqno=0; seqno < db_getsequencecount(); seqno++)
     {
       char * seq = db_getsequence(seqno);
       uint64_t const seqlen = db_getsequencelen(seqno);
-      string_normalize(normalized, seq, seqlen);
-      dbhash_add(normalized, seqlen, seqno);
+      dbhash_add(seq, seqlen, seqno);
       progress_update(seqno + 1);
     }
-  xfree(normalized);
   progress_done();
 }
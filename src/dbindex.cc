@@ -63,10 +63,13 @@
 #include "dbindex.h"
 #include "maps.h"
 #include "unique.h"
+#include <cinttypes>  // macros PRIu64
 #include <cstdint>  // uint64_t
 #include <cstdio>  // std::FILE, std::fprintf
+#include <algorithm>  // std::min
 #include <cstring>  // std::memset
 #include <iterator>  // std::next
+#include <vector>
 
 
 unsigned int * kmercount;
@@ -81,8 +84,65 @@ uhandle_s * dbindex_uh;
 
 constexpr unsigned int bitmap_threshold = 8;
 
+/*
+  Optional compressed posting lists (see dbindex_setcompressed). The
+  sequence numbers of each word are delta encoded in groups of four
+  values, each group being a control byte with two bits per value
+  giving its length (1-4 bytes), followed by the value bytes in
+  little-endian order. The stream is padded to allow 16-byte loads.
+*/
+
+static unsigned char * kmerpacked = nullptr;
+static uint64_t * kmerpackedoffset = nullptr;
+static uint64_t kmerpackedsize = 0;
+static uint64_t kmerpackedalloc = 0;
+static bool dbindex_compress_lists = false;
+constexpr uint64_t kmerpacked_padding = 16;
+
+/* the raw lists of about a quarter of the matches, and at least 1M
+   matches, are held at once while packing */
+constexpr uint64_t kmerpacked_slices = 4;
+constexpr uint64_t kmerpacked_slice_min = 1ULL << 20U;
+
 static unsigned int bitmap_mincount;
 
+/* file mapping holding kmercount, kmerhash, kmerindex and the bitmap
+   contents when the index was loaded from a version 2 UDB file */
+static void * dbindex_mapped_address = nullptr;
+static uint64_t dbindex_mapped_length = 0;
+
+/*
+  Parallel index construction. The database is split into one
+  contiguous range of sequences per thread. In the counting pass each
+  thread counts words in its own array. The partial counts are kept
+  and turned into per-thread write positions for the fill pass, so
+  every thread writes its own part of each word's posting list and
+  the result is identical to the serial construction. Ranges are
+  multiples of 8 sequences so threads never share a bitmap byte.
+*/
+
+constexpr uint64_t partial_counts_maxmemory = 256ULL * 1024 * 1024;
+constexpr unsigned int progress_interval = 1024;
+
+struct dbindex_thread_s
+{
+  pthread_t thread;
+  unsigned int first_seqno;
+  unsigned int last_seqno;  /* one past the end */
+  std::vector<unsigned int> counts;  /* word counts, then write positions */
+};
+
+static std::vector<struct dbindex_thread_s> dbindex_threads;
+static int dbindex_seqmask = 0;
+
+/* the words filled by the fill pass, and the position of the first
+   one in kmerindex, all of them unless the lists are packed */
+static unsigned int dbindex_slice_first = 0;
+static unsigned int dbindex_slice_last = 0;
+static uint64_t dbindex_slice_base = 0;
+static pthread_mutex_t dbindex_progress_mutex;
+static uint64_t dbindex_progress = 0;
+
 
 auto dbindex_getbitmap(unsigned int const kmer) -> unsigned char *
 {
@@ -107,6 +167,329 @@ auto dbindex_getmatchlist(unsigned int const kmer) -> unsigned int *
 }
 
 
+auto dbindex_packed_length(unsigned int const value) -> unsigned int
+{
+  /* number of bytes needed to store value, 1 to 4 */
+  unsigned int length = 1;
+  while ((length < 4) and ((value >> (8 * length)) != 0))
+    {
+      ++length;
+    }
+  return length;
+}
+
+
+auto dbindex_mark_block(uint64_t * blocks, unsigned int const index) -> void
+{
+  unsigned int const block = index / dbindex_counter_block;
+  blocks[block / 64] |= uint64_t{1} << (block % 64);
+}
+
+
+auto dbindex_increment_counters_packed(count_t * counters,
+                                       unsigned char const * packed,
+                                       unsigned int const count,
+                                       uint64_t * blocks) -> void
+{
+  /* blocks, if not null, gets a bit set for each block touched */
+  unsigned int previous = 0;
+  for (unsigned int i = 0; i < count; i += 4)
+    {
+      unsigned int const control = *packed;
+      ++packed;
+      for (unsigned int j = 0; j < 4; j++)
+        {
+          unsigned int const length = ((control >> (2 * j)) & 3U) + 1;
+          unsigned int delta = 0;
+          for (unsigned int b = 0; b < length; b++)
+            {
+              delta |= ((unsigned int) packed[b]) << (8 * b);
+            }
+          packed += length;
+          previous += delta;
+          if (i + j < count)
+            {
+              counters[previous]++;
+              if (blocks != nullptr)
+                {
+                  dbindex_mark_block(blocks, previous);
+                }
+            }
+        }
+    }
+}
+
+
+auto dbindex_iscompressed() -> bool
+{
+  return kmerpacked != nullptr;
+}
+
+
+auto dbindex_increment_counters(unsigned int const kmer,
+                                count_t * counters) -> void
+{
+  /* add one to the counter of each sequence containing kmer */
+
+  unsigned int const count = kmercount[kmer];
+
+  if (kmerpacked)
+    {
+      unsigned char const * packed = kmerpacked + kmerpackedoffset[kmer];
+#ifdef __x86_64__
+      if (ssse3_present)
+        {
+          increment_counters_from_packed_ssse3(counters, packed, count);
+          return;
+        }
+#endif
+      dbindex_increment_counters_packed(counters, packed, count, nullptr);
+    }
+  else
+    {
+      unsigned int const * list = kmerindex + kmerhash[kmer];
+      for (unsigned int j = 0; j < count; j++)
+        {
+          counters[list[j]]++;
+        }
+    }
+}
+
+
+auto dbindex_increment_counters_marked(unsigned int const kmer,
+                                       count_t * counters,
+                                       uint64_t * blocks) -> void
+{
+  /*
+    As dbindex_increment_counters, but also set the bit in blocks for
+    each block of dbindex_counter_block counters that is incremented.
+  */
+
+  unsigned int const count = kmercount[kmer];
+
+  if (kmerpacked)
+    {
+      dbindex_increment_counters_packed(counters,
+                                        kmerpacked + kmerpackedoffset[kmer],
+                                        count,
+                                        blocks);
+    }
+  else
+    {
+      unsigned int const * list = kmerindex + kmerhash[kmer];
+      for (unsigned int j = 0; j < count; j++)
+        {
+          counters[list[j]]++;
+          dbindex_mark_block(blocks, list[j]);
+        }
+    }
+}
+
+
+auto dbindex_setcompressed(bool const compressed) -> void
+{
+  /*
+    Keep the posting lists only in compressed form. Must be called
+    before the index is filled (dbindex_prepare and
+    dbindex_addallsequences) or read (udb_read), as the lists are
+    packed a slice of the words at a time while they are built.
+  */
+
+  dbindex_compress_lists = compressed;
+}
+
+
+auto dbindex_compressing() -> bool
+{
+  return dbindex_compress_lists;
+}
+
+
+auto dbindex_list_end(unsigned int const kmer) -> uint64_t
+{
+  /* end of the raw list of kmer, words with a bitmap have none */
+  if (kmerbitmap[kmer])
+    {
+      return kmerhash[kmer];
+    }
+  return kmerhash[kmer] + kmercount[kmer];
+}
+
+
+auto dbindex_pack_slice(unsigned int const first_kmer) -> unsigned int
+{
+  /*
+    Return one past the last word of the slice starting at
+    first_kmer, the raw lists of a slice being held at once while they
+    are packed. A slice holds at least one word.
+  */
+
+  uint64_t const budget = std::max(kmerindexsize / kmerpacked_slices,
+                                   kmerpacked_slice_min);
+  unsigned int last = first_kmer + 1;
+  while ((last < kmerhashsize) and
+         (dbindex_list_end(last) - kmerhash[first_kmer] <= budget))
+    {
+      ++last;
+    }
+  return last;
+}
+
+
+auto dbindex_pack_begin() -> void
+{
+  kmerpackedoffset = (uint64_t *) xmalloc((kmerhashsize + 1) * sizeof(uint64_t));
+  kmerpackedsize = 0;
+  kmerpackedalloc = kmerpacked_padding;
+  kmerpacked = (unsigned char *) xmalloc(kmerpackedalloc);
+  std::memset(kmerpacked, 0, kmerpacked_padding);
+}
+
+
+auto dbindex_pack_lists(unsigned int const first_kmer,
+                        unsigned int const last_kmer,
+                        unsigned int const * lists) -> void
+{
+  /*
+    Append the packed posting lists of the words from first_kmer up to
+    last_kmer (excluded). The raw list of each word starts at
+    lists + kmerhash[kmer] - kmerhash[first_kmer]. Words with a bitmap
+    get an empty list.
+  */
+
+  uint64_t const base = kmerhash[first_kmer];
+
+  /* first pass, compute the size of the packed lists */
+  uint64_t packedsize = kmerpackedsize;
+  for (unsigned int kmer = first_kmer; kmer < last_kmer; kmer++)
+    {
+      if (kmerbitmap[kmer])
+        {
+          continue;
+        }
+      unsigned int const * list = lists + (kmerhash[kmer] - base);
+      unsigned int const count = kmercount[kmer];
+      unsigned int previous = 0;
+      for (unsigned int i = 0; i < count; i += 4)
+        {
+          packedsize += 1;
+          for (unsigned int j = i; j < i + 4; j++)
+            {
+              unsigned int const delta = (j < count) ? list[j] - previous : 0;
+              packedsize += dbindex_packed_length(delta);
+              if (j < count)
+                {
+                  previous = list[j];
+                }
+            }
+        }
+    }
+
+  if (packedsize + kmerpacked_padding > kmerpackedalloc)
+    {
+      kmerpackedalloc = std::max(packedsize + kmerpacked_padding,
+                                 kmerpackedalloc + (kmerpackedalloc / 2));
+      kmerpacked = (unsigned char *) xrealloc(kmerpacked, kmerpackedalloc);
+    }
+
+  /* second pass, encode */
+  for (unsigned int kmer = first_kmer; kmer < last_kmer; kmer++)
+    {
+      kmerpackedoffset[kmer] = kmerpackedsize;
+      if (kmerbitmap[kmer])
+        {
+          continue;
+        }
+      unsigned int const * list = lists + (kmerhash[kmer] - base);
+      unsigned int const count = kmercount[kmer];
+      unsigned char * packed = kmerpacked + kmerpackedsize;
+      unsigned int previous = 0;
+      for (unsigned int i = 0; i < count; i += 4)
+        {
+          unsigned char * control = packed;
+          *control = 0;
+          ++packed;
+          for (unsigned int j = 0; j < 4; j++)
+            {
+              unsigned int const delta =
+                (i + j < count) ? list[i + j] - previous : 0;
+              unsigned int const length = dbindex_packed_length(delta);
+              *control |= (length - 1) << (2 * j);
+              for (unsigned int b = 0; b < length; b++)
+                {
+                  packed[b] = (delta >> (8 * b)) & 0xffU;
+                }
+              packed += length;
+              if (i + j < count)
+                {
+                  previous = list[i + j];
+                }
+            }
+        }
+      kmerpackedsize = static_cast<uint64_t>(packed - kmerpacked);
+    }
+
+  std::memset(kmerpacked + kmerpackedsize, 0, kmerpacked_padding);
+}
+
+
+auto dbindex_pack_end() -> void
+{
+  /* the raw lists are no longer available */
+
+  kmerpackedoffset[kmerhashsize] = kmerpackedsize;
+  kmerpackedalloc = kmerpackedsize + kmerpacked_padding;
+  kmerpacked = (unsigned char *) xrealloc(kmerpacked, kmerpackedalloc);
+  kmerindex = nullptr;
+}
+
+
+auto dbindex_show_packed() -> void
+{
+  if (not opt_quiet)
+    {
+      std::fprintf(stderr,
+                   "Compressed k-mer index: %" PRIu64 " bytes for %" PRIu64 " matches\n",
+                   kmerpackedsize,
+                   kmerindexsize);
+    }
+
+  if (opt_log)
+    {
+      std::fprintf(fp_log,
+                   "Compressed k-mer index: %" PRIu64 " bytes for %" PRIu64 " matches\n\n",
+                   kmerpackedsize,
+                   kmerindexsize);
+    }
+}
+
+
+auto dbindex_pack_mapped() -> void
+{
+  /*
+    Pack the posting lists of a mapped UDB file. The pages of the raw
+    lists are released once a slice is packed, so they do not stay
+    resident.
+  */
+
+  progress_init("Compressing k-mer index", kmerhashsize);
+  dbindex_pack_begin();
+  unsigned int first = 0;
+  while (first < kmerhashsize)
+    {
+      unsigned int const last = dbindex_pack_slice(first);
+      dbindex_pack_lists(first, last, kmerindex + kmerhash[first]);
+      xmadvise_dontneed(kmerindex + kmerhash[first],
+                        (kmerhash[last] - kmerhash[first]) * sizeof(unsigned int));
+      first = last;
+      progress_update(first);
+    }
+  dbindex_pack_end();
+  progress_done();
+  dbindex_show_packed();
+}
+
+
 auto dbindex_getmapping(unsigned int const index) -> unsigned int
 {
   return *std::next(dbindex_map, index);
@@ -133,6 +516,9 @@ auto dbindex_addsequence(unsigned int seqno, int seqmask) -> void
   std::printf("Adding seqno %d as index element no %d\n", seqno, dbindex_count);
 #endif
 
+  /* sequences added one by one, partial counts are not needed */
+  dbindex_threads.clear();
+
   unsigned int uniquecount = 0;
   unsigned int * uniquelist = nullptr;
   unique_count(dbindex_uh, opt_wordlength,
@@ -156,16 +542,182 @@ auto dbindex_addsequence(unsigned int seqno, int seqmask) -> void
 }
 
 
+auto dbindex_report_progress(unsigned int const done) -> void
+{
+  xpthread_mutex_lock(&dbindex_progress_mutex);
+  dbindex_progress += done;
+  progress_update(dbindex_progress);
+  xpthread_mutex_unlock(&dbindex_progress_mutex);
+}
+
+
+auto dbindex_count_worker(void * vp) -> void *
+{
+  auto * tip = (struct dbindex_thread_s *) vp;
+  auto * uh = unique_init();
+  unsigned int * counts = tip->counts.data();
+  for (unsigned int seqno = tip->first_seqno; seqno < tip->last_seqno; seqno++)
+    {
+      unsigned int uniquecount = 0;
+      unsigned int * uniquelist = nullptr;
+      unique_count(uh, opt_wordlength,
+                   db_getsequencelen(seqno), db_getsequence(seqno),
+                   &uniquecount, &uniquelist, dbindex_seqmask);
+      for (unsigned int i = 0; i < uniquecount; i++)
+        {
+          counts[uniquelist[i]]++;
+        }
+      if ((seqno - tip->first_seqno + 1) % progress_interval == 0)
+        {
+          dbindex_report_progress(progress_interval);
+        }
+    }
+  unique_exit(uh);
+  return nullptr;
+}
+
+
+auto dbindex_fill_worker(void * vp) -> void *
+{
+  auto * tip = (struct dbindex_thread_s *) vp;
+  auto * uh = unique_init();
+  unsigned int * positions = tip->counts.data();
+  for (unsigned int seqno = tip->first_seqno; seqno < tip->last_seqno; seqno++)
+    {
+      unsigned int uniquecount = 0;
+      unsigned int * uniquelist = nullptr;
+      unique_count(uh, opt_wordlength,
+                   db_getsequencelen(seqno), db_getsequence(seqno),
+                   &uniquecount, &uniquelist, dbindex_seqmask);
+      for (unsigned int i = 0; i < uniquecount; i++)
+        {
+          unsigned int const kmer = uniquelist[i];
+          if ((kmer < dbindex_slice_first) or (kmer >= dbindex_slice_last))
+            {
+              continue;
+            }
+          if (kmerbitmap[kmer])
+            {
+              bitmap_set(kmerbitmap[kmer], seqno);
+            }
+          else
+            {
+              kmerindex[kmerhash[kmer] - dbindex_slice_base +
+                        (positions[kmer]++)] = seqno;
+            }
+        }
+      dbindex_map[seqno] = seqno;
+      if ((seqno - tip->first_seqno + 1) % progress_interval == 0)
+        {
+          dbindex_report_progress(progress_interval);
+        }
+    }
+  unique_exit(uh);
+  return nullptr;
+}
+
+
+auto dbindex_run_threads(void * (*worker)(void *)) -> void
+{
+  pthread_attr_t attr;
+  xpthread_attr_init(&attr);
+  xpthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+  xpthread_mutex_init(&dbindex_progress_mutex, nullptr);
+
+  for (auto & thread_info : dbindex_threads)
+    {
+      xpthread_create(&thread_info.thread, &attr, worker, (void *) &thread_info);
+    }
+
+  for (auto & thread_info : dbindex_threads)
+    {
+      xpthread_join(thread_info.thread, nullptr);
+    }
+
+  xpthread_mutex_destroy(&dbindex_progress_mutex);
+  xpthread_attr_destroy(&attr);
+}
+
+
 auto dbindex_addallsequences(int seqmask) -> void
 {
   unsigned int const seqcount = db_getsequencecount();
-  progress_init("Creating k-mer index", seqcount);
-  for (unsigned int seqno = 0; seqno < seqcount ; seqno++)
+
+  if (dbindex_threads.empty() or (seqmask != dbindex_seqmask))
+    {
+      progress_init("Creating k-mer index", seqcount);
+      for (unsigned int seqno = 0; seqno < seqcount ; seqno++)
+        {
+          dbindex_addsequence(seqno, seqmask);
+          progress_update(seqno);
+        }
+      progress_done();
+      return;
+    }
+
+  /* turn the partial counts into per-thread write positions */
+  for (unsigned int kmer = 0; kmer < kmerhashsize; kmer++)
+    {
+      unsigned int position = 0;
+      for (auto & thread_info : dbindex_threads)
+        {
+          unsigned int const count = thread_info.counts[kmer];
+          thread_info.counts[kmer] = position;
+          position += count;
+        }
+      kmercount[kmer] = position;
+    }
+
+  /*
+    All the words are filled in one pass, unless the lists are packed.
+    Then the lists of a slice of the words are filled at a time, each
+    pass scanning the whole database, and packed before the next one,
+    so the raw lists of the whole index are never held at once.
+  */
+
+  std::vector<unsigned int> slices(1, 0);
+  uint64_t largest = 1;
+  while (slices.back() < kmerhashsize)
+    {
+      unsigned int const first = slices.back();
+      unsigned int const last =
+        dbindex_compress_lists ? dbindex_pack_slice(first) : kmerhashsize;
+      largest = std::max(largest, kmerhash[last] - kmerhash[first]);
+      slices.push_back(last);
+    }
+
+  progress_init("Creating k-mer index",
+                uint64_t{seqcount} * (slices.size() - 1));
+  dbindex_progress = 0;
+
+  if (dbindex_compress_lists)
+    {
+      kmerindex = (unsigned int *) xmalloc(largest * sizeof(unsigned int));
+      dbindex_pack_begin();
+    }
+
+  for (std::size_t i = 0; i + 1 < slices.size(); i++)
     {
-      dbindex_addsequence(seqno, seqmask);
-      progress_update(seqno);
+      dbindex_slice_first = slices[i];
+      dbindex_slice_last = slices[i + 1];
+      dbindex_slice_base = dbindex_compress_lists ? kmerhash[slices[i]] : 0;
+      dbindex_run_threads(dbindex_fill_worker);
+      if (dbindex_compress_lists)
+        {
+          dbindex_pack_lists(dbindex_slice_first, dbindex_slice_last, kmerindex);
+        }
     }
+
+  dbindex_count = seqcount;
+  dbindex_threads.clear();
   progress_done();
+
+  if (dbindex_compress_lists)
+    {
+      xfree(kmerindex);
+      dbindex_pack_end();
+      dbindex_show_packed();
+    }
 }
 
 
@@ -180,20 +732,61 @@ auto dbindex_prepare(int use_bitmap, int seqmask) -> void
   kmercount = (unsigned int *) xmalloc(kmerhashsize * sizeof(unsigned int));
   std::memset(kmercount, 0, kmerhashsize * sizeof(unsigned int));
 
+  /* use several threads if the partial counts fit in memory */
+  uint64_t const partial_counts_size = kmerhashsize * sizeof(unsigned int);
+  unsigned int const chunks = (seqcount + 7) / 8;
+  auto threads = std::min({static_cast<uint64_t>(opt_threads),
+                           partial_counts_maxmemory / partial_counts_size,
+                           static_cast<uint64_t>(chunks)});
+
+  /* packed lists are filled with the write positions of the threads */
+  if (dbindex_compress_lists)
+    {
+      threads = std::max(threads, uint64_t{1});
+    }
+
   /* first scan, just count occurences */
   progress_init("Counting k-mers", seqcount);
-  for (unsigned int seqno = 0; seqno < seqcount ; seqno++)
+  dbindex_threads.clear();
+  if ((threads > 1) or dbindex_compress_lists)
     {
-      unsigned int uniquecount = 0;
-      unsigned int * uniquelist = nullptr;
-      unique_count(dbindex_uh, opt_wordlength,
-                   db_getsequencelen(seqno), db_getsequence(seqno),
-                   &uniquecount, &uniquelist, seqmask);
-      for (unsigned int i = 0; i < uniquecount; i++)
+      unsigned int const chunks_per_thread = (chunks + threads - 1) / threads;
+      dbindex_threads.resize(threads);
+      unsigned int first_seqno = 0;
+      for (auto & thread_info : dbindex_threads)
+        {
+          thread_info.first_seqno = first_seqno;
+          thread_info.last_seqno = std::min(first_seqno + (8 * chunks_per_thread), seqcount);
+          thread_info.counts.assign(kmerhashsize, 0);
+          first_seqno = thread_info.last_seqno;
+        }
+      dbindex_seqmask = seqmask;
+      dbindex_progress = 0;
+      dbindex_run_threads(dbindex_count_worker);
+
+      for (auto const & thread_info : dbindex_threads)
         {
-          kmercount[uniquelist[i]]++;
+          for (unsigned int kmer = 0; kmer < kmerhashsize; kmer++)
+            {
+              kmercount[kmer] += thread_info.counts[kmer];
+            }
+        }
+    }
+  else
+    {
+      for (unsigned int seqno = 0; seqno < seqcount ; seqno++)
+        {
+          unsigned int uniquecount = 0;
+          unsigned int * uniquelist = nullptr;
+          unique_count(dbindex_uh, opt_wordlength,
+                       db_getsequencelen(seqno), db_getsequence(seqno),
+                       &uniquecount, &uniquelist, seqmask);
+          for (unsigned int i = 0; i < uniquecount; i++)
+            {
+              kmercount[uniquelist[i]]++;
+            }
+          progress_update(seqno);
         }
-      progress_update(seqno);
     }
   progress_done();
 
@@ -250,8 +843,11 @@ auto dbindex_prepare(int use_bitmap, int seqmask) -> void
   /* reset counts */
   std::memset(kmercount, 0, kmerhashsize * sizeof(unsigned int));
 
-  /* allocate space for actual data */
-  kmerindex = (unsigned int *) xmalloc(kmerindexsize * sizeof(unsigned int));
+  /* allocate space for actual data, packed lists are filled in slices */
+  if (not dbindex_compress_lists)
+    {
+      kmerindex = (unsigned int *) xmalloc(kmerindexsize * sizeof(unsigned int));
+    }
 
   /* allocate space for mapping from indexno to seqno */
   dbindex_map = (unsigned int *) xmalloc(seqcount * sizeof(unsigned int));
@@ -262,20 +858,56 @@ auto dbindex_prepare(int use_bitmap, int seqmask) -> void
 }
 
 
+auto dbindex_setmapped(void * address, uint64_t length) -> void
+{
+  dbindex_mapped_address = address;
+  dbindex_mapped_length = length;
+}
+
+
 auto dbindex_free() -> void
 {
-  xfree(kmerhash);
-  xfree(kmerindex);
-  xfree(kmercount);
+  bool const is_mapped = (dbindex_mapped_address != nullptr);
+
+  if (not is_mapped)
+    {
+      xfree(kmerhash);
+      if (kmerindex)
+        {
+          xfree(kmerindex);
+        }
+      xfree(kmercount);
+    }
+  if (kmerpacked)
+    {
+      xfree(kmerpacked);
+      xfree(kmerpackedoffset);
+      kmerpacked = nullptr;
+      kmerpackedoffset = nullptr;
+    }
+  dbindex_compress_lists = false;
   xfree(dbindex_map);
 
   for (unsigned int kmer = 0; kmer < kmerhashsize; kmer++)
     {
       if (kmerbitmap[kmer] != nullptr)
         {
+          if (is_mapped)
+            {
+              /* bits live in the file mapping */
+              kmerbitmap[kmer]->bitmap = nullptr;
+            }
           bitmap_free(kmerbitmap[kmer]);
         }
     }
   xfree(kmerbitmap);
   unique_exit(dbindex_uh);
+  dbindex_threads.clear();
+
+  if (is_mapped)
+    {
+      xmunmap(dbindex_mapped_address, dbindex_mapped_length);
+      dbindex_mapped_address = nullptr;
+      dbindex_mapped_length = 0;
+    }
 }
@@ -65,6 +65,9 @@
 
 struct uhandle_s;
 
+/* number of counters per bit in dbindex_increment_counters_marked */
+constexpr auto dbindex_counter_block = 16U;
+
 extern unsigned int * kmercount; /* number of matching seqnos for each kmer */
 extern uint64_t * kmerhash;  /* index into the list below for each kmer */
 extern unsigned int * kmerindex; /* the list of matching seqnos for kmers */
@@ -86,6 +89,8 @@ auto dbindex_addsequence(unsigned int seqno, int seqmask) -> void;
 
 auto dbindex_free() -> void;
 
+auto dbindex_setmapped(void * address, uint64_t length) -> void;
+
 auto dbindex_getbitmap(unsigned int kmer) -> unsigned char *;
 
 auto dbindex_getmatchcount(unsigned int kmer) -> unsigned int;
@@ -95,3 +100,29 @@ auto dbindex_getmatchlist(unsigned int kmer) -> unsigned int *;
 auto dbindex_getmapping(unsigned int index) -> unsigned int;
 
 auto dbindex_getcount() -> unsigned int;
+
+auto dbindex_increment_counters(unsigned int kmer, count_t * counters) -> void;
+
+auto dbindex_increment_counters_marked(unsigned int kmer,
+                                       count_t * counters,
+                                       uint64_t * blocks) -> void;
+
+auto dbindex_setcompressed(bool compressed) -> void;
+
+auto dbindex_compressing() -> bool;
+
+auto dbindex_iscompressed() -> bool;
+
+auto dbindex_pack_slice(unsigned int first_kmer) -> unsigned int;
+
+auto dbindex_pack_begin() -> void;
+
+auto dbindex_pack_lists(unsigned int first_kmer,
+                        unsigned int last_kmer,
+                        unsigned int const * lists) -> void;
+
+auto dbindex_pack_end() -> void;
+
+auto dbindex_show_packed() -> void;
+
+auto dbindex_pack_mapped() -> void;
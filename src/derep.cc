@@ -61,13 +61,12 @@
 #include "vsearch.h"
 #include "maps.h"
 #include "utils/seqcmp.h"
-#include <algorithm>  // std::min
+#include <algorithm>  // std::min, std::max
 #include <cinttypes>  // macros PRIu64 and PRId64
 #include <cmath>  // std::log10, std::pow
 #include <cstdint> // int64_t, uint64_t
-#include <cstdlib>  // std::qsort
 #include <cstdio>  // std::FILE, std::fprintf, std::fclose
-#include <cstring>  // std::strlen, std::strcmp, std::memset
+#include <cstring>  // std::strcmp, std::memcpy, std::memset
 #include <iterator>  // std::next
 #include <limits>
 #include <string>
@@ -79,17 +78,29 @@
 struct bucket
 {
   uint64_t hash;
+  char * header;  /* followed by the sequence and its quality, in an arena */
+  unsigned int headerlen;
+  unsigned int seqlen;
   unsigned int seqno_first;
   unsigned int seqno_last;
   unsigned int size;
   unsigned int count;
-  bool deleted;
-  char * header;
-  char * seq;
-  char * qual;
 };
 
 
+inline auto derep_seq(struct bucket const * bp) -> char *
+{
+  return bp->header + bp->headerlen + 1;
+}
+
+
+inline auto derep_qual(struct bucket const * bp) -> char *
+{
+  /* only with FASTQ input */
+  return derep_seq(bp) + bp->seqlen + 1;
+}
+
+
 auto derep_compare_full(void const * void_lhs, void const * void_rhs) -> int
 {
   auto * lhs = (struct bucket *) void_lhs;
@@ -97,110 +108,1113 @@ auto derep_compare_full(void const * void_lhs, void const * void_rhs) -> int
 
   /* highest abundance first, then by label, otherwise keep order */
 
-  if (lhs->deleted and not rhs->deleted)  // refactoring: deleted is always set to false for derep_fulllength
+  if (lhs->size < rhs->size)
     {
       return +1;
     }
-  if (not lhs->deleted and rhs->deleted)  // refactoring: deleted is always set to false for derep_fulllength
+  if (lhs->size > rhs->size)
     {
       return -1;
     }
-  // same status
-  if (lhs->size < rhs->size)
+  // same abundance
+  if (lhs->size == 0)
+    {
+      return 0;
+    }
+  auto const result = std::strcmp(lhs->header, rhs->header);
+  if (result != 0)
+    {
+      return result;
+    }
+  // same header (label)
+  if (lhs->seqno_first < rhs->seqno_first)
+    {
+      return -1;
+    }
+  if (lhs->seqno_first > rhs->seqno_first)
     {
       return +1;
     }
-  if (lhs->size > rhs->size)
+  // same ordinal value (impossible)
+  return 0;  // unreachable
+}
+
+
+auto rehash(struct bucket ** hashtableref, int64_t alloc_clusters) -> void
+{
+  /*
+    double the size of the hash table:
+
+    - allocate the new hash table
+    - rehash all entries from the old to the new table
+    - free the old table
+    - update variables
+  */
+
+  auto * old_hashtable = *hashtableref;
+  uint64_t const old_hashtablesize = 2 * alloc_clusters;
+  uint64_t const new_hashtablesize = 2 * old_hashtablesize;
+  uint64_t const new_hash_mask = new_hashtablesize - 1;
+
+  auto * new_hashtable =
+    (struct bucket *) xmalloc(sizeof(struct bucket) * new_hashtablesize);
+  memset(new_hashtable, 0, sizeof(struct bucket) * new_hashtablesize);
+
+  /* rehash all */
+  for (auto i = 0UL; i < old_hashtablesize; ++i)
+    {
+      auto const & old_bucket = *std::next(old_hashtable, static_cast<long>(i));
+      if (old_bucket.size != 0U)
+        {
+          auto new_index = old_bucket.hash & new_hash_mask;
+          while (std::next(new_hashtable, static_cast<long>(new_index))->size != 0U)
+            {
+              new_index = (new_index + 1) & new_hash_mask;
+            }
+          auto & new_bp = *std::next(new_hashtable, new_index);
+
+          new_bp = old_bucket;
+        }
+    }
+
+  xfree(old_hashtable);
+  *hashtableref = new_hashtable;
+}
+
+
+inline auto convert_quality_symbol_to_probability(int const quality_symbol, struct Parameters const & parameters) -> double
+{
+  static constexpr auto minimal_quality_value = 2;
+  static constexpr auto maximal_probability = 0.75;
+  auto const quality_value = quality_symbol - static_cast<int>(parameters.opt_fastq_ascii);
+  if (quality_value < minimal_quality_value)
+    {
+      return maximal_probability;
+    }
+  static constexpr auto base = 10.0;
+  return std::pow(base, -quality_value / base);
+}
+
+
+inline auto convert_probability_to_quality_symbol(double const probability, struct Parameters const & parameters) -> int
+{
+  static constexpr auto base = 10.0;
+  auto quality_value = static_cast<int64_t>(std::trunc(-base * std::log10(probability)));
+  quality_value = std::min(quality_value, parameters.opt_fastq_qmaxout);
+  quality_value = std::max(quality_value, parameters.opt_fastq_qminout);
+  return static_cast<int>(quality_value + parameters.opt_fastq_asciiout);
+}
+
+
+/* the strings of the clusters are stored one after the other in
+   large blocks, instead of being allocated one by one */
+
+constexpr std::size_t derep_arena_block = 1 << 20;
+
+struct derep_arena_s
+{
+  std::vector<char *> blocks;
+  std::size_t used;  /* in the last block */
+  std::size_t size;  /* of the last block */
+};
+
+
+auto derep_arena_alloc(struct derep_arena_s & arena, std::size_t length) -> char *
+{
+  if (arena.blocks.empty() or (arena.used + length > arena.size))
+    {
+      arena.size = std::max(derep_arena_block, length);
+      arena.blocks.push_back((char *) xmalloc(arena.size));
+      arena.used = 0;
+    }
+  char * start = arena.blocks.back() + arena.used;
+  arena.used += length;
+  return start;
+}
+
+
+auto derep_arena_free(struct derep_arena_s & arena) -> void
+{
+  for (auto * block : arena.blocks)
+    {
+      xfree(block);
+    }
+  arena.blocks.clear();
+}
+
+
+/* sequences read before they are processed by the threads */
+constexpr auto derep_chunk_size = 1 << 14;
+
+struct derep_seq_s
+{
+  uint64_t seqno;
+  int64_t seqlen;
+  int64_t headerlen;
+  int64_t abundance;  /* 1 without --sizein */
+  std::size_t offset;  /* of the strings in the data of the chunk */
+  char * header;
+  char * seq;
+  char * qual;  /* nullptr if FASTA */
+  uint64_t hash;  /* of the canonical orientation with --strand both */
+};
+
+struct derep_chunk_s
+{
+  std::vector<struct derep_seq_s> seqs;
+  std::vector<char> data;
+};
+
+/* a hash table with the clusters of a part of the hash values; each
+   thread has its own shard, the shards are merged at the end */
+
+struct derep_shard_s
+{
+  struct bucket * hashtable;
+  uint64_t alloc_clusters;
+  uint64_t clusters;
+  struct derep_arena_s arena;
+  std::vector<char> rc_seq;
+};
+
+/* what the threads share */
+
+struct derep_info_s
+{
+  struct Parameters const * parameters;
+  bool use_header;
+  bool extra_info;
+  uint64_t alloc_seqs;
+  std::vector<unsigned int> nextseqtab;
+  std::vector<std::string> headertab;
+  std::vector<char> match_strand;
+  std::vector<struct derep_shard_s> shards;
+};
+
+constexpr auto terminal = std::numeric_limits<unsigned int>::max();
+
+static struct derep_info_s * derep_info;
+static struct derep_chunk_s * derep_chunk;
+static uint64_t derep_generation;  /* number of chunks given to the threads */
+static int derep_hashed;  /* threads done hashing the current chunk */
+static int derep_finished;  /* threads done with the current chunk */
+static bool derep_quit;
+static pthread_mutex_t derep_mutex;
+static pthread_cond_t derep_cond_work;
+static pthread_cond_t derep_cond_done;
+
+
+auto derep_shard_init(struct derep_shard_s & shard) -> void
+{
+  /* allocate initial memory for 1024 clusters */
+  shard.alloc_clusters = 1024;
+  shard.clusters = 0;
+  shard.hashtable =
+    (struct bucket *) xmalloc(sizeof(struct bucket) * 2 * shard.alloc_clusters);
+  memset(shard.hashtable, 0, sizeof(struct bucket) * 2 * shard.alloc_clusters);
+}
+
+
+auto derep_shard_free(struct derep_shard_s & shard) -> void
+{
+  xfree(shard.hashtable);
+  shard.hashtable = nullptr;
+  derep_arena_free(shard.arena);
+}
+
+
+auto derep_links_reserve(struct derep_info_s & info, uint64_t count) -> void
+{
+  /*
+    If the uc or tabbedout option is in effect, we need to keep some
+    extra info for each sequence: the link to the next sequence in its
+    cluster, its header and its matching strand.
+  */
+
+  if (not info.extra_info)
+    {
+      return;
+    }
+
+  while (count > info.alloc_seqs)
+    {
+      info.alloc_seqs *= 2;
+    }
+
+  if (info.alloc_seqs > info.nextseqtab.size())
+    {
+      info.nextseqtab.resize(info.alloc_seqs, terminal);
+      info.headertab.resize(info.alloc_seqs);
+      info.match_strand.resize(info.alloc_seqs);
+
+      show_rusage();
+    }
+}
+
+
+auto derep_hash(struct derep_info_s const & info,
+                struct derep_seq_s & seq) -> void
+{
+  /* hash the sequence as if in uppercase and with U replaced by T;
+     with --strand both, hash the orientation that sorts first, so that
+     a sequence and its reverse complement get the same hash */
+
+  uint64_t hash_header = 0;
+  if (info.use_header)
+    {
+      hash_header = HASH(seq.header, seq.headerlen);
+    }
+
+  if (info.parameters->opt_strand)
+    {
+      seq.hash = hash_cityhash64_canonical(seq.seq, seq.seqlen) ^ hash_header;
+    }
+  else
+    {
+      seq.hash = hash_cityhash64_normalized(seq.seq, seq.seqlen) ^ hash_header;
+    }
+}
+
+
+inline auto derep_shard_of(struct derep_info_s const & info,
+                           struct derep_seq_s const & seq) -> std::size_t
+{
+  return (seq.hash >> 32U) % info.shards.size();
+}
+
+
+auto derep_insert(struct derep_info_s & info,
+                  struct derep_shard_s & shard,
+                  struct derep_seq_s const & seq) -> void
+{
+  auto const & parameters = *info.parameters;
+
+  if (shard.clusters + 1 > shard.alloc_clusters)
+    {
+      rehash(& shard.hashtable, shard.alloc_clusters);
+      shard.alloc_clusters *= 2;
+    }
+
+  uint64_t const hash_mask = 2 * shard.alloc_clusters - 1;
+
+  /*
+    Find free bucket or bucket for identical sequence.
+    Make sure sequences are exactly identical
+    in case of any hash collision.
+    With 64-bit hashes, there is about 50% chance of a
+    collision when the number of sequences is about 5e9.
+    With --strand both, both strands have the same hash and
+    a single probe finds identical sequences on either strand.
+    The plus strand is compared first, and the reverse complement
+    is only computed when that comparison fails.
+  */
+
+  uint64_t j = seq.hash & hash_mask;
+  struct bucket * bp = shard.hashtable + j;
+  char * rc_seq = nullptr;
+  bool minus = false;
+
+  while (bp->size)
+    {
+      if ((seq.hash == bp->hash) and
+          (seq.seqlen == bp->seqlen) and
+          not (info.use_header and strcmp(seq.header, bp->header)))
+        {
+          if (not seqcmp(seq.seq, derep_seq(bp), seq.seqlen))
+            {
+              break;
+            }
+
+          if (parameters.opt_strand)
+            {
+              if (rc_seq == nullptr)
+                {
+                  if (shard.rc_seq.size() < static_cast<std::size_t>(seq.seqlen + 1))
+                    {
+                      shard.rc_seq.resize(seq.seqlen + 1);
+                    }
+                  rc_seq = shard.rc_seq.data();
+                  reverse_complement(rc_seq, seq.seq, seq.seqlen);
+                }
+              if (not seqcmp(rc_seq, derep_seq(bp), seq.seqlen))
+                {
+                  minus = true;
+                  break;
+                }
+            }
+        }
+      j = (j + 1) & hash_mask;
+      bp = shard.hashtable + j;
+    }
+
+  if (minus and info.extra_info)
+    {
+      info.match_strand[seq.seqno] = 1;
+    }
+
+  if (bp->size)
+    {
+      /* at least one identical sequence already */
+      if (info.extra_info)
+        {
+          unsigned int const last = bp->seqno_last;
+          info.nextseqtab[last] = seq.seqno;
+          bp->seqno_last = seq.seqno;
+          info.headertab[seq.seqno] = seq.header;
+        }
+
+      int64_t const s1 = bp->size;
+      int64_t const s2 = seq.abundance;
+      int64_t const s3 = s1 + s2;
+
+      if (parameters.opt_fastqout)
+        {
+          /* update quality scores */
+          char * qual = derep_qual(bp);
+          for (int i = 0; i < seq.seqlen; i++)
+            {
+              int const q1 = qual[i];
+              int const q2 = seq.qual[i];
+              double const p1 = convert_quality_symbol_to_probability(q1, parameters);
+              double const p2 = convert_quality_symbol_to_probability(q2, parameters);
+              double p3 = 0.0;
+
+              /* how to compute the new quality score? */
+
+              if (parameters.opt_fastq_qout_max)
+                {
+                  // fastq_qout_max
+                  /* min error prob, highest quality */
+                  p3 = std::min(p1, p2);
+                }
+              else
+                {
+                  // fastq_qout_avg
+                  /* average, as in USEARCH */
+                  p3 = (p1 * s1 + p2 * s2) / s3;
+                }
+
+              // fastq_qout_min
+              /* max error prob, lowest quality */
+              // p3 = MAX(p1, p2);
+
+              // fastq_qout_first
+              /* keep first */
+              // p3 = p1;
+
+              // fastq_qout_last
+              /* keep last */
+              // p3 = p2;
+
+              // fastq_qout_ef
+              /* Compute as multiple independent observations
+                 Edgar & Flyvbjerg (2015)
+                 But what about s1 and s2? */
+              // p3 = p1 * p2 / 3.0 / (1.0 - p1 - p2 + (4.0 * p1 * p2 / 3.0));
+
+              /* always worst quality possible, certain error */
+              // p3 = 1.0;
+
+              // always best quality possible, perfect, no errors */
+              // p3 = 0.0;
+
+              int const q3 = convert_probability_to_quality_symbol(p3, parameters);
+              qual[i] = q3;
+            }
+        }
+
+      bp->size = s3;
+      ++bp->count;
+    }
+  else
+    {
+      /* no identical sequences yet */
+      bp->size = seq.abundance;
+      bp->hash = seq.hash;
+      bp->seqno_first = seq.seqno;
+      bp->seqno_last = seq.seqno;
+      bp->headerlen = seq.headerlen;
+      bp->seqlen = seq.seqlen;
+      bp->count = 1;
+      bp->header = derep_arena_alloc(shard.arena,
+                                     seq.headerlen + 1 +
+                                     (seq.qual ? 2 : 1) * (seq.seqlen + 1));
+      memcpy(bp->header, seq.header, seq.headerlen + 1);
+      memcpy(derep_seq(bp), seq.seq, seq.seqlen + 1);
+      if (seq.qual) {
+        memcpy(derep_qual(bp), seq.qual, seq.seqlen + 1);
+      }
+      ++shard.clusters;
+    }
+}
+
+
+auto derep_worker(void * vp) -> void *
+{
+  /*
+    For each chunk, the threads first hash their part of its
+    sequences, then each thread inserts the sequences of its own
+    shard in their input order, so that the clusters, their first
+    sequence and the merged quality scores do not depend on the
+    number of threads.
+  */
+
+  auto const t = static_cast<std::size_t>(reinterpret_cast<int64_t>(vp));
+  auto & info = *derep_info;
+  auto & shard = info.shards[t];
+  auto const threads = info.shards.size();
+  uint64_t generation = 0;
+
+  xpthread_mutex_lock(&derep_mutex);
+  while (true)
+    {
+      while ((derep_generation == generation) and not derep_quit)
+        {
+          xpthread_cond_wait(&derep_cond_work, &derep_mutex);
+        }
+      if (derep_quit)
+        {
+          break;
+        }
+      generation = derep_generation;
+      auto & seqs = derep_chunk->seqs;
+      xpthread_mutex_unlock(&derep_mutex);
+
+      auto const first = seqs.size() * t / threads;
+      auto const last = seqs.size() * (t + 1) / threads;
+      for (auto i = first; i < last; i++)
+        {
+          derep_hash(info, seqs[i]);
+        }
+
+      xpthread_mutex_lock(&derep_mutex);
+      ++derep_hashed;
+      if (derep_hashed == static_cast<int>(threads))
+        {
+          xpthread_cond_broadcast(&derep_cond_work);
+        }
+      while (derep_hashed < static_cast<int>(threads))
+        {
+          xpthread_cond_wait(&derep_cond_work, &derep_mutex);
+        }
+      xpthread_mutex_unlock(&derep_mutex);
+
+      for (auto const & seq : seqs)
+        {
+          if (derep_shard_of(info, seq) == t)
+            {
+              derep_insert(info, shard, seq);
+            }
+        }
+
+      xpthread_mutex_lock(&derep_mutex);
+      ++derep_finished;
+      if (derep_finished == static_cast<int>(threads))
+        {
+          xpthread_cond_signal(&derep_cond_done);
+        }
+    }
+  xpthread_mutex_unlock(&derep_mutex);
+
+  return nullptr;
+}
+
+
+auto derep_wait() -> void
+{
+  /* wait for the threads to finish the current chunk */
+  auto const threads = static_cast<int>(derep_info->shards.size());
+  xpthread_mutex_lock(&derep_mutex);
+  while ((derep_generation > 0) and (derep_finished < threads))
+    {
+      xpthread_cond_wait(&derep_cond_done, &derep_mutex);
+    }
+  xpthread_mutex_unlock(&derep_mutex);
+}
+
+
+auto derep_dispatch(struct derep_chunk_s * chunk, bool fastq) -> void
+{
+  /* give a chunk to the threads, once they are done with the previous one */
+
+  derep_wait();
+
+  derep_links_reserve(*derep_info, chunk->seqs.back().seqno + 1);
+
+  for (auto & seq : chunk->seqs)
+    {
+      seq.header = chunk->data.data() + seq.offset;
+      seq.seq = seq.header + seq.headerlen + 1;
+      seq.qual = fastq ? seq.seq + seq.seqlen + 1 : nullptr;
+    }
+
+  xpthread_mutex_lock(&derep_mutex);
+  derep_chunk = chunk;
+  derep_hashed = 0;
+  derep_finished = 0;
+  ++derep_generation;
+  xpthread_cond_broadcast(&derep_cond_work);
+  xpthread_mutex_unlock(&derep_mutex);
+}
+
+
+auto derep_gather(struct derep_info_s const & info) -> std::vector<struct bucket *>
+{
+  /* the clusters of all shards; they stay in the tables of the shards */
+
+  uint64_t clusters = 0;
+  for (auto const & shard : info.shards)
+    {
+      clusters += shard.clusters;
+    }
+
+  std::vector<struct bucket *> order;
+  order.reserve(clusters);
+  for (auto const & shard : info.shards)
+    {
+      for (uint64_t j = 0; j < 2 * shard.alloc_clusters; j++)
+        {
+          if (shard.hashtable[j].size != 0U)
+            {
+              order.push_back(shard.hashtable + j);
+            }
+        }
+    }
+
+  return order;
+}
+
+
+auto derep_sort(std::vector<struct bucket *> & order) -> void
+{
+  /* sort the pointers, not the buckets */
+  std::sort(order.begin(), order.end(),
+            [](struct bucket const * lhs, struct bucket const * rhs) -> bool
+            {
+              return derep_compare_full(lhs, rhs) < 0;
+            });
+}
+
+
+/*
+  External memory dereplication (--memory_limit)
+
+  The sequences are written to temporary partition files according to
+  their hash value. Each partition is dereplicated in memory and its
+  clusters are written, sorted, to a temporary run file. A partition
+  expected to need more memory than the limit is split again, using
+  other bits of the hash. The runs are finally merged into one file,
+  which is read to write the output files.
+*/
+
+constexpr auto derep_spill_fanout_max = 64;  /* partitions per split */
+constexpr auto derep_spill_levels = 4;  /* splits of a partition at most */
+constexpr auto derep_spill_overhead = 256;  /* bytes of memory per sequence, besides its strings */
+constexpr auto derep_merge_fanout = 64;  /* runs merged at once */
+
+struct derep_spill_s  /* a partition file */
+{
+  std::FILE * fp;
+  uint64_t sequences;
+  uint64_t bytes;
+};
+
+struct derep_spill_entry_s  /* followed by header, sequence and quality */
+{
+  uint64_t seqno;
+  int64_t abundance;
+  uint64_t hash;
+  int64_t headerlen;
+  int64_t seqlen;
+};
+
+struct derep_run_s  /* a file of sorted clusters */
+{
+  std::FILE * fp;
+  uint64_t clusters;
+};
+
+struct derep_run_entry_s  /* followed by header, sequence, quality and members */
+{
+  unsigned int size;
+  unsigned int count;
+  unsigned int seqno_first;
+  uint64_t headerlen;
+  uint64_t seqlen;
+  uint64_t member_bytes;
+};
+
+struct derep_member_entry_s  /* followed by header */
+{
+  uint64_t headerlen;
+  bool minus;
+};
+
+struct derep_cluster_s  /* a cluster read from a run */
+{
+  struct bucket bucket;
+  uint64_t member_bytes;
+  std::vector<char> strings;
+};
+
+
+auto derep_spill_put(std::FILE * fp, void const * data, std::size_t length) -> void
+{
+  if (fwrite(data, 1, length, fp) != length)
+    {
+      fatal("Unable to write to temporary file");
+    }
+}
+
+
+auto derep_spill_get(std::FILE * fp, void * data, std::size_t length) -> void
+{
+  if (fread(data, 1, length, fp) != length)
+    {
+      fatal("Unable to read from temporary file");
+    }
+}
+
+
+auto derep_spill_open() -> std::FILE *
+{
+  std::FILE * fp = xtmpfile();
+  if (fp == nullptr)
+    {
+      fatal("Unable to create temporary file (see the TMPDIR environment variable)");
+    }
+  return fp;
+}
+
+
+inline auto derep_spill_index(uint64_t key, int level, std::size_t fanout) -> std::size_t
+{
+  /* a different odd multiplier mixes other bits of the hash at each level */
+  static constexpr uint64_t multiplier = 0x9E3779B97F4A7C15ULL;
+  uint64_t const mixed = key * (multiplier + 2 * static_cast<uint64_t>(level));
+  return (mixed >> 32U) % fanout;
+}
+
+
+inline auto derep_spill_memory(struct derep_spill_s const & spill) -> uint64_t
+{
+  return spill.bytes + spill.sequences * derep_spill_overhead;
+}
+
+
+auto derep_spill_write(struct derep_spill_s & spill,
+                       struct derep_seq_s const & seq,
+                       bool fastq) -> void
+{
+  struct derep_spill_entry_s entry;
+  entry.seqno = seq.seqno;
+  entry.abundance = seq.abundance;
+  entry.hash = seq.hash;
+  entry.headerlen = seq.headerlen;
+  entry.seqlen = seq.seqlen;
+
+  derep_spill_put(spill.fp, &entry, sizeof(entry));
+  derep_spill_put(spill.fp, seq.header, seq.headerlen + 1);
+  derep_spill_put(spill.fp, seq.seq, seq.seqlen + 1);
+  if (fastq)
+    {
+      derep_spill_put(spill.fp, seq.qual, seq.seqlen + 1);
+    }
+
+  ++spill.sequences;
+  spill.bytes += sizeof(entry) + seq.headerlen + 1 + (fastq ? 2 : 1) * (seq.seqlen + 1);
+}
+
+
+auto derep_spill_read(std::FILE * fp,
+                      struct derep_seq_s & seq,
+                      std::vector<char> & buffer,
+                      bool fastq) -> void
+{
+  struct derep_spill_entry_s entry;
+  derep_spill_get(fp, &entry, sizeof(entry));
+
+  seq.seqno = entry.seqno;
+  seq.abundance = entry.abundance;
+  seq.hash = entry.hash;
+  seq.headerlen = entry.headerlen;
+  seq.seqlen = entry.seqlen;
+
+  /* header, sequence and quality */
+  auto const strings = seq.headerlen + 1 + (fastq ? 2 : 1) * (seq.seqlen + 1);
+  if (buffer.size() < static_cast<std::size_t>(strings))
+    {
+      buffer.resize(strings);
+    }
+
+  seq.header = buffer.data();
+  seq.seq = seq.header + seq.headerlen + 1;
+  seq.qual = fastq ? seq.seq + seq.seqlen + 1 : nullptr;
+
+  derep_spill_get(fp, seq.header, seq.headerlen + 1);
+  derep_spill_get(fp, seq.seq, seq.seqlen + 1);
+  if (fastq)
+    {
+      derep_spill_get(fp, seq.qual, seq.seqlen + 1);
+    }
+}
+
+
+auto derep_run_write(std::FILE * fp,
+                     struct bucket const & cluster,
+                     uint64_t member_bytes,
+                     bool fastq) -> void
+{
+  struct derep_run_entry_s entry;
+  entry.size = cluster.size;
+  entry.count = cluster.count;
+  entry.seqno_first = cluster.seqno_first;
+  entry.headerlen = cluster.headerlen;
+  entry.seqlen = cluster.seqlen;
+  entry.member_bytes = member_bytes;
+
+  /* the header, sequence and quality are contiguous */
+  derep_spill_put(fp, &entry, sizeof(entry));
+  derep_spill_put(fp, cluster.header,
+                  entry.headerlen + 1 + (fastq ? 2 : 1) * (entry.seqlen + 1));
+}
+
+
+auto derep_run_read(std::FILE * fp,
+                    struct derep_cluster_s & cluster,
+                    bool fastq) -> void
+{
+  /* read a cluster, but not its members */
+
+  struct derep_run_entry_s entry;
+  derep_spill_get(fp, &entry, sizeof(entry));
+
+  cluster.strings.resize(entry.headerlen + 1 + (fastq ? 2 : 1) * (entry.seqlen + 1));
+  derep_spill_get(fp, cluster.strings.data(), cluster.strings.size());
+
+  auto & bucket = cluster.bucket;
+  bucket.hash = 0;
+  bucket.seqno_first = entry.seqno_first;
+  bucket.seqno_last = entry.seqno_first;
+  bucket.size = entry.size;
+  bucket.count = entry.count;
+  bucket.header = cluster.strings.data();
+  bucket.headerlen = entry.headerlen;
+  bucket.seqlen = entry.seqlen;
+  cluster.member_bytes = entry.member_bytes;
+}
+
+
+auto derep_runs_merge(std::vector<struct derep_run_s> & runs,
+                      bool fastq,
+                      double * median) -> struct derep_run_s
+{
+  /* k-way merge of sorted runs, optionally finding the median size */
+
+  struct derep_run_s merged;
+  merged.fp = derep_spill_open();
+  merged.clusters = 0;
+
+  uint64_t total = 0;
+  for (auto const & run : runs)
+    {
+      total += run.clusters;
+    }
+
+  std::vector<struct derep_cluster_s> heads(runs.size());
+  std::vector<uint64_t> remaining(runs.size());
+  std::vector<std::size_t> heap;
+  auto greater = [&heads](std::size_t lhs, std::size_t rhs) -> bool
+    {
+      return derep_compare_full(&heads[lhs].bucket, &heads[rhs].bucket) > 0;
+    };
+
+  for (std::size_t r = 0; r < runs.size(); r++)
+    {
+      std::rewind(runs[r].fp);
+      remaining[r] = runs[r].clusters;
+      if (remaining[r] > 0)
+        {
+          derep_run_read(runs[r].fp, heads[r], fastq);
+          heap.push_back(r);
+        }
+    }
+  std::make_heap(heap.begin(), heap.end(), greater);
+
+  unsigned int median_low = 0;
+  unsigned int median_high = 0;
+  std::vector<char> members(1 << 16);
+
+  while (not heap.empty())
+    {
+      std::pop_heap(heap.begin(), heap.end(), greater);
+      auto const r = heap.back();
+      auto & head = heads[r];
+
+      if (merged.clusters == (total - 1) / 2)
+        {
+          median_low = head.bucket.size;
+        }
+      if (merged.clusters == total / 2)
+        {
+          median_high = head.bucket.size;
+        }
+
+      derep_run_write(merged.fp, head.bucket, head.member_bytes, fastq);
+      for (uint64_t left = head.member_bytes; left > 0; )
+        {
+          auto const length = std::min<uint64_t>(left, members.size());
+          derep_spill_get(runs[r].fp, members.data(), length);
+          derep_spill_put(merged.fp, members.data(), length);
+          left -= length;
+        }
+      ++merged.clusters;
+
+      --remaining[r];
+      if (remaining[r] > 0)
+        {
+          derep_run_read(runs[r].fp, head, fastq);
+          std::push_heap(heap.begin(), heap.end(), greater);
+        }
+      else
+        {
+          heap.pop_back();
+        }
+    }
+
+  for (auto & run : runs)
     {
-      return -1;
+      std::fclose(run.fp);
     }
-  // same abundance
-  if (lhs->size == 0)
+
+  if ((median != nullptr) and (total > 0))
     {
-      return 0;
+      *median = (median_low + median_high) / 2.0;
     }
-  auto const result = std::strcmp(lhs->header, rhs->header);
-  if (result != 0)
+
+  return merged;
+}
+
+
+auto derep_runs_add(std::vector<std::vector<struct derep_run_s>> & runs,
+                    struct derep_run_s run,
+                    bool fastq) -> void
+{
+  /* keep a limited number of runs open: merge them when a level is full */
+
+  for (std::size_t level = 0; ; level++)
     {
-      return result;
+      if (runs.size() == level)
+        {
+          runs.emplace_back();
+        }
+      runs[level].push_back(run);
+      if (runs[level].size() < derep_merge_fanout)
+        {
+          break;
+        }
+      run = derep_runs_merge(runs[level], fastq, nullptr);
+      runs[level].clear();
     }
-  // same header (label)
-  if (lhs->seqno_first < rhs->seqno_first)
+}
+
+
+auto derep_spill_process(struct derep_info_s & info,
+                         struct derep_spill_s & spill,
+                         int level,
+                         std::vector<std::vector<struct derep_run_s>> & runs,
+                         bool fastq) -> void
+{
+  auto const memory_limit =
+    static_cast<uint64_t>(info.parameters->opt_memory_limit) << 20U;
+  std::vector<char> buffer;
+  struct derep_seq_s seq;
+
+  std::rewind(spill.fp);
+
+  if ((derep_spill_memory(spill) > memory_limit) and (level < derep_spill_levels))
     {
-      return -1;
+      /* too large: split it */
+
+      auto const fanout = static_cast<std::size_t>
+        (std::min<uint64_t>(derep_spill_fanout_max,
+                            2 + derep_spill_memory(spill) / memory_limit));
+      std::vector<struct derep_spill_s> parts(fanout);
+      for (auto & part : parts)
+        {
+          part.fp = derep_spill_open();
+          part.sequences = 0;
+          part.bytes = 0;
+        }
+
+      for (uint64_t i = 0; i < spill.sequences; i++)
+        {
+          derep_spill_read(spill.fp, seq, buffer, fastq);
+          derep_spill_write(parts[derep_spill_index(seq.hash, level + 1, fanout)],
+                            seq, fastq);
+        }
+      std::fclose(spill.fp);
+
+      for (auto & part : parts)
+        {
+          derep_spill_process(info, part, level + 1, runs, fastq);
+        }
+      return;
     }
-  if (lhs->seqno_first > rhs->seqno_first)
+
+  /* dereplicate it in memory, numbering its sequences from 0 */
+
+  auto & shard = info.shards[0];
+  std::vector<unsigned int> seqnos(spill.sequences);  /* in the input */
+
+  info.alloc_seqs = 1024;
+  info.nextseqtab.clear();
+  info.headertab.clear();
+  info.match_strand.clear();
+
+  for (uint64_t i = 0; i < spill.sequences; i++)
     {
-      return +1;
+      derep_spill_read(spill.fp, seq, buffer, fastq);
+      seqnos[i] = seq.seqno;
+      seq.seqno = i;
+      derep_links_reserve(info, i + 1);
+      derep_insert(info, shard, seq);
     }
-  // same ordinal value (impossible)
-  return 0;  // unreachable
-}
+  std::fclose(spill.fp);
 
+  auto order = derep_gather(info);
 
-auto rehash(struct bucket ** hashtableref, int64_t alloc_clusters) -> void
-{
-  /*
-    double the size of the hash table:
+  /* number the clusters as in the input; keep the link to the
+     members of each cluster in seqno_last, unused after insertion */
 
-    - allocate the new hash table
-    - rehash all entries from the old to the new table
-    - free the old table
-    - update variables
-  */
+  for (auto * cluster : order)
+    {
+      cluster->seqno_last = cluster->seqno_first;
+      cluster->seqno_first = seqnos[cluster->seqno_first];
+    }
 
-  auto * old_hashtable = *hashtableref;
-  uint64_t const old_hashtablesize = 2 * alloc_clusters;
-  uint64_t const new_hashtablesize = 2 * old_hashtablesize;
-  uint64_t const new_hash_mask = new_hashtablesize - 1;
+  derep_sort(order);
 
-  auto * new_hashtable =
-    (struct bucket *) xmalloc(sizeof(struct bucket) * new_hashtablesize);
-  memset(new_hashtable, 0, sizeof(struct bucket) * new_hashtablesize);
+  struct derep_run_s run;
+  run.fp = derep_spill_open();
+  run.clusters = order.size();
 
-  /* rehash all */
-  for (auto i = 0UL; i < old_hashtablesize; ++i)
+  for (auto const * bp : order)
     {
-      auto const & old_bucket = *std::next(old_hashtable, static_cast<long>(i));
-      if (old_bucket.size != 0U)
+      auto const & cluster = *bp;
+      uint64_t member_bytes = 0;
+      if (info.extra_info)
         {
-          auto new_index = old_bucket.hash & new_hash_mask;
-          while (std::next(new_hashtable, static_cast<long>(new_index))->size != 0U)
+          for (unsigned int next = info.nextseqtab[cluster.seqno_last];
+               next != terminal;
+               next = info.nextseqtab[next])
             {
-              new_index = (new_index + 1) & new_hash_mask;
+              member_bytes += sizeof(struct derep_member_entry_s) +
+                info.headertab[next].size() + 1;
             }
-          auto & new_bp = *std::next(new_hashtable, new_index);
+        }
 
-          new_bp = old_bucket;
+      derep_run_write(run.fp, cluster, member_bytes, fastq);
+
+      if (info.extra_info)
+        {
+          for (unsigned int next = info.nextseqtab[cluster.seqno_last];
+               next != terminal;
+               next = info.nextseqtab[next])
+            {
+              struct derep_member_entry_s member;
+              member.headerlen = info.headertab[next].size();
+              member.minus = info.match_strand[next] != 0;
+              derep_spill_put(run.fp, &member, sizeof(member));
+              derep_spill_put(run.fp, info.headertab[next].c_str(), member.headerlen + 1);
+            }
         }
     }
 
-  xfree(old_hashtable);
-  *hashtableref = new_hashtable;
+  derep_shard_free(shard);
+  derep_shard_init(shard);
+
+  derep_runs_add(runs, run, fastq);
 }
 
 
-inline auto convert_quality_symbol_to_probability(int const quality_symbol, struct Parameters const & parameters) -> double
+/* the sorted clusters, in memory or in a file */
+
+struct derep_cursor_s
 {
-  static constexpr auto minimal_quality_value = 2;
-  static constexpr auto maximal_probability = 0.75;
-  auto const quality_value = quality_symbol - static_cast<int>(parameters.opt_fastq_ascii);
-  if (quality_value < minimal_quality_value)
+  struct derep_info_s const * info;
+  std::vector<struct bucket *> const * order;  /* nullptr if in a file */
+  std::FILE * fp;
+  bool fastq;
+  struct derep_cluster_s cluster;
+  unsigned int next;  /* member in memory */
+  uint64_t member_bytes;  /* members left in the file */
+  std::vector<char> member_header;
+};
+
+
+auto derep_cursor_rewind(struct derep_cursor_s & cursor) -> void
+{
+  if (cursor.fp != nullptr)
     {
-      return maximal_probability;
+      std::rewind(cursor.fp);
+      cursor.member_bytes = 0;
     }
-  static constexpr auto base = 10.0;
-  return std::pow(base, -quality_value / base);
 }
 
 
-inline auto convert_probability_to_quality_symbol(double const probability, struct Parameters const & parameters) -> int
+auto derep_cursor_next(struct derep_cursor_s & cursor, uint64_t i) -> struct bucket *
 {
-  static constexpr auto base = 10.0;
-  auto quality_value = static_cast<int64_t>(std::trunc(-base * std::log10(probability)));
-  quality_value = std::min(quality_value, parameters.opt_fastq_qmaxout);
-  quality_value = std::max(quality_value, parameters.opt_fastq_qminout);
-  return static_cast<int>(quality_value + parameters.opt_fastq_asciiout);
+  /* the clusters must be read in order after a rewind */
+
+  if (cursor.order != nullptr)
+    {
+      struct bucket * bp = (*cursor.order)[i];
+      cursor.next = cursor.info->extra_info ?
+        cursor.info->nextseqtab[bp->seqno_first] : terminal;
+      return bp;
+    }
+
+  if (cursor.member_bytes > 0)
+    {
+      xfseeko(cursor.fp, cursor.member_bytes, SEEK_CUR);
+    }
+  derep_run_read(cursor.fp, cursor.cluster, cursor.fastq);
+  cursor.member_bytes = cursor.cluster.member_bytes;
+  return &cursor.cluster.bucket;
+}
+
+
+auto derep_cursor_member(struct derep_cursor_s & cursor,
+                         char const ** header,
+                         bool * minus) -> bool
+{
+  /* the next member of the current cluster, after its first sequence */
+
+  if (cursor.order != nullptr)
+    {
+      if (cursor.next == terminal)
+        {
+          return false;
+        }
+      *header = cursor.info->headertab[cursor.next].c_str();
+      *minus = cursor.info->match_strand[cursor.next] != 0;
+      cursor.next = cursor.info->nextseqtab[cursor.next];
+      return true;
+    }
+
+  if (cursor.member_bytes == 0)
+    {
+      return false;
+    }
+  struct derep_member_entry_s member;
+  derep_spill_get(cursor.fp, &member, sizeof(member));
+  cursor.member_header.resize(member.headerlen + 1);
+  derep_spill_get(cursor.fp, cursor.member_header.data(), member.headerlen + 1);
+  cursor.member_bytes -= sizeof(member) + member.headerlen + 1;
+  *header = cursor.member_header.data();
+  *minus = member.minus;
+  return true;
 }
 
 
@@ -314,49 +1328,77 @@ auto derep(struct Parameters const & parameters, char * input_filename, bool use
   uint64_t const filesize = fastx_get_size(input_handle);
 
 
-  /* allocate initial memory for 1024 clusters
-     with sequences of length 1023 */
+  /* with --memory_limit, the sequences are dereplicated on disk
+     by a single thread */
 
-  uint64_t alloc_clusters = 1024;
-  uint64_t alloc_seqs = 1024;
-  int64_t alloc_seqlen = 1023;
+  bool const external = parameters.opt_memory_limit > 0;
 
-  uint64_t hashtablesize = 2 * alloc_clusters;
-  uint64_t hash_mask = hashtablesize - 1;
-  auto * hashtable =
-    (struct bucket *) xmalloc(sizeof(struct bucket) * hashtablesize);
-  memset(hashtable, 0, sizeof(struct bucket) * hashtablesize);
+  struct derep_info_s info;
+  info.parameters = &parameters;
+  info.use_header = use_header;
+  info.extra_info = parameters.opt_uc or parameters.opt_tabbedout;
+  info.alloc_seqs = 1024;
+  info.shards.resize(external ? 1 : parameters.opt_threads);
+  for (auto & shard : info.shards)
+    {
+      derep_shard_init(shard);
+    }
 
   show_rusage();
 
-  constexpr auto terminal = std::numeric_limits<unsigned int>::max();
-  std::vector<unsigned int> nextseqtab;
-  std::vector<std::string> headertab;
-  std::vector<char> match_strand;
+  if (info.extra_info)
+    {
+      /* Allocate and init memory for the extra info */
+      info.nextseqtab.resize(info.alloc_seqs, terminal);
+      info.headertab.resize(info.alloc_seqs);
+      info.match_strand.resize(info.alloc_seqs);
+    }
 
-  auto const extra_info = parameters.opt_uc or parameters.opt_tabbedout;
+  show_rusage();
 
-  if (extra_info)
-    {
-      /* If the uc or tabbedout option is in effect,
-         we need to keep some extra info.
-         Allocate and init memory for this. */
+  std::string prompt = std::string("Dereplicating file ") + input_filename;
 
-      /* Links to other sequences in cluster */
-      nextseqtab.resize(alloc_seqs, terminal);
+  /* with several threads, a chunk is read while the threads process
+     the previous one */
 
-      /* Pointers to the header strings */
-      headertab.resize(alloc_seqs);
+  bool const parallel = (parameters.opt_threads > 1) and not external;
+  bool const fastq = fastx_is_fastq(input_handle);
+  std::vector<struct derep_chunk_s> chunks(parallel ? 2 : 0);
+  struct derep_chunk_s * chunk = nullptr;
+  std::vector<pthread_t> threads;
 
-      /* Matching strand */
-      match_strand.resize(alloc_seqs);
+  if (parallel)
+    {
+      derep_info = &info;
+      derep_generation = 0;
+      derep_quit = false;
+      xpthread_mutex_init(&derep_mutex, nullptr);
+      xpthread_cond_init(&derep_cond_work, nullptr);
+      xpthread_cond_init(&derep_cond_done, nullptr);
+      threads.resize(parameters.opt_threads);
+      for (int64_t t = 0; t < parameters.opt_threads; t++)
+        {
+          xpthread_create(&threads[t], nullptr, derep_worker, (void *) t);
+        }
+      chunk = chunks.data();
     }
 
-  show_rusage();
+  /* partitions of the input, more if it is large */
 
-  std::vector<char> seq_up(alloc_seqlen + 1);
-  std::vector<char> rc_seq_up(alloc_seqlen + 1);
-  std::string prompt = std::string("Dereplicating file ") + input_filename;
+  std::vector<struct derep_spill_s> spills;
+
+  if (external)
+    {
+      auto const memory_limit = static_cast<uint64_t>(parameters.opt_memory_limit) << 20U;
+      spills.resize(std::min<uint64_t>(derep_spill_fanout_max,
+                                       1 + 2 * filesize / memory_limit));
+      for (auto & spill : spills)
+        {
+          spill.fp = derep_spill_open();
+          spill.sequences = 0;
+          spill.bytes = 0;
+        }
+    }
 
   progress_init(prompt.c_str(), filesize);
 
@@ -392,221 +1434,88 @@ auto derep(struct Parameters const & parameters, char * input_filename, bool use
       longest = std::max(seqlen, longest);
       shortest = std::min(seqlen, shortest);
 
-      /* check allocations */
-
-      if (seqlen > alloc_seqlen)
-        {
-          alloc_seqlen = seqlen;
-          seq_up.resize(alloc_seqlen + 1);
-          rc_seq_up.resize(alloc_seqlen + 1);
-
-          show_rusage();
-        }
-
-      if (extra_info and (sequencecount + 1 > alloc_seqs))
-        {
-          uint64_t const new_alloc_seqs = 2 * alloc_seqs;
-
-          nextseqtab.resize(new_alloc_seqs, terminal);
-
-          headertab.resize(new_alloc_seqs);
-
-          match_strand.resize(new_alloc_seqs);
-
-          alloc_seqs = new_alloc_seqs;
-
-          show_rusage();
-        }
-
-      if (clusters + 1 > alloc_clusters)
-        {
-          uint64_t const new_alloc_clusters = 2 * alloc_clusters;
-
-          rehash(& hashtable, alloc_clusters);
-
-          alloc_clusters = new_alloc_clusters;
-          hashtablesize = 2 * alloc_clusters;
-          hash_mask = hashtablesize - 1;
-
-          show_rusage();
-        }
-
-      char * seq = fastx_get_sequence(input_handle);
-      char * header = fastx_get_header(input_handle);
-      int64_t const headerlen = fastx_get_header_length(input_handle);
-      char * qual = fastx_get_quality(input_handle); // nullptr if FASTA
-
-      /* normalize sequence: uppercase and replace U by T  */
-      string_normalize(seq_up.data(), seq, seqlen);
-
-      /* reverse complement if necessary */
-      if (parameters.opt_strand)
-        {
-          reverse_complement(rc_seq_up.data(), seq_up.data(), seqlen);
-        }
-
-      /*
-        Find free bucket or bucket for identical sequence.
-        Make sure sequences are exactly identical
-        in case of any hash collision.
-        With 64-bit hashes, there is about 50% chance of a
-        collision when the number of sequences is about 5e9.
-      */
-
-      uint64_t hash_header = 0;
-      if (use_header)
-        {
-          hash_header = HASH(header, headerlen);
-        }
-      else
-        {
-          hash_header = 0;
-        }
-
-      uint64_t const hash = HASH(seq_up.data(), seqlen) ^ hash_header;
-      uint64_t j = hash & hash_mask;
-      struct bucket * bp = hashtable + j;
+      int const abundance = fastx_get_abundance(input_handle);
+      int64_t const ab = parameters.opt_sizein ? abundance : 1;
+      sumsize += ab;
 
-      while ((bp->size) and
-             ((hash != bp->hash) or
-              (seqcmp(seq_up.data(), bp->seq, seqlen)) or
-              (use_header and strcmp(header, bp->header))))
-        {
-          j = (j + 1) & hash_mask;
-          bp = hashtable + j;
-        }
+      struct derep_seq_s seq;
+      seq.seqno = sequencecount;
+      seq.seqlen = seqlen;
+      seq.headerlen = fastx_get_header_length(input_handle);
+      seq.abundance = ab;
 
-      if (parameters.opt_strand and not bp->size)
+      if (parallel)
         {
-          /* no match on plus strand */
-          /* check minus strand as well */
-
-          uint64_t const rc_hash = HASH(rc_seq_up.data(), seqlen) ^ hash_header;
-          uint64_t k = rc_hash & hash_mask;
-          struct bucket * rc_bp = hashtable + k;
-
-          while ((rc_bp->size)
-                 and
-                 ((rc_hash != rc_bp->hash) or
-                  (seqcmp(rc_seq_up.data(), rc_bp->seq, seqlen)) or
-                  (use_header and strcmp(header, rc_bp->header))))
+          /* copy header, sequence and quality to the chunk */
+
+          auto & data = chunk->data;
+          seq.offset = data.size();
+          char * header = fastx_get_header(input_handle);
+          char * sequence = fastx_get_sequence(input_handle);
+          data.insert(data.end(), header, header + seq.headerlen + 1);
+          data.insert(data.end(), sequence, sequence + seqlen + 1);
+          if (fastq)
             {
-              k = (k + 1) & hash_mask;
-              rc_bp = hashtable + k;
+              char * qual = fastx_get_quality(input_handle);
+              data.insert(data.end(), qual, qual + seqlen + 1);
             }
+          chunk->seqs.push_back(seq);
 
-          if (rc_bp->size)
+          if (chunk->seqs.size() == derep_chunk_size)
             {
-              bp = rc_bp;
-              j = k;
-              if (extra_info)
-                {
-                  match_strand[sequencecount] = 1;
-                }
+              derep_dispatch(chunk, fastq);
+              chunk = (chunk == chunks.data()) ? chunks.data() + 1 : chunks.data();
+              chunk->seqs.clear();
+              chunk->data.clear();
             }
         }
+      else
+        {
+          seq.offset = 0;
+          seq.header = fastx_get_header(input_handle);
+          seq.seq = fastx_get_sequence(input_handle);
+          seq.qual = fastx_get_quality(input_handle); // nullptr if FASTA
 
-      int const abundance = fastx_get_abundance(input_handle);
-      int64_t const ab = parameters.opt_sizein ? abundance : 1;
-      sumsize += ab;
+          derep_hash(info, seq);
 
-      if (bp->size)
-        {
-          /* at least one identical sequence already */
-          if (extra_info)
+          if (external)
             {
-              unsigned int const last = bp->seqno_last;
-              nextseqtab[last] = sequencecount;
-              bp->seqno_last = sequencecount;
-              headertab[sequencecount] = header;
+              auto const p = derep_spill_index(seq.hash, 0, spills.size());
+              derep_spill_write(spills[p], seq, fastq);
             }
-
-          int64_t const s1 = bp->size;
-          int64_t const s2 = ab;
-          int64_t const s3 = s1 + s2;
-
-          if (parameters.opt_fastqout)
+          else
             {
-              /* update quality scores */
-              for (int i = 0; i < seqlen; i++)
-                {
-                  int const q1 = bp->qual[i];
-                  int const q2 = qual[i];
-                  double const p1 = convert_quality_symbol_to_probability(q1, parameters);
-                  double const p2 = convert_quality_symbol_to_probability(q2, parameters);
-                  double p3 = 0.0;
-
-                  /* how to compute the new quality score? */
-
-                  if (parameters.opt_fastq_qout_max)
-                    {
-                      // fastq_qout_max
-                      /* min error prob, highest quality */
-                      p3 = std::min(p1, p2);
-                    }
-                  else
-                    {
-                      // fastq_qout_avg
-                      /* average, as in USEARCH */
-                      p3 = (p1 * s1 + p2 * s2) / s3;
-                    }
-
-                  // fastq_qout_min
-                  /* max error prob, lowest quality */
-                  // p3 = MAX(p1, p2);
-
-                  // fastq_qout_first
-                  /* keep first */
-                  // p3 = p1;
-
-                  // fastq_qout_last
-                  /* keep last */
-                  // p3 = p2;
-
-                  // fastq_qout_ef
-                  /* Compute as multiple independent observations
-                     Edgar & Flyvbjerg (2015)
-                     But what about s1 and s2? */
-                  // p3 = p1 * p2 / 3.0 / (1.0 - p1 - p2 + (4.0 * p1 * p2 / 3.0));
-
-                  /* always worst quality possible, certain error */
-                  // p3 = 1.0;
-
-                  // always best quality possible, perfect, no errors */
-                  // p3 = 0.0;
-
-                  int const q3 = convert_probability_to_quality_symbol(p3, parameters);
-                  bp->qual[i] = q3;
-                }
+              derep_links_reserve(info, sequencecount + 1);
+              derep_insert(info, info.shards[0], seq);
             }
-
-          bp->size = s3;
-          ++bp->count;
-        }
-      else
-        {
-          /* no identical sequences yet */
-          bp->size = ab;
-          bp->hash = hash;
-          bp->seqno_first = sequencecount;
-          bp->seqno_last = sequencecount;
-          bp->seq = xstrdup(seq);
-          bp->header = xstrdup(header);
-          bp->count = 1;
-          if (qual) {
-            bp->qual = xstrdup(qual);
-          } else {
-            bp->qual = nullptr;
-          }
-          ++clusters;
         }
 
-      maxsize = std::max<uint64_t>(bp->size, maxsize);
-
       ++sequencecount;
 
       progress_update(fastx_get_position(input_handle));
     }
+
+  if (parallel)
+    {
+      if (not chunk->seqs.empty())
+        {
+          derep_dispatch(chunk, fastq);
+        }
+      derep_wait();
+
+      xpthread_mutex_lock(&derep_mutex);
+      derep_quit = true;
+      xpthread_cond_broadcast(&derep_cond_work);
+      xpthread_mutex_unlock(&derep_mutex);
+      for (auto & thread : threads)
+        {
+          xpthread_join(thread, nullptr);
+        }
+      xpthread_cond_destroy(&derep_cond_done);
+      xpthread_cond_destroy(&derep_cond_work);
+      xpthread_mutex_destroy(&derep_mutex);
+    }
+
   progress_done();
   fastx_close(input_handle);
 
@@ -694,25 +1603,78 @@ auto derep(struct Parameters const & parameters, char * input_filename, bool use
 
   show_rusage();
 
-  progress_init("Sorting", 1);
-  qsort(hashtable, hashtablesize, sizeof(struct bucket), derep_compare_full);
-  progress_done();
+  std::vector<struct bucket *> order;
+  struct derep_cursor_s cursor;
+  cursor.info = &info;
+  cursor.order = nullptr;
+  cursor.fp = nullptr;
+  cursor.fastq = fastq;
+  cursor.next = terminal;
+  cursor.member_bytes = 0;
 
-  show_rusage();
+  if (external)
+    {
+      std::vector<std::vector<struct derep_run_s>> levels;
+
+      progress_init("Dereplicating partitions", spills.size());
+      for (std::size_t p = 0; p < spills.size(); ++p)
+        {
+          derep_spill_process(info, spills[p], 0, levels, fastq);
+          progress_update(p);
+        }
+      progress_done();
+      derep_shard_free(info.shards[0]);
+
+      show_rusage();
+
+      std::vector<struct derep_run_s> runs;
+      for (auto const & level : levels)
+        {
+          runs.insert(runs.end(), level.begin(), level.end());
+        }
+
+      progress_init("Merging", 1);
+      auto const merged = derep_runs_merge(runs, fastq, &median);
+      progress_done();
 
-  if (clusters > 0)
+      clusters = merged.clusters;
+      cursor.fp = merged.fp;
+      if (clusters > 0)
+        {
+          derep_cursor_rewind(cursor);
+          maxsize = derep_cursor_next(cursor, 0)->size;
+        }
+    }
+  else
     {
-      if (clusters % 2)
+      order = derep_gather(info);
+      clusters = order.size();
+      for (auto const * bp : order)
         {
-          median = hashtable[(clusters - 1) / 2].size;
+          maxsize = std::max<uint64_t>(bp->size, maxsize);
         }
-      else
+
+      progress_init("Sorting", 1);
+      derep_sort(order);
+      progress_done();
+
+      if (clusters > 0)
         {
-          median = (hashtable[(clusters / 2) - 1].size +
-                    hashtable[clusters / 2].size) / 2.0;
+          if (clusters % 2)
+            {
+              median = order[(clusters - 1) / 2]->size;
+            }
+          else
+            {
+              median = (order[(clusters / 2) - 1]->size +
+                        order[clusters / 2]->size) / 2.0;
+            }
         }
+      cursor.order = &order;
     }
 
+  show_rusage();
+
   average = 1.0 * sumsize / clusters;
 
   if (clusters < 1)
@@ -751,9 +1713,10 @@ auto derep(struct Parameters const & parameters, char * input_filename, bool use
   /* count selected */
 
   uint64_t selected = 0;
+  derep_cursor_rewind(cursor);
   for (uint64_t i = 0; i < clusters; ++i)
     {
-      struct bucket * bp = hashtable + i;
+      struct bucket * bp = derep_cursor_next(cursor, i);
       int64_t const size = bp->size;
       if ((size >= parameters.opt_minuniquesize) and (size <= parameters.opt_maxuniquesize))
         {
@@ -772,21 +1735,22 @@ auto derep(struct Parameters const & parameters, char * input_filename, bool use
   if (parameters.opt_output or parameters.opt_fastaout)
     {
       progress_init("Writing FASTA output file", clusters);
+      derep_cursor_rewind(cursor);
 
       int64_t relabel_count = 0;
       for (uint64_t i = 0; i < clusters; ++i)
         {
-          struct bucket * bp = hashtable + i;
+          struct bucket * bp = derep_cursor_next(cursor, i);
           int64_t const size = bp->size;
           if ((size >= parameters.opt_minuniquesize) and (size <= parameters.opt_maxuniquesize))
             {
               ++relabel_count;
               fasta_print_general(fp_fastaout,
                                   nullptr,
-                                  bp->seq,
-                                  strlen(bp->seq),
+                                  derep_seq(bp),
+                                  bp->seqlen,
                                   bp->header,
-                                  strlen(bp->header),
+                                  bp->headerlen,
                                   size,
                                   relabel_count,
                                   -1.0,
@@ -806,21 +1770,22 @@ auto derep(struct Parameters const & parameters, char * input_filename, bool use
   if (parameters.opt_fastqout)
     {
       progress_init("Writing FASTQ output file", clusters);
+      derep_cursor_rewind(cursor);
 
       int64_t relabel_count = 0;
       for (uint64_t i = 0; i < clusters; ++i)
         {
-          struct bucket * bp = hashtable + i;
+          struct bucket * bp = derep_cursor_next(cursor, i);
           int64_t const size = bp->size;
           if ((size >= parameters.opt_minuniquesize) and (size <= parameters.opt_maxuniquesize))
             {
               ++relabel_count;
               fastq_print_general(fp_fastqout,
-                                  bp->seq,
-                                  strlen(bp->seq),
+                                  derep_seq(bp),
+                                  bp->seqlen,
                                   bp->header,
-                                  strlen(bp->header),
-                                  bp->qual,
+                                  bp->headerlen,
+                                  derep_qual(bp),
                                   size,
                                   relabel_count,
                                   -1.0);
@@ -841,24 +1806,25 @@ auto derep(struct Parameters const & parameters, char * input_filename, bool use
   if (parameters.opt_uc)
     {
       progress_init("Writing uc file, first part", clusters);
+      derep_cursor_rewind(cursor);
       for (uint64_t i = 0; i < clusters; ++i)
         {
-          struct bucket * bp = hashtable + i;
+          struct bucket * bp = derep_cursor_next(cursor, i);
           char * hh =  bp->header;
-          int64_t const len = strlen(bp->seq);
+          int64_t const len = bp->seqlen;
 
           fprintf(fp_uc, "S\t%" PRId64 "\t%" PRId64 "\t*\t*\t*\t*\t*\t%s\t*\n",
                   i, len, hh);
 
-          for (unsigned int next = nextseqtab[bp->seqno_first];
-               next != terminal;
-               next = nextseqtab[next])
+          char const * member = nullptr;
+          bool minus = false;
+          while (derep_cursor_member(cursor, &member, &minus))
             {
               fprintf(fp_uc,
                       "H\t%" PRId64 "\t%" PRId64 "\t%.1f\t%s\t0\t0\t*\t%s\t%s\n",
                       i, len, 100.0,
-                      (match_strand[next] ? "-" : "+"),
-                      headertab[next].c_str(), hh);
+                      (minus ? "-" : "+"),
+                      member, hh);
             }
 
           progress_update(i);
@@ -866,9 +1832,10 @@ auto derep(struct Parameters const & parameters, char * input_filename, bool use
       progress_done();
 
       progress_init("Writing uc file, second part", clusters);
+      derep_cursor_rewind(cursor);
       for (uint64_t i = 0; i < clusters; ++i)
         {
-          struct bucket * bp = hashtable + i;
+          struct bucket * bp = derep_cursor_next(cursor, i);
           fprintf(fp_uc, "C\t%" PRId64 "\t%u\t*\t*\t*\t*\t*\t%s\t*\n",
                   i, bp->size, bp->header);
           progress_update(i);
@@ -880,9 +1847,10 @@ auto derep(struct Parameters const & parameters, char * input_filename, bool use
   if (parameters.opt_tabbedout)
     {
       progress_init("Writing tab separated file", clusters);
+      derep_cursor_rewind(cursor);
       for (uint64_t i = 0; i < clusters; ++i)
         {
-          struct bucket * bp = hashtable + i;
+          struct bucket * bp = derep_cursor_next(cursor, i);
           char * hh =  bp->header;
 
           if (parameters.opt_relabel) {
@@ -895,18 +1863,18 @@ auto derep(struct Parameters const & parameters, char * input_filename, bool use
           }
 
           uint64_t j = 1;
-          for (unsigned int next = nextseqtab[bp->seqno_first];
-               next != terminal;
-               next = nextseqtab[next])
+          char const * member = nullptr;
+          bool minus = false;
+          while (derep_cursor_member(cursor, &member, &minus))
             {
               if (parameters.opt_relabel) {
                 fprintf(fp_tabbedout,
                         "%s\t%s%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%u\t%s\n",
-                        headertab[next].c_str(), parameters.opt_relabel, i + 1, i, j, bp->count, hh);
+                        member, parameters.opt_relabel, i + 1, i, j, bp->count, hh);
               } else {
                 fprintf(fp_tabbedout,
                         "%s\t%s\t%" PRIu64 "\t%" PRIu64 "\t%u\t%s\n",
-                        headertab[next].c_str(), hh, i, j, bp->count, hh);
+                        member, hh, i, j, bp->count, hh);
               }
               ++j;
             }
@@ -945,22 +1913,17 @@ auto derep(struct Parameters const & parameters, char * input_filename, bool use
 
   /* Free all seqs and headers */
 
-  for (uint64_t i = 0; i < clusters; ++i)
+  if (external)
+    {
+      fclose(cursor.fp);
+    }
+  else
     {
-      struct bucket * bp = hashtable + i;
-      if (bp->size)
+      for (auto & shard : info.shards)
         {
-          xfree(bp->seq);
-          xfree(bp->header);
-          if (bp->qual) {
-            xfree(bp->qual);
-          }
+          derep_shard_free(shard);
         }
     }
 
   show_rusage();
-
-  xfree(hashtable);
-
-  show_rusage();
 }
@@ -59,6 +59,7 @@
 */
 
 #include "vsearch.h"
+#include "utils/maps.hpp"
 #include "utils/seqcmp.h"
 #include <algorithm>  // std::max
 #include <cinttypes>  // macros PRIu64 and PRId64
@@ -195,8 +196,6 @@ auto derep_prefix(struct Parameters const & parameters) -> void
   constexpr auto terminal = std::numeric_limits<unsigned int>::max();
   std::vector<unsigned int> nextseqtab(dbsequencecount, terminal);
 
-  std::vector<char> seq_up(db_getlongestsequence() + 1);
-
   /* make table of hash values of prefixes */
 
   unsigned int const len_longest = db_getlongestsequence();
@@ -209,9 +208,6 @@ auto derep_prefix(struct Parameters const & parameters) -> void
       unsigned int const seqlen = db_getsequencelen(i);
       char * seq = db_getsequence(i);
 
-      /* normalize sequence: uppercase and replace U by T  */
-      string_normalize(seq_up.data(), seq, seqlen);
-
       uint64_t const ab = parameters.opt_sizein ? db_getabundance(i) : 1;
       sumsize += ab;
 
@@ -235,13 +231,14 @@ auto derep_prefix(struct Parameters const & parameters) -> void
 
       */
 
-      /* compute hashes of all prefixes */
+      /* compute hashes of all prefixes, normalizing the sequence
+         (uppercase and U replaced by T) on the fly */
 
       uint64_t fnv1a_hash = 14695981039346656037ULL;
       prefix_hashes[0] = fnv1a_hash;
       for (unsigned int j = 0; j < seqlen; j++)
         {
-          fnv1a_hash ^= seq_up[j];
+          fnv1a_hash ^= chrmap_normalize_vector[static_cast<unsigned char>(seq[j])];
           fnv1a_hash *= 1099511628211ULL;
           prefix_hashes[j + 1] = fnv1a_hash;
         }
@@ -257,7 +254,7 @@ auto derep_prefix(struct Parameters const & parameters) -> void
              ((bp->deleted) or
               (bp->hash != hash) or
               (prefix_len != db_getsequencelen(bp->seqno_first)) or
-              (seqcmp(seq_up.data(), db_getsequence(bp->seqno_first), prefix_len))))
+              (seqcmp(seq, db_getsequence(bp->seqno_first), prefix_len))))
         {
           ++bp;
           if (bp >= &hashtable[hashtablesize])
@@ -296,7 +293,7 @@ auto derep_prefix(struct Parameters const & parameters) -> void
                      ((bp->deleted) or
                       (bp->hash != hash) or
                       (prefix_len != db_getsequencelen(bp->seqno_first)) or
-                      (seqcmp(seq_up.data(),
+                      (seqcmp(seq,
                               db_getsequence(bp->seqno_first),
                               prefix_len))))
                 {
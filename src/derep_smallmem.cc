@@ -71,8 +71,6 @@
 #include <vector>
 
 
-#define HASH hash_cityhash128
-
 struct sm_bucket
 {
   uint128 hash;
@@ -266,9 +264,6 @@ auto derep_smallmem(struct Parameters const & parameters) -> void
 
   auto const filesize = fastx_get_size(h);
 
-  /* allocate initial memory for sequences of length up to 1023 chars */
-  int64_t alloc_seqlen = 1024;
-
   /* allocate initial hashtable with 1024 buckets */
 
   hashtablesize = 1024;
@@ -284,9 +279,6 @@ auto derep_smallmem(struct Parameters const & parameters) -> void
 
   show_rusage();
 
-  std::vector<char> seq_up(alloc_seqlen + 1);
-  std::vector<char> rc_seq_up(alloc_seqlen + 1);
-
   std::string prompt = std::string("Dereplicating file ") + input_filename;
 
   progress_init(prompt.c_str(), filesize);
@@ -323,17 +315,6 @@ auto derep_smallmem(struct Parameters const & parameters) -> void
       longest = std::max(seqlen, longest);
       shortest = std::min(seqlen, shortest);
 
-      /* check allocations */
-
-      if (seqlen > alloc_seqlen)
-        {
-          alloc_seqlen = seqlen;
-          seq_up.resize(alloc_seqlen + 1);
-          rc_seq_up.resize(alloc_seqlen + 1);
-
-          show_rusage();
-        }
-
       if (100 * (clusters + 1) > 95 * hashtablesize)
         {
           // keep hash table fill rate at max 95% */
@@ -343,16 +324,10 @@ auto derep_smallmem(struct Parameters const & parameters) -> void
 
       char * seq = fastx_get_sequence(h);
 
-      /* normalize sequence: uppercase and replace U by T  */
-      string_normalize(seq_up.data(), seq, seqlen);
-
-      /* reverse complement if necessary */
-      if (parameters.opt_strand)
-        {
-          reverse_complement(rc_seq_up.data(), seq_up.data(), seqlen);
-        }
-
       /*
+        The sequence is hashed as if in uppercase and with U replaced by T.
+        With --strand both, the orientation that sorts first is hashed,
+        so both strands of a sequence end up in the same bucket.
         Find free bucket or bucket for identical sequence.
         Make sure sequences are exactly identical
         in case of any hash collision.
@@ -360,7 +335,9 @@ auto derep_smallmem(struct Parameters const & parameters) -> void
         collision when the number of sequences is about 5e9.
       */
 
-      uint128 const hash = HASH(seq_up.data(), seqlen);
+      uint128 const hash = parameters.opt_strand ?
+        hash_cityhash128_canonical(seq, seqlen) :
+        hash_cityhash128_normalized(seq, seqlen);
       uint64_t j =  hash2bucket(hash, hashtablesize);
       struct sm_bucket * bp = hashtable + j;
 
@@ -370,28 +347,6 @@ auto derep_smallmem(struct Parameters const & parameters) -> void
           bp = hashtable + j;
         }
 
-      if (parameters.opt_strand and not bp->size)
-        {
-          /* no match on plus strand */
-          /* check minus strand as well */
-
-          uint128 const rc_hash = HASH(rc_seq_up.data(), seqlen);
-          uint64_t k =  hash2bucket(rc_hash, hashtablesize);
-          struct sm_bucket * rc_bp = hashtable + k;
-
-          while ((rc_bp->size) and (rc_hash != rc_bp->hash))
-            {
-              k = next_bucket(k, hashtablesize);
-              rc_bp = hashtable + k;
-            }
-
-          if (rc_bp->size)
-            {
-              bp = rc_bp;
-              j = k;
-            }
-        }
-
       int const abundance = fastx_get_abundance(h);
       int64_t const ab = parameters.opt_sizein ? abundance : 1;
       sumsize += ab;
@@ -562,16 +517,10 @@ auto derep_smallmem(struct Parameters const & parameters) -> void
 
       char * seq = fastx_get_sequence(h2);
 
-      /* normalize sequence: uppercase and replace U by T  */
-      string_normalize(seq_up.data(), seq, seqlen);
-
-      /* reverse complement if necessary */
-      if (parameters.opt_strand)
-        {
-          reverse_complement(rc_seq_up.data(), seq_up.data(), seqlen);
-        }
-
-      uint128 const hash = HASH(seq_up.data(), seqlen);
+      /* hashed as in the first pass */
+      uint128 const hash = parameters.opt_strand ?
+        hash_cityhash128_canonical(seq, seqlen) :
+        hash_cityhash128_normalized(seq, seqlen);
       uint64_t j =  hash2bucket(hash, hashtablesize);
       struct sm_bucket * bp = hashtable + j;
 
@@ -581,28 +530,6 @@ auto derep_smallmem(struct Parameters const & parameters) -> void
           bp = hashtable + j;
         }
 
-      if (parameters.opt_strand and not bp->size)
-        {
-          /* no match on plus strand */
-          /* check minus strand as well */
-
-          uint128 const rc_hash = HASH(rc_seq_up.data(), seqlen);
-          uint64_t k =  hash2bucket(rc_hash, hashtablesize);
-          struct sm_bucket * rc_bp = hashtable + k;
-
-          while ((rc_bp->size) and (rc_hash != rc_bp->hash))
-            {
-              k = next_bucket(k, hashtablesize);
-              rc_bp = hashtable + k;
-            }
-
-          if (rc_bp->size)
-            {
-              bp = rc_bp;
-              j = k;
-            }
-        }
-
       int64_t const size = bp->size;
 
       if (size > 0)
@@ -252,6 +252,74 @@ auto kh_find_best_diagonal(struct kh_handle_s * kh, int k, char * seq, int len)
     }
 }
 
+auto kh_find_best_offset(struct kh_handle_s * kh,
+                         int k,
+                         char * seq,
+                         int len,
+                         int * hits) -> int
+{
+  /*
+    Find the diagonal with the largest number of k-mers shared by seq
+    and the hashed sequence, both on the same strand. The diagonal is
+    the position in seq minus the position in the hashed sequence. The
+    number of shared k-mers on that diagonal is stored in hits.
+  */
+
+  std::vector<int> diag_counts(kh->maxpos + len, 0);
+
+  int const kmers = 1U << (2U * k);
+  unsigned int const kmer_mask = kmers - 1;
+
+  unsigned int bad = kmer_mask;
+  unsigned int kmer = 0;
+  char * s = seq;
+
+  unsigned int * maskmap = chrmap_mask_ambig;
+
+  for (int pos = 0; pos < len; pos++)
+    {
+      int const c = *s++;
+
+      bad <<= 2ULL;
+      bad |= maskmap[c];
+      bad &= kmer_mask;
+
+      kmer <<= 2ULL;
+      kmer |= chrmap_2bit[c];
+      kmer &= kmer_mask;
+
+      if (! bad)
+        {
+          /* find matching buckets in hash */
+          unsigned int j = HASH((char *) &kmer, (k + 3) / 4) & kh->hash_mask;
+          while(kh->hash[j].pos)
+            {
+              if (kh->hash[j].kmer == kmer)
+                {
+                  int const hpos = kh->hash[j].pos - 1;
+                  diag_counts[kh->maxpos + (pos - k + 1) - hpos]++;
+                }
+              j = (j + 1) & kh->hash_mask;
+            }
+        }
+    }
+
+  int best_diag_count = 0;
+  int best_diag = 0;
+
+  for (int d = 0; d < kh->maxpos + len; d++)
+    {
+      if (diag_counts[d] > best_diag_count)
+        {
+          best_diag_count = diag_counts[d];
+          best_diag = d - kh->maxpos;
+        }
+    }
+
+  * hits = best_diag_count;
+  return best_diag;
+}
+
 auto kh_find_diagonals(struct kh_handle_s * kh,
                        int k,
                        char * seq,
@@ -67,6 +67,12 @@ auto kh_insert_kmers(struct kh_handle_s * kh, int k, char * seq, int len) -> voi
 
 auto kh_find_best_diagonal(struct kh_handle_s * kh, int k, char * seq, int len) -> int;
 
+auto kh_find_best_offset(struct kh_handle_s * kh,
+                         int k,
+                         char * seq,
+                         int len,
+                         int * hits) -> int;
+
 auto kh_find_diagonals(struct kh_handle_s * kh,
                        int k,
                        char * seq,
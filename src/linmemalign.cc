@@ -62,9 +62,84 @@
 #include "maps.h"
 #include <algorithm>  // std::max
 #include <cinttypes>  // macros PRIu64 and PRId64
+#include <cstdlib>  // std::abs
 #include <cstdint>  // int64_t
 #include <cstdio>  // std::FILE, std::printf, std::size_t, std::snprintf, std::sscanf
 #include <limits>
+#include <vector>
+
+
+/*
+  Vectors of four signed 32-bit scores, used by sweep_simd below.
+*/
+
+#ifdef __PPC__
+
+using VECTOR_INT = __vector signed int;
+
+#define lv_load(a) vec_ld(0, (VECTOR_INT *)(a))
+#define lv_store(a, b) vec_st((b), 0, (VECTOR_INT *)(a))
+#define lv_add(a, b) vec_add((a), (b))
+#define lv_sub(a, b) vec_sub((a), (b))
+#define lv_max(a, b) vec_max((a), (b))
+#define lv_dup(a) vec_splats((int) (a))
+#define lv_any_gt(a, b) vec_any_gt((a), (b))
+
+inline auto lv_shift(VECTOR_INT a, int32_t x) -> VECTOR_INT
+{
+  /* move each score to the next lane, insert x in the first lane */
+  alignas(16) int32_t lanes[4];
+  vec_st(a, 0, lanes);
+  alignas(16) int32_t shifted[4] = { x, lanes[0], lanes[1], lanes[2] };
+  return vec_ld(0, shifted);
+}
+
+#elif defined __aarch64__
+
+using VECTOR_INT = int32x4_t;
+
+#define lv_load(a) vld1q_s32((const int32_t *)(a))
+#define lv_store(a, b) vst1q_s32((int32_t *)(a), (b))
+#define lv_add(a, b) vaddq_s32((a), (b))
+#define lv_sub(a, b) vsubq_s32((a), (b))
+#define lv_max(a, b) vmaxq_s32((a), (b))
+#define lv_dup(a) vdupq_n_s32(a)
+#define lv_any_gt(a, b) (vmaxvq_u32(vcgtq_s32((a), (b))) != 0)
+#define lv_shift(a, x) vextq_s32(vdupq_n_s32(x), (a), 3)
+
+#elif defined(__x86_64__) || defined(SIMDE_VERSION)
+
+using VECTOR_INT = __m128i;
+
+#define lv_load(a) _mm_load_si128((VECTOR_INT *)(a))
+#define lv_store(a, b) _mm_store_si128((VECTOR_INT *)(a), (b))
+#define lv_add(a, b) _mm_add_epi32((a), (b))
+#define lv_sub(a, b) _mm_sub_epi32((a), (b))
+#define lv_dup(a) _mm_set1_epi32(a)
+#define lv_any_gt(a, b) (_mm_movemask_epi8(_mm_cmpgt_epi32((a), (b))) != 0)
+#define lv_shift(a, x) _mm_or_si128(_mm_slli_si128((a), 4),     \
+                                    _mm_cvtsi32_si128(x))
+
+inline auto lv_max(VECTOR_INT a, VECTOR_INT b) -> VECTOR_INT
+{
+  /* SSE2 has no signed 32-bit maximum */
+  VECTOR_INT const a_gt_b = _mm_cmpgt_epi32(a, b);
+  return _mm_or_si128(_mm_and_si128(a_gt_b, a), _mm_andnot_si128(a_gt_b, b));
+}
+
+#else
+
+#error Unknown Architecture
+
+#endif
+
+constexpr auto sweep_channels = 4;
+
+/* scores stay far from the limits of 32-bit integers below this bound */
+constexpr int64_t sweep_score_limit = 1LL << 29;
+
+/* sweeps with fewer cells are done with the scalar code */
+constexpr int64_t sweep_min_cells = 1024;
 
 
 /*
@@ -102,6 +177,14 @@ LinearMemoryAligner::LinearMemoryAligner()
   EE = nullptr;
   XX = nullptr;
   YY = nullptr;
+
+  band_alloc = 0;
+  band_dirs = nullptr;
+
+  max_penalty = 0;
+
+  sweep_alloc = 0;
+  sweep_vectors = nullptr;
 }
 
 
@@ -127,6 +210,14 @@ LinearMemoryAligner::~LinearMemoryAligner()
     {
       xfree(YY);
     }
+  if (band_dirs)
+    {
+      xfree(band_dirs);
+    }
+  if (sweep_vectors)
+    {
+      xfree(sweep_vectors);
+    }
 }
 
 
@@ -273,6 +364,166 @@ auto LinearMemoryAligner::show_matrix() -> void
 }
 
 
+auto LinearMemoryAligner::sweep_usable(int64_t rows, int64_t b_len) -> bool
+{
+  /* scores are bounded by the number of cells on a path times the
+     largest penalty, check that they fit in 32 bits; the propagation
+     of gaps in A between lanes assumes a non-negative open penalty,
+     which may not be the case when the gap open penalty is below
+     the extension penalty */
+  return (rows * b_len >= sweep_min_cells) and (go_q_i >= 0) and
+    ((rows + b_len + 2) * max_penalty < sweep_score_limit);
+}
+
+
+auto LinearMemoryAligner::sweep_simd(int64_t a_first,
+                                     int64_t a_step,
+                                     int64_t rows,
+                                     int64_t b_first,
+                                     int64_t b_step,
+                                     int64_t b_len,
+                                     int64_t go_top,
+                                     int64_t ge_top,
+                                     int64_t go_side,
+                                     int64_t ge_side,
+                                     int64_t go_last,
+                                     int64_t ge_last,
+                                     int64_t * out_h,
+                                     int64_t * out_e) -> void
+{
+  /*
+    Compute the last row of the score matrix of rows symbols of A
+    against b_len symbols of B, using the striped method of Farrar
+    (2007) with four 32-bit channels. It gives the same values as the
+    scalar loops in diff: symbol i of A (1-based) is at a_first +
+    (i - 1) * a_step, symbol j of B at b_first + (j - 1) * b_step.
+    The top row holds a gap in A (go_top, ge_top), the left column a
+    gap in B (go_side, ge_side) and gaps in B ending in the last
+    column use go_last and ge_last.
+
+    Column c (0-based) of B is in lane c / segments of vector
+    c % segments. H values are kept for the previous row until they
+    are overwritten, E values are updated in place, and F values
+    crossing from one lane to the next are fixed afterwards.
+  */
+
+  static constexpr int32_t minus_infinity = std::numeric_limits<int32_t>::min() / 2;
+
+  int64_t const segments = (b_len + sweep_channels - 1) / sweep_channels;
+
+  std::size_t const needed = 20 * segments;
+  if (sweep_alloc < needed)
+    {
+      sweep_alloc = needed;
+      if (sweep_vectors)
+        {
+          xfree(sweep_vectors);
+        }
+      sweep_vectors = (int32_t *) xmalloc_aligned(sweep_alloc * sizeof(VECTOR_INT),
+                                                  sizeof(VECTOR_INT));
+    }
+
+  auto * profile = (VECTOR_INT *) sweep_vectors;
+  VECTOR_INT * hh = profile + (16 * segments);
+  VECTOR_INT * ee = hh + segments;
+  VECTOR_INT * go_e = ee + segments;
+  VECTOR_INT * ge_e = go_e + segments;
+
+  /* fill the scores of each symbol of A against B, and the initial
+     values, in striped order; extra columns are never used */
+
+  auto * cells = (int32_t *) profile;
+  for (int64_t s = 0; s < segments; s++)
+    {
+      for (int64_t k = 0; k < sweep_channels; k++)
+        {
+          int64_t const c = (k * segments) + s;
+          int64_t const x = (s * sweep_channels) + k;
+          int64_t const b_pos = b_first + (c * b_step);
+          bool const real = c < b_len;
+
+          for (int64_t a = 0; a < 16; a++)
+            {
+              cells[(a * segments * sweep_channels) + x] = real ?
+                (int32_t) scorematrix[(chrmap_4bit[(int) (b_seq[b_pos])] * 16) + a] : 0;
+            }
+
+          ((int32_t *) hh)[x] = (int32_t) - (go_top + ((c + 1) * ge_top));
+          ((int32_t *) ee)[x] = minus_infinity;
+          ((int32_t *) go_e)[x] = (int32_t) ((c == b_len - 1) ? go_last : go_t_i);
+          ((int32_t *) ge_e)[x] = (int32_t) ((c == b_len - 1) ? ge_last : ge_t_i);
+        }
+    }
+
+  VECTOR_INT const v_go_f = lv_dup((int32_t) go_q_i);
+  VECTOR_INT const v_ge_f = lv_dup((int32_t) ge_q_i);
+  VECTOR_INT const v_minus_infinity = lv_dup(minus_infinity);
+
+  int32_t h_corner = 0;
+
+  for (int64_t i = 1; i <= rows; i++)
+    {
+      VECTOR_INT const * row_profile = profile +
+        (chrmap_4bit[(int) (a_seq[a_first + ((i - 1) * a_step)])] * segments);
+
+      auto const h_side = (int32_t) - (go_side + (i * ge_side));
+
+      VECTOR_INT f = lv_shift(v_minus_infinity,
+                              (int32_t) (h_side - go_q_i - ge_q_i));
+      VECTOR_INT h = lv_shift(lv_load(hh + segments - 1), h_corner);
+
+      for (int64_t s = 0; s < segments; s++)
+        {
+          VECTOR_INT const h_up = lv_load(hh + s);
+          VECTOR_INT const e = lv_sub(lv_max(lv_load(ee + s),
+                                             lv_sub(h_up, lv_load(go_e + s))),
+                                      lv_load(ge_e + s));
+          lv_store(ee + s, e);
+
+          h = lv_add(h, lv_load(row_profile + s));
+          h = lv_max(h, e);
+          h = lv_max(h, f);
+          lv_store(hh + s, h);
+
+          f = lv_sub(lv_max(f, lv_sub(h, v_go_f)), v_ge_f);
+          h = h_up;
+        }
+
+      /*
+        Propagate gaps in A into the next lanes. Once no F value is
+        above H - go_q_i, the remaining ones are already covered by
+        the F values computed from H in the loop above.
+      */
+
+      f = lv_shift(f, minus_infinity);
+      int64_t s = 0;
+      while (lv_any_gt(f, lv_sub(lv_load(hh + s), v_go_f)))
+        {
+          lv_store(hh + s, lv_max(lv_load(hh + s), f));
+          f = lv_sub(f, v_ge_f);
+          if (++s == segments)
+            {
+              s = 0;
+              f = lv_shift(f, minus_infinity);
+            }
+        }
+
+      h_corner = h_side;
+    }
+
+  /* unstripe the last row */
+
+  out_h[0] = h_corner;
+  out_e[0] = h_corner;
+  for (int64_t c = 0; c < b_len; c++)
+    {
+      int64_t const x = ((c % segments) * sweep_channels) + (c / segments);
+      out_h[c + 1] = ((int32_t *) hh)[x];
+      out_e[c + 1] = ((int32_t *) ee)[x];
+    }
+}
+
+
 auto LinearMemoryAligner::diff(int64_t a_start,
                                int64_t b_start,
                                int64_t a_len,
@@ -432,104 +683,133 @@ auto LinearMemoryAligner::diff(int64_t a_start,
       // Compute HH & EE in forward phase
       // Upper part
 
-      /* initialize HH and EE for values corresponding to
-         empty seq A vs B of j symbols,
-         i.e. a gap of length j in A                 */
-
-      HH[0] = 0;
-      EE[0] = 0;
-
-      for (int64_t j = 1; j <= b_len; j++)
+      if (sweep_usable(I, b_len))
         {
-          HH[j] = - (a_left ? go_q_l + (j * ge_q_l) : go_q_i + (j * ge_q_i));
-          EE[j] = long_min;
+          sweep_simd(a_start, 1, I,
+                     b_start, 1, b_len,
+                     a_left ? go_q_l : go_q_i,
+                     a_left ? ge_q_l : ge_q_i,
+                     gap_b_left ? 0 : (b_left ? go_t_l : go_t_i),
+                     b_left ? ge_t_l : ge_t_i,
+                     b_right ? go_t_r : go_t_i,
+                     b_right ? ge_t_r : ge_t_i,
+                     HH, EE);
         }
-
-      /* compute matrix */
-
-      for (int64_t i = 1; i <= I; i++)
+      else
         {
-          int64_t p = HH[0];
-
-          int64_t h = - (b_left ?
-                         (gap_b_left ? 0 : go_t_l) + (i * ge_t_l) :
-                         (gap_b_left ? 0 : go_t_i) + (i * ge_t_i));
+          /* initialize HH and EE for values corresponding to
+             empty seq A vs B of j symbols,
+             i.e. a gap of length j in A                 */
 
-          HH[0] = h;
-          int64_t f = long_min;
+          HH[0] = 0;
+          EE[0] = 0;
 
           for (int64_t j = 1; j <= b_len; j++)
             {
-              f = MAX(f, h - go_q_i) - ge_q_i;
-              if (b_right && (j == b_len))
-                {
-                  EE[j] = MAX(EE[j], HH[j] - go_t_r) - ge_t_r;
-                }
-              else
-                {
-                  EE[j] = MAX(EE[j], HH[j] - go_t_i) - ge_t_i;
-                }
+              HH[j] = - (a_left ? go_q_l + (j * ge_q_l) : go_q_i + (j * ge_q_i));
+              EE[j] = long_min;
+            }
+
+          /* compute matrix */
+
+          for (int64_t i = 1; i <= I; i++)
+            {
+              int64_t p = HH[0];
+
+              int64_t h = - (b_left ?
+                             (gap_b_left ? 0 : go_t_l) + (i * ge_t_l) :
+                             (gap_b_left ? 0 : go_t_i) + (i * ge_t_i));
 
-              h = p + subst_score(a_start + i - 1, b_start + j - 1);
+              HH[0] = h;
+              int64_t f = long_min;
 
-              h = std::max(f, h);
-              h = std::max(EE[j], h);
-              p = HH[j];
-              HH[j] = h;
+              for (int64_t j = 1; j <= b_len; j++)
+                {
+                  f = MAX(f, h - go_q_i) - ge_q_i;
+                  if (b_right && (j == b_len))
+                    {
+                      EE[j] = MAX(EE[j], HH[j] - go_t_r) - ge_t_r;
+                    }
+                  else
+                    {
+                      EE[j] = MAX(EE[j], HH[j] - go_t_i) - ge_t_i;
+                    }
+
+                  h = p + subst_score(a_start + i - 1, b_start + j - 1);
+
+                  h = std::max(f, h);
+                  h = std::max(EE[j], h);
+                  p = HH[j];
+                  HH[j] = h;
+                }
             }
-        }
 
-      EE[0] = HH[0];
+          EE[0] = HH[0];
+        }
 
       // Compute XX & YY in reverse phase
       // Lower part
 
-      /* initialize XX and YY */
-
-      XX[0] = 0;
-      YY[0] = 0;
-
-      for (int64_t j = 1; j <= b_len; j++)
+      if (sweep_usable(a_len - I, b_len))
         {
-          XX[j] = - (a_right ? go_q_r + (j * ge_q_r) : go_q_i + (j * ge_q_i));
-          YY[j] = long_min;
+          sweep_simd(a_start + a_len - 1, -1, a_len - I,
+                     b_start + b_len - 1, -1, b_len,
+                     a_right ? go_q_r : go_q_i,
+                     a_right ? ge_q_r : ge_q_i,
+                     gap_b_right ? 0 : (b_right ? go_t_r : go_t_i),
+                     b_right ? ge_t_r : ge_t_i,
+                     b_left ? go_t_l : go_t_i,
+                     b_left ? ge_t_l : ge_t_i,
+                     XX, YY);
         }
-
-      /* compute matrix */
-
-      for (int64_t i = 1; i <= a_len - I; i++)
+      else
         {
-          int64_t p = XX[0];
+          /* initialize XX and YY */
 
-          int64_t h = - (b_right ?
-                         (gap_b_right ? 0 : go_t_r) + (i * ge_t_r) :
-                         (gap_b_right ? 0 : go_t_i) + (i * ge_t_i));
-          XX[0] = h;
-          int64_t f = long_min;
+          XX[0] = 0;
+          YY[0] = 0;
 
           for (int64_t j = 1; j <= b_len; j++)
             {
-              f = MAX(f, h - go_q_i) - ge_q_i;
-              if (b_left && (j==b_len))
-                {
-                  YY[j] = MAX(YY[j], XX[j] - go_t_l) - ge_t_l;
-                }
-              else
-                {
-                  YY[j] = MAX(YY[j], XX[j] - go_t_i) - ge_t_i;
-                }
+              XX[j] = - (a_right ? go_q_r + (j * ge_q_r) : go_q_i + (j * ge_q_i));
+              YY[j] = long_min;
+            }
 
-              h = p + subst_score(a_start + a_len - i, b_start + b_len - j);
+          /* compute matrix */
 
-              h = std::max(f, h);
-              h = std::max(YY[j], h);
-              p = XX[j];
-              XX[j] = h;
-            }
-        }
+          for (int64_t i = 1; i <= a_len - I; i++)
+            {
+              int64_t p = XX[0];
+
+              int64_t h = - (b_right ?
+                             (gap_b_right ? 0 : go_t_r) + (i * ge_t_r) :
+                             (gap_b_right ? 0 : go_t_i) + (i * ge_t_i));
+              XX[0] = h;
+              int64_t f = long_min;
 
-      YY[0] = XX[0];
+              for (int64_t j = 1; j <= b_len; j++)
+                {
+                  f = MAX(f, h - go_q_i) - ge_q_i;
+                  if (b_left && (j==b_len))
+                    {
+                      YY[j] = MAX(YY[j], XX[j] - go_t_l) - ge_t_l;
+                    }
+                  else
+                    {
+                      YY[j] = MAX(YY[j], XX[j] - go_t_i) - ge_t_i;
+                    }
+
+                  h = p + subst_score(a_start + a_len - i, b_start + b_len - j);
+
+                  h = std::max(f, h);
+                  h = std::max(YY[j], h);
+                  p = XX[j];
+                  XX[j] = h;
+                }
+            }
 
+          YY[0] = XX[0];
+        }
 
       /* find maximum score along division line */
 
@@ -675,6 +955,13 @@ auto LinearMemoryAligner::set_parameters(int64_t * _scorematrix,
 
   q = _gap_open_query_interior;
   r = _gap_extension_query_interior;
+
+  max_penalty = std::max({go_q_l, go_t_l, go_q_i, go_t_i, go_q_r, go_t_r}) +
+    std::max({ge_q_l, ge_t_l, ge_q_i, ge_t_i, ge_q_r, ge_t_r});
+  for (int i = 0; i < 16 * 16; i++)
+    {
+      max_penalty = std::max(max_penalty, std::abs(scorematrix[i]));
+    }
 }
 
 
@@ -704,6 +991,282 @@ auto LinearMemoryAligner::align(char * _a_seq,
   return cigar_string;
 }
 
+auto LinearMemoryAligner::align_banded(char * _a_seq,
+                                       char * _b_seq,
+                                       int64_t a_len,
+                                       int64_t b_len,
+                                       int64_t diagonal,
+                                       int64_t band) -> char *
+{
+  /*
+    Compute the optimal global alignment restricted to the cells
+    (i, j) where the diagonal j - i is at most band away from the
+    given diagonal. Terminal gaps along the edges of the matrix are
+    always allowed, so the alignment may enter and leave the band
+    anywhere. Time and the memory for the traceback directions are
+    proportional to a_len times the width of the band.
+
+    The penalties follow alignstats: gaps at the very start or end of
+    the alignment are left or right terminal gaps, all others are
+    interior gaps.
+  */
+
+  static constexpr auto minus_infinity = std::numeric_limits<int64_t>::min() / 2;
+
+  /* direction bits */
+  static constexpr unsigned char from_up = 1;       /* H from F */
+  static constexpr unsigned char from_left = 2;     /* H from E */
+  static constexpr unsigned char extend_left = 4;   /* E extends E */
+  static constexpr unsigned char extend_up = 8;     /* F extends F */
+
+  if ((a_len == 0) || (b_len == 0))
+    {
+      return align(_a_seq, _b_seq, a_len, b_len);
+    }
+
+  a_seq = _a_seq;
+  b_seq = _b_seq;
+
+  cigar_reset();
+
+  /* the band must cross the matrix */
+  diagonal = std::max(diagonal, 1 - a_len);
+  diagonal = std::min(diagonal, b_len - 1);
+  int64_t const lo = std::max(diagonal - band, - a_len);
+  int64_t const hi = std::min(diagonal + band, b_len);
+  int64_t const width = hi - lo + 1;
+
+  alloc_vectors(b_len + 1);
+  auto * FF = EE;
+
+  std::size_t const needed = a_len * width;
+  if (band_alloc < needed)
+    {
+      band_alloc = needed;
+      if (band_dirs)
+        {
+          xfree(band_dirs);
+        }
+      band_dirs = (unsigned char *) xmalloc(band_alloc);
+    }
+
+  /* scores of the terminal gaps along the top row and left column */
+  auto top = [this](int64_t j) -> int64_t
+    {
+      return j == 0 ? 0 : - (go_q_l + (j * ge_q_l));
+    };
+
+  auto left = [this](int64_t i) -> int64_t
+    {
+      return i == 0 ? 0 : - (go_t_l + (i * ge_t_l));
+    };
+
+  /* best way to reach the lower right corner */
+  int64_t best_score = minus_infinity;
+  int64_t best_i = 0;
+  int64_t best_j = 0;
+  char best_state = 'H';
+
+  /* columns of the band in the previous row */
+  int64_t prev_first = 1;
+  int64_t prev_last = 0;
+
+  for (int64_t i = 1; i <= a_len; i++)
+    {
+      int64_t const first = std::max(int64_t{1}, i + lo);
+      int64_t const last = std::min(b_len, i + hi);
+
+      int64_t const go_h = (i == a_len) ? go_q_r : go_q_i;
+      int64_t const ge_h = (i == a_len) ? ge_q_r : ge_q_i;
+
+      unsigned char * dirs = band_dirs + ((i - 1) * width);
+
+      /* values to the left of the first cell */
+      int64_t h_left = (first == 1) ? left(i) : minus_infinity;
+      int64_t e = minus_infinity;
+
+      /* value diagonally up left of the first cell */
+      int64_t h_diag = minus_infinity;
+      if (i == 1)
+        {
+          h_diag = top(first - 1);
+        }
+      else if (first == 1)
+        {
+          h_diag = left(i - 1);
+        }
+      else if ((first - 1 >= prev_first) && (first - 1 <= prev_last))
+        {
+          h_diag = HH[first - 1];
+        }
+
+      for (int64_t j = first; j <= last; j++)
+        {
+          /* values above */
+          int64_t h_up = minus_infinity;
+          int64_t f_up = minus_infinity;
+          if (i == 1)
+            {
+              h_up = top(j);
+            }
+          else if ((j >= prev_first) && (j <= prev_last))
+            {
+              h_up = HH[j];
+              f_up = FF[j];
+            }
+
+          int64_t const go_v = (j == b_len) ? go_t_r : go_t_i;
+          int64_t const ge_v = (j == b_len) ? ge_t_r : ge_t_i;
+
+          unsigned char d = 0;
+
+          /* gap in b, vertical */
+          int64_t f = h_up - go_v - ge_v;
+          if (f_up - ge_v > f)
+            {
+              f = f_up - ge_v;
+              d |= extend_up;
+            }
+
+          /* gap in a, horizontal */
+          int64_t const e_open = h_left - go_h - ge_h;
+          if (e - ge_h > e_open)
+            {
+              e -= ge_h;
+              d |= extend_left;
+            }
+          else
+            {
+              e = e_open;
+            }
+
+          int64_t h = h_diag + subst_score(i - 1, j - 1);
+          if (f > h)
+            {
+              h = f;
+              d |= from_up;
+            }
+          if (e > h)
+            {
+              h = e;
+              d |= from_left;
+            }
+
+          dirs[j - i - lo] = d;
+          h_diag = h_up;
+          h_left = h;
+          HH[j] = h;
+          FF[j] = f;
+
+          /* leave the band with a terminal gap, or end in the corner */
+          if (i == a_len)
+            {
+              int64_t const rest = b_len - j;
+              int64_t score = h;
+              char state = 'H';
+              if (rest > 0)
+                {
+                  score = h - go_q_r - (rest * ge_q_r);
+                  if (e - (rest * ge_q_r) > score)
+                    {
+                      score = e - (rest * ge_q_r);
+                      state = 'E';
+                    }
+                }
+              if (score > best_score)
+                {
+                  best_score = score;
+                  best_i = i;
+                  best_j = j;
+                  best_state = state;
+                }
+            }
+          else if (j == b_len)
+            {
+              int64_t const rest = a_len - i;
+              int64_t score = h - go_t_r - (rest * ge_t_r);
+              char state = 'H';
+              if (f - (rest * ge_t_r) > score)
+                {
+                  score = f - (rest * ge_t_r);
+                  state = 'F';
+                }
+              if (score > best_score)
+                {
+                  best_score = score;
+                  best_i = i;
+                  best_j = j;
+                  best_state = state;
+                }
+            }
+        }
+
+      prev_first = first;
+      prev_last = last;
+    }
+
+  /* trace back, collecting the operations in reverse order */
+
+  std::vector<char> ops;
+  ops.reserve(a_len + b_len);
+  ops.insert(ops.end(), b_len - best_j, 'I');
+  ops.insert(ops.end(), a_len - best_i, 'D');
+
+  int64_t i = best_i;
+  int64_t j = best_j;
+  char state = best_state;
+
+  while ((i > 0) && (j > 0))
+    {
+      unsigned char const d = band_dirs[((i - 1) * width) + (j - i - lo)];
+
+      if (state == 'H')
+        {
+          if (d & from_left)
+            {
+              state = 'E';
+            }
+          else if (d & from_up)
+            {
+              state = 'F';
+            }
+          else
+            {
+              ops.push_back('M');
+              --i;
+              --j;
+              continue;
+            }
+        }
+
+      if (state == 'E')
+        {
+          ops.push_back('I');
+          state = (d & extend_left) ? 'E' : 'H';
+          --j;
+        }
+      else
+        {
+          ops.push_back('D');
+          state = (d & extend_up) ? 'F' : 'H';
+          --i;
+        }
+    }
+
+  ops.insert(ops.end(), j, 'I');
+  ops.insert(ops.end(), i, 'D');
+
+  for (auto op_it = ops.rbegin(); op_it != ops.rend(); ++op_it)
+    {
+      cigar_add(*op_it, 1);
+    }
+
+  cigar_flush();
+
+  return cigar_string;
+}
+
+
 auto LinearMemoryAligner::alignstats(char * cigar,
                                      char * _a_seq,
                                      char * _b_seq,
@@ -100,6 +100,17 @@ class LinearMemoryAligner
   int64_t * XX;
   int64_t * YY;
 
+  /* traceback directions for banded alignments */
+  std::size_t band_alloc;
+  unsigned char * band_dirs;
+
+  /* largest change of score between neighbouring cells */
+  int64_t max_penalty;
+
+  /* striped vectors for the SIMD score sweeps */
+  std::size_t sweep_alloc;
+  int32_t * sweep_vectors;
+
   auto cigar_reset() -> void;
 
   auto cigar_flush() -> void;
@@ -128,6 +139,23 @@ class LinearMemoryAligner
 
   auto alloc_vectors(std::size_t x) -> void;
 
+  auto sweep_usable(int64_t rows, int64_t b_len) -> bool;
+
+  auto sweep_simd(int64_t a_first,
+                  int64_t a_step,
+                  int64_t rows,
+                  int64_t b_first,
+                  int64_t b_step,
+                  int64_t b_len,
+                  int64_t go_top,
+                  int64_t ge_top,
+                  int64_t go_side,
+                  int64_t ge_side,
+                  int64_t go_last,
+                  int64_t ge_last,
+                  int64_t * out_h,
+                  int64_t * out_e) -> void;
+
   auto show_matrix() -> void;
 
 public:
@@ -157,6 +185,13 @@ public:
              int64_t a_len,
              int64_t b_len) -> char *;
 
+  auto align_banded(char * _a_seq,
+                    char * _b_seq,
+                    int64_t a_len,
+                    int64_t b_len,
+                    int64_t diagonal,
+                    int64_t band) -> char *;
+
   auto alignstats(char * cigar,
                   char * a_seq,
                   char * b_seq,
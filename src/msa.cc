@@ -73,6 +73,7 @@
 #include <cstring>  // std::memset, std::strlen
 #include <iterator> // std::next
 #include <numeric> // std::accumulate
+#include <utility>  // std::move
 #include <vector>
 
 
@@ -236,14 +237,14 @@ auto blank_line_before_each_msa(std::FILE * fp_msaout) -> void {
 
 auto print_header_and_sequence(std::FILE * fp_msaout, char const * header_prefix,
                                int const target_seqno,
-                               std::vector<char> & aln_v) -> void {
+                               char * row, int const row_length) -> void {
   // header_prefix == "*" or "", resulting in ">*header" or ">header"
   if (fp_msaout == nullptr) { return ; }
 
   fasta_print_general(fp_msaout,
                       header_prefix,
-                      aln_v.data(),
-                      static_cast<int>(aln_v.size() - 1),
+                      row,
+                      row_length,
                       db_getheader(target_seqno),
                       static_cast<int>(db_getheaderlen(target_seqno)),
                       db_getabundance(target_seqno),
@@ -251,6 +252,14 @@ auto print_header_and_sequence(std::FILE * fp_msaout, char const * header_prefix
 }
 
 
+auto keep_row(std::vector<char> const & aln_v,
+              std::vector<char> * rows) -> void {
+  // rows of all sequences, printed once the alignment is complete
+  if (rows == nullptr) { return ; }
+  rows->insert(rows->end(), aln_v.cbegin(), aln_v.cend());
+}
+
+
 auto reverse_complement_target_if_need_be(int const strand, int const target_seqno,
                                           char * rc_buffer, char * target_seq) -> char * {
   if (strand == 0) { return target_seq; }
@@ -260,12 +269,12 @@ auto reverse_complement_target_if_need_be(int const strand, int const target_seq
 }
 
 
-auto process_and_print_centroid(char *rc_buffer,
-                                std::vector<struct msa_target_s> const &target_list_v,
-                                std::vector<int> const &max_insertions,
-                                std::vector<prof_type> &profile,
-                                std::vector<char> &aln_v,
-                                std::FILE * fp_msaout) -> void {
+auto process_centroid(char *rc_buffer,
+                      std::vector<struct msa_target_s> const &target_list_v,
+                      std::vector<int> const &max_insertions,
+                      std::vector<prof_type> &profile,
+                      std::vector<char> &aln_v,
+                      std::vector<char> * rows) -> void {
   auto const centroid_len = static_cast<int>(max_insertions.size() - 1);
   auto const & target = target_list_v.front();
   auto const target_seqno = target.seqno;
@@ -295,8 +304,7 @@ auto process_and_print_centroid(char *rc_buffer,
   /* end of sequence string */
   aln_v[position_in_alignment] = '\0';
 
-  /* print header & sequence */
-  print_header_and_sequence(fp_msaout, "*", target_seqno, aln_v);
+  keep_row(aln_v, rows);
 }
 
 
@@ -314,22 +322,20 @@ auto insert_gaps_in_alignment_and_profile(bool const is_inserted,
 }
 
 
-auto compute_and_print_msa(int const target_count,
-                           std::vector<struct msa_target_s> const & target_list_v,
-                           std::vector<int> const &max_insertions,
-                           std::vector<prof_type> &profile,
-                           std::vector<char> &aln_v,
-                           std::FILE * fp_msaout) -> void {
-
-  blank_line_before_each_msa(fp_msaout);
+auto compute_msa(int const target_count,
+                 std::vector<struct msa_target_s> const & target_list_v,
+                 std::vector<int> const &max_insertions,
+                 std::vector<prof_type> &profile,
+                 std::vector<char> &aln_v,
+                 std::vector<char> * rows) -> void {
 
   /* Find longest target sequence on reverse strand and allocate buffer */
   std::vector<char> rc_buffer_v;
   char * rc_buffer = allocate_buffer_for_reverse_strand_target(target_count, target_list_v, rc_buffer_v);
 
   // ------------------------------------------------------- deal with centroid
-  process_and_print_centroid(rc_buffer, target_list_v, max_insertions,
-                             profile, aln_v, fp_msaout);
+  process_centroid(rc_buffer, target_list_v, max_insertions,
+                   profile, aln_v, rows);
 
   // --------------------------------- deal with other sequences in the cluster
   for (auto i = 1; i < target_count; ++i)
@@ -411,17 +417,15 @@ auto compute_and_print_msa(int const target_count,
       /* end of sequence string */
       aln_v[position_in_alignment] = '\0';
 
-      /* print header & sequence */
-      print_header_and_sequence(fp_msaout, "", target_seqno, aln_v);
+      keep_row(aln_v, rows);
     }
 }
 
 
-auto compute_and_print_consensus(std::vector<int> const &max_insertions,
-                                 std::vector<char> &aln_v,
-                                 std::vector<char> &cons_v,
-                                 std::vector<prof_type> &profile,
-                                 std::FILE * fp_msaout) -> void {
+auto compute_consensus(std::vector<int> const &max_insertions,
+                       std::vector<char> &aln_v,
+                       std::vector<char> &cons_v,
+                       std::vector<prof_type> &profile) -> void {
   static constexpr char index_of_N = 15;  // 15th char in sym_nt_4bit[] (=> 'N')
 
   auto const alignment_length = static_cast<int>(aln_v.size() - 1);
@@ -481,11 +485,6 @@ auto compute_and_print_consensus(std::vector<int> const &max_insertions,
   aln_v.back() = '\0';
   cons_v[conslen] = '\0';
   cons_v.resize(conslen + 1);
-
-  if (fp_msaout != nullptr)
-    {
-      fasta_print(fp_msaout, "consensus", aln_v.data(), alignment_length);
-    }
 }
 
 
@@ -547,45 +546,92 @@ auto print_alignment_profile(std::FILE *fp_profile, std::vector<char> &aln_v,
 }
 
 
-auto msa(std::FILE * fp_msaout, std::FILE * fp_consout, std::FILE * fp_profile,
-         int cluster,
-         int const target_count, std::vector<struct msa_target_s> const & target_list_v,
-         int64_t totalabundance) -> void
+struct msa_s
+{
+  int cluster;
+  int64_t totalabundance;
+  std::vector<struct msa_target_s> targets;
+  std::vector<char> rows;  // aligned sequences for msaout, null-terminated
+  std::vector<char> aln_v;  // consensus with gaps, then profile symbols
+  std::vector<char> cons_v;
+  std::vector<prof_type> profile;
+};
+
+
+auto msa_compute(int cluster,
+                 std::vector<struct msa_target_s> targets,
+                 int64_t totalabundance) -> struct msa_s *
 {
-  int const centroid_seqno = target_list_v[0].seqno;
+  auto * m = new struct msa_s;
+  m->cluster = cluster;
+  m->totalabundance = totalabundance;
+  m->targets = std::move(targets);
+
+  auto const target_count = static_cast<int>(m->targets.size());
+  int const centroid_seqno = m->targets.front().seqno;
   auto const centroid_length = static_cast<int>(db_getsequencelen(centroid_seqno));
 
   /* find max insertions in front of each position in the centroid sequence */
-  auto const max_insertions = find_max_insertions_per_position(target_count, target_list_v, centroid_length);
+  auto const max_insertions = find_max_insertions_per_position(target_count, m->targets, centroid_length);
   auto const alignment_length = find_total_alignment_length(max_insertions);
 
   /* allocate memory for profile (for consensus) and aligned seq */
-  std::vector<prof_type> profile(static_cast<unsigned long>(profsize) * alignment_length);  // C++20 refactoring: std::vector<std::array<prof_type, profsize>>(alnlen);
-  std::vector<char> aln_v(alignment_length + 1);
-  std::vector<char> cons_v(alignment_length + 1);
-
-  /* msaout: multiple sequence alignment ... */
-  compute_and_print_msa(target_count, target_list_v, max_insertions,
-                        profile, aln_v,
-                        fp_msaout);
-
-  /* msaout: ... and consensus sequence at the end */
-  compute_and_print_consensus(max_insertions,
-                              aln_v,
-                              cons_v,
-                              profile,
-                              fp_msaout);
+  m->profile.resize(static_cast<unsigned long>(profsize) * alignment_length);  // C++20 refactoring: std::vector<std::array<prof_type, profsize>>(alnlen);
+  m->aln_v.resize(alignment_length + 1);
+  m->cons_v.resize(alignment_length + 1);
+  if (opt_msaout != nullptr)
+    {
+      m->rows.reserve(static_cast<std::size_t>(target_count) * (alignment_length + 1));
+    }
+
+  /* multiple sequence alignment ... */
+  compute_msa(target_count, m->targets, max_insertions,
+              m->profile, m->aln_v,
+              (opt_msaout != nullptr) ? &m->rows : nullptr);
+
+  /* ... and consensus sequence */
+  compute_consensus(max_insertions,
+                    m->aln_v,
+                    m->cons_v,
+                    m->profile);
+
+  return m;
+}
+
+
+auto msa_print(struct msa_s * m,
+               std::FILE * fp_msaout, std::FILE * fp_consout, std::FILE * fp_profile) -> void
+{
+  auto const target_count = static_cast<int>(m->targets.size());
+  int const centroid_seqno = m->targets.front().seqno;
+
+  /* msaout: multiple sequence alignment and consensus sequence at the end */
+  if (fp_msaout != nullptr)
+    {
+      blank_line_before_each_msa(fp_msaout);
+      auto const row_length = static_cast<int>(m->aln_v.size() - 1);
+      for (auto i = 0; i < target_count; ++i)
+        {
+          print_header_and_sequence(fp_msaout, (i == 0) ? "*" : "",
+                                    m->targets[i].seqno,
+                                    std::next(m->rows.data(), static_cast<long>(i) * (row_length + 1)),
+                                    row_length);
+        }
+      fasta_print(fp_msaout, "consensus", m->aln_v.data(), row_length);
+    }
 
   /* consout: consensus sequence (dedicated input) */
-  print_consensus_sequence(fp_consout, cons_v,
-                           totalabundance, target_count,
-                           cluster,
+  print_consensus_sequence(fp_consout, m->cons_v,
+                           m->totalabundance, target_count,
+                           m->cluster,
                            centroid_seqno);
 
   /* profile: multiple sequence alignment profile (dedicated input) */
-  print_alignment_profile(fp_profile, aln_v,
-                          profile,
-                          totalabundance, target_count,
-                          cluster,
+  print_alignment_profile(fp_profile, m->aln_v,
+                          m->profile,
+                          m->totalabundance, target_count,
+                          m->cluster,
                           centroid_seqno);
+
+  delete m;
 }
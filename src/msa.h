@@ -70,7 +70,14 @@ struct msa_target_s
   int strand;
 };
 
-auto msa(std::FILE * fp_msaout, std::FILE * fp_consout, std::FILE * fp_profile,
-         int cluster,
-         int target_count, std::vector<struct msa_target_s> const & target_list_v,
-         int64_t totalabundance) -> void;
+/* the alignment, consensus and profile of a cluster, computed
+   before their output so that clusters can be aligned in parallel */
+struct msa_s;
+
+auto msa_compute(int cluster,
+                 std::vector<struct msa_target_s> targets,
+                 int64_t totalabundance) -> struct msa_s *;
+
+/* writes the output files given (non-null) and frees the msa */
+auto msa_print(struct msa_s * m,
+               std::FILE * fp_msaout, std::FILE * fp_consout, std::FILE * fp_profile) -> void;
@@ -60,6 +60,7 @@
 
 #include "vsearch.h"
 #include "align_simd.h"
+#include "arena.h"
 #include "dbindex.h"
 #include "maps.h"
 #include "mask.h"
@@ -68,6 +69,7 @@
 #include "udb.h"
 #include "unique.h"
 #include <algorithm>  // std::min
+#include <array>
 #include <cinttypes>  // macros PRIu64 and PRId64
 #include <cstdint> // uint64_t, int64_t
 #include <cstdio>  // std::FILE, std::fprintf, std::fclose, std::size_t
@@ -81,6 +83,7 @@ static pthread_t * pthread;
 
 /* global constants/data, no need for synchronization */
 static int tophits; /* the maximum number of hits to keep */
+static int batch_queries; /* queries searched together by a thread */
 static int seqcount; /* number of database sequences */
 static pthread_attr_t attr;
 static fastx_handle query_fastx_h;
@@ -318,52 +321,24 @@ auto search_output_results(int hit_count,
 }
 
 
-auto search_query(int64_t t) -> int
+auto search_query(struct searchinfo_s * si_p,
+                  struct searchinfo_s * si_m) -> int
 {
-  for (int s = 0; s < opt_strand; s++)
-    {
-      struct searchinfo_s * si = s ? si_minus + t : si_plus + t;
-
-      /* mask query */
-      if (opt_qmask == MASK_DUST)
-        {
-          dust(si->qsequence, si->qseqlen);
-        }
-      else if ((opt_qmask == MASK_SOFT) && (opt_hardmask))
-        {
-          hardmask(si->qsequence, si->qseqlen);
-        }
-
-      /* perform search */
-      search_onequery(si, opt_qmask);
-    }
-
   struct hit * hits = nullptr;
   int hit_count = 0;
 
-  search_joinhits(si_plus + t,
-                  opt_strand > 1 ? si_minus + t : nullptr,
+  search_joinhits(si_p,
+                  opt_strand > 1 ? si_m : nullptr,
                   & hits,
                   & hit_count);
 
   search_output_results(hit_count,
                         hits,
-                        si_plus[t].query_head,
-                        si_plus[t].qseqlen,
-                        si_plus[t].qsequence,
-                        opt_strand > 1 ? si_minus[t].qsequence : nullptr,
-                        si_plus[t].qsize);
-
-  /* free memory for alignment strings */
-  for (int i = 0; i < hit_count; i++)
-    {
-      if (hits[i].aligned)
-        {
-          xfree(hits[i].nwalignment);
-        }
-    }
-
-  xfree(hits);
+                        si_p->query_head,
+                        si_p->qseqlen,
+                        si_p->qsequence,
+                        opt_strand > 1 ? si_m->qsequence : nullptr,
+                        si_p->qsize);
 
   return hit_count;
 }
@@ -371,13 +346,22 @@ auto search_query(int64_t t) -> int
 
 auto search_thread_run(int64_t t) -> void
 {
+  /* each thread reads and searches a batch of queries at a time */
+  struct searchinfo_s * si_p_batch = si_plus + (t * batch_queries);
+  struct searchinfo_s * si_m_batch =
+    si_minus ? si_minus + (t * batch_queries) : nullptr;
+  std::array<struct searchinfo_s *, 2 * search_batch_size> si_list {};
+
   while (true)
     {
       xpthread_mutex_lock(&mutex_input);
 
-      if (fastx_next(query_fastx_h,
-                     ! opt_notrunclabels,
-                     chrmap_no_change))
+      int batch_count = 0;
+
+      while ((batch_count < batch_queries) and
+             fastx_next(query_fastx_h,
+                        ! opt_notrunclabels,
+                        chrmap_no_change))
         {
           char * qhead = fastx_get_header(query_fastx_h);
           int const query_head_len = fastx_get_header_length(query_fastx_h);
@@ -388,7 +372,8 @@ auto search_thread_run(int64_t t) -> void
 
           for (int s = 0; s < opt_strand; s++)
             {
-              struct searchinfo_s * si = s ? si_minus + t : si_plus + t;
+              struct searchinfo_s * si =
+                s ? si_m_batch + batch_count : si_p_batch + batch_count;
 
               si->query_head_len = query_head_len;
               si->qseqlen = qseqlen;
@@ -414,25 +399,63 @@ auto search_thread_run(int64_t t) -> void
             }
 
           /* plus strand: copy header and sequence */
-          strcpy(si_plus[t].query_head, qhead);
-          strcpy(si_plus[t].qsequence, qseq);
+          strcpy(si_p_batch[batch_count].query_head, qhead);
+          strcpy(si_p_batch[batch_count].qsequence, qseq);
+
+          ++batch_count;
+        }
+
+      /* get progress as amount of input file read */
+      uint64_t const progress = fastx_get_position(query_fastx_h);
 
-          /* get progress as amount of input file read */
-          uint64_t const progress = fastx_get_position(query_fastx_h);
+      /* let other threads read input */
+      xpthread_mutex_unlock(&mutex_input);
+
+      if (batch_count == 0)
+        {
+          break;
+        }
 
-          /* let other threads read input */
-          xpthread_mutex_unlock(&mutex_input);
+      int si_count = 0;
 
+      for (int q = 0; q < batch_count; q++)
+        {
           /* minus strand: copy header and reverse complementary sequence */
           if (opt_strand > 1)
             {
-              strcpy(si_minus[t].query_head, si_plus[t].query_head);
-              reverse_complement(si_minus[t].qsequence,
-                                 si_plus[t].qsequence,
-                                 si_plus[t].qseqlen);
+              strcpy(si_m_batch[q].query_head, si_p_batch[q].query_head);
+              reverse_complement(si_m_batch[q].qsequence,
+                                 si_p_batch[q].qsequence,
+                                 si_p_batch[q].qseqlen);
+            }
+
+          for (int s = 0; s < opt_strand; s++)
+            {
+              struct searchinfo_s * si = s ? si_m_batch + q : si_p_batch + q;
+
+              /* mask query */
+              if (opt_qmask == MASK_DUST)
+                {
+                  dust(si->qsequence, si->qseqlen);
+                }
+              else if ((opt_qmask == MASK_SOFT) && (opt_hardmask))
+                {
+                  hardmask(si->qsequence, si->qseqlen);
+                }
+
+              si_list[si_count] = si;
+              ++si_count;
             }
+        }
+
+      /* perform search */
+      search_batch(si_list.data(), si_count, opt_qmask);
 
-          int const match = search_query(t);
+      for (int q = 0; q < batch_count; q++)
+        {
+          int const match = search_query(si_p_batch + q,
+                                         si_m_batch ? si_m_batch + q : nullptr);
+          int const qsize = si_p_batch[q].qsize;
 
           /* lock mutex for update of global data and output */
           xpthread_mutex_lock(&mutex_output);
@@ -452,28 +475,44 @@ auto search_thread_run(int64_t t) -> void
 
           xpthread_mutex_unlock(&mutex_output);
         }
-      else
-        {
-          xpthread_mutex_unlock(&mutex_input);
-          break;
-        }
+
+      /* release the hits and all alignment strings of the batch at once */
+      arena_reset(si_p_batch->arena);
     }
 }
 
 
-auto search_thread_init(struct searchinfo_s * si) -> void
+auto search_thread_init(struct searchinfo_s * si,
+                        struct searchinfo_s const * first) -> void
 {
-  /* thread specific initialiation */
+  /*
+    Thread specific initialiation. The queries of a batch only have
+    their own k-mer counters and min heap; the aligner and the arena,
+    from which the hits are allocated (see search_batch), belong to
+    the first query of the batch and are shared by the others.
+  */
+
   si->uh = unique_init();
-  si->kmers = (count_t *) xmalloc((seqcount * sizeof(count_t)) + 32);
+  search_kmers_init_batch(si);
   si->m = minheap_init(tophits);
-  si->hits = (struct hit *) xmalloc
-    (sizeof(struct hit) * (tophits) * opt_strand);
+  si->hits = nullptr;
   si->qsize = 1;
   si->query_head_alloc = 0;
   si->query_head = nullptr;
   si->seq_alloc = 0;
   si->qsequence = nullptr;
+  si->lma = nullptr;
+  si->lma_scorematrix = nullptr;
+  si->stats_only = not search_alignments_needed();
+
+  if (first)
+    {
+      si->s = first->s;
+      si->arena = first->arena;
+      si->aligner_query = first->aligner_query;
+      return;
+    }
+
   si->s = search16_init(opt_match,
                         opt_mismatch,
                         opt_gap_open_query_left,
@@ -488,17 +527,27 @@ auto search_thread_init(struct searchinfo_s * si) -> void
                         opt_gap_extension_target_interior,
                         opt_gap_extension_query_right,
                         opt_gap_extension_target_right);
+  si->arena = arena_init();
+  search16_set_arena(si->s, si->arena);
+  search16_set_xdrop(si->s, opt_xdrop_nw);
+  si->aligner_query = (struct searchinfo_s * *) xmalloc(sizeof(struct searchinfo_s *));
+  *si->aligner_query = nullptr;
 }
 
 
-auto search_thread_exit(struct searchinfo_s * si) -> void
+auto search_thread_exit(struct searchinfo_s * si, bool const first) -> void
 {
   /* thread specific clean up */
-  search16_exit(si->s);
+  if (first)
+    {
+      search16_exit(si->s);
+      arena_exit(si->arena);
+      xfree(si->aligner_query);
+    }
+  search_lma_exit(si);
   unique_exit(si->uh);
-  xfree(si->hits);
   minheap_exit(si->m);
-  xfree(si->kmers);
+  search_kmers_exit(si);
   if (si->query_head)
     {
       xfree(si->query_head);
@@ -529,10 +578,18 @@ auto search_thread_worker_run() -> void
   /* init and create worker threads, put them into stand-by mode */
   for (int t = 0; t < opt_threads; t++)
     {
-      search_thread_init(si_plus + t);
+      struct searchinfo_s * first = si_plus + (t * batch_queries);
+      search_thread_init(first, nullptr);
+      for (int q = 1; q < batch_queries; q++)
+        {
+          search_thread_init(first + q, first);
+        }
       if (si_minus)
         {
-          search_thread_init(si_minus + t);
+          for (int q = 0; q < batch_queries; q++)
+            {
+              search_thread_init(si_minus + (t * batch_queries) + q, first);
+            }
         }
       xpthread_create(pthread + t, &attr,
                       search_thread_worker, (void *) (int64_t) t);
@@ -542,10 +599,13 @@ auto search_thread_worker_run() -> void
   for (int t = 0; t < opt_threads; t++)
     {
       xpthread_join(pthread[t], nullptr);
-      search_thread_exit(si_plus + t);
-      if (si_minus)
+      for (int q = batch_queries - 1; q >= 0; q--)
         {
-          search_thread_exit(si_minus + t);
+          if (si_minus)
+            {
+              search_thread_exit(si_minus + (t * batch_queries) + q, false);
+            }
+          search_thread_exit(si_plus + (t * batch_queries) + q, q == 0);
         }
     }
 
@@ -686,6 +746,9 @@ auto search_prep(char * cmdline, char * progheader) -> void
         }
     }
 
+  /* keep the k-mer index compressed while it is built or read */
+  dbindex_setcompressed(opt_compress_index);
+
   /* check if it may be an UDB file */
 
   bool const is_udb = udb_detect_isudb(opt_db);
@@ -730,6 +793,20 @@ auto search_prep(char * cmdline, char * progheader) -> void
   tophits = opt_maxrejects + opt_maxaccepts + MAXDELAYED;
 
   tophits = std::min(tophits, seqcount);
+
+  /* batch fewer queries when the min heaps are large, e.g. with
+     --maxrejects 0 on a large database, and a single query with
+     compressed posting lists, as each query then needs counters for
+     the whole database (see search_kmers_init_batch) */
+
+  uint64_t const heap_bytes = uint64_t(tophits) * sizeof(elem_t) * opt_strand;
+  batch_queries = 1 + static_cast<int>
+    (std::min(uint64_t(search_batch_size - 1),
+              search_batch_heap_budget / std::max(heap_bytes, uint64_t(1))));
+  if (dbindex_iscompressed())
+    {
+      batch_queries = 1;
+    }
 }
 
 
@@ -823,11 +900,11 @@ auto usearch_global(char * cmdline, char * progheader) -> void
   query_fastx_h = fastx_open(opt_usearch_global);
 
   /* allocate memory for thread info */
-  si_plus = (struct searchinfo_s *) xmalloc(opt_threads *
+  si_plus = (struct searchinfo_s *) xmalloc(opt_threads * batch_queries *
                                             sizeof(struct searchinfo_s));
   if (opt_strand > 1)
     {
-      si_minus = (struct searchinfo_s *) xmalloc(opt_threads *
+      si_minus = (struct searchinfo_s *) xmalloc(opt_threads * batch_queries *
                                                  sizeof(struct searchinfo_s));
     }
   else
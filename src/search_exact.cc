@@ -170,12 +170,10 @@ auto search_exact_onequery(struct searchinfo_s * si) -> void
 
   char * seq = si->qsequence;
   uint64_t const seqlen = si->qseqlen;
-  std::vector<char> normalized(seqlen + 1);
-  string_normalize(normalized.data(), seq, seqlen);
 
   si->hit_count = 0;
 
-  int64_t ret = dbhash_search_first(normalized.data(), seqlen, & info);
+  int64_t ret = dbhash_search_first(seq, seqlen, & info);
   while (ret >= 0)
     {
       add_hit(si, ret);
@@ -60,18 +60,23 @@
 
 #include "vsearch.h"
 #include "align_simd.h"
+#include "arena.h"
 #include "dbindex.h"
+#include "kmerhash.h"
 #include "maps.h"
 #include "minheap.h"
 #include "otutable.h"
 #include "unique.h"
+#include "userfields.h"
 #include <cinttypes>  // macros PRIu64 and PRId64
 #include <cmath>  // std::pow
 #include <cstdint> // int64_t, uint64_t
 #include <cstdio>  // std::sscanf
 #include <cstdlib>  // std::qsort
 #include <cstring>  // std::strlen, std::memset, std::strcmp
+#include <algorithm>  // std::sort
 #include <limits>
+#include <vector>
 
 
 /* per thread data */
@@ -214,22 +219,159 @@ auto search_enough_kmers(struct searchinfo_s * si,
   return (count >= opt_minwordmatches) or (count >= si->kmersamplecount);
 }
 
-auto search_topscores(struct searchinfo_s * si) -> void
+auto search_increment_counters_from_bitmap(count_t * counters,
+                                           unsigned char * bitmap,
+                                           unsigned int const totalbits) -> void
+{
+  /* use the widest kernel supported by the cpu */
+#ifdef __x86_64__
+  if (avx512bw_present)
+    {
+      increment_counters_from_bitmap_avx512bw(counters, bitmap, totalbits);
+    }
+  else if (avx2_present)
+    {
+      increment_counters_from_bitmap_avx2(counters, bitmap, totalbits);
+    }
+  else if (ssse3_present)
+    {
+      increment_counters_from_bitmap_ssse3(counters, bitmap, totalbits);
+    }
+  else
+    {
+      increment_counters_from_bitmap_sse2(counters, bitmap, totalbits);
+    }
+#else
+  increment_counters_from_bitmap(counters, bitmap, totalbits);
+#endif
+}
+
+auto search_kmers_init(struct searchinfo_s * si,
+                       unsigned int const count) -> void
+{
+  /* allocate zeroed kmer counters for count database sequences */
+  unsigned int const blocks = (count + dbindex_counter_block - 1)
+    / dbindex_counter_block;
+  unsigned int const words = (blocks + 63) / 64;
+
+  si->kmers = (count_t *) xmalloc((count * sizeof(count_t)) + 32);
+  memset(si->kmers, 0, (count * sizeof(count_t)) + 32);
+  si->kmers_blocks = (uint64_t *) xmalloc((words + 1) * sizeof(uint64_t));
+  memset(si->kmers_blocks, 0, (words + 1) * sizeof(uint64_t));
+  si->kmers_touched_alloc = (count / search_sparse_ratio) + 1;
+  si->kmers_touched = (unsigned int *) xmalloc
+    (si->kmers_touched_alloc * sizeof(unsigned int));
+  si->kmers_touched_count = 0;
+  si->kmers_sparse = true;
+}
+
+auto search_kmers_exit(struct searchinfo_s * si) -> void
+{
+  if (si->kmers)
+    {
+      xfree(si->kmers);
+      si->kmers = nullptr;
+    }
+  if (si->kmers_blocks)
+    {
+      xfree(si->kmers_blocks);
+      si->kmers_blocks = nullptr;
+    }
+  if (si->kmers_touched)
+    {
+      xfree(si->kmers_touched);
+      si->kmers_touched = nullptr;
+    }
+}
+
+auto search_count_kmers(struct searchinfo_s * si,
+                        bool const allow_sparse) -> void
 {
   /*
-    Count the kmer hits in each database sequence and
-    make a sorted list of a given number (th)
-    of the database sequences with the highest number of matching kmers.
-    These are stored in the min heap array.
+    Count the kmer hits in each database sequence.
+
+    If all the sampled kmers have posting lists and together match
+    only a small part of the database, the counters touched are
+    tracked in a bitmap with one bit per block of counters. They are
+    then collected in ascending order in kmers_touched, and only
+    those counters are zeroed before the next query. Otherwise, all
+    the counters are zeroed and must all be scanned by the caller.
   */
 
-  /* count kmer hits in the database sequences */
-  const int indexed_count = dbindex_getcount();
+  unsigned int const indexed_count = dbindex_getcount();
+
+  bool sparse = allow_sparse;
+  uint64_t matches = 0;
+
+  for(unsigned int i = 0; sparse and (i < si->kmersamplecount); i++)
+    {
+      unsigned int const kmer = si->kmersample[i];
+      if (dbindex_getbitmap(kmer))
+        {
+          sparse = false;
+        }
+      else
+        {
+          matches += dbindex_getmatchcount(kmer);
+        }
+    }
+
+  if ((matches > indexed_count / search_sparse_ratio) or
+      (matches >= si->kmers_touched_alloc))
+    {
+      sparse = false;
+    }
 
   /* zero counts */
-  memset(si->kmers, 0, indexed_count * sizeof(count_t));
+  if (si->kmers_sparse)
+    {
+      for(unsigned int j = 0; j < si->kmers_touched_count; j++)
+        {
+          si->kmers[si->kmers_touched[j]] = 0;
+        }
+    }
+  if (not (sparse and si->kmers_sparse))
+    {
+      memset(si->kmers, 0, indexed_count * sizeof(count_t));
+    }
 
-  minheap_empty(si->m);
+  si->kmers_sparse = sparse;
+  si->kmers_touched_count = 0;
+
+  if (sparse)
+    {
+      for(unsigned int i = 0; i < si->kmersamplecount; i++)
+        {
+          dbindex_increment_counters_marked(si->kmersample[i],
+                                            si->kmers,
+                                            si->kmers_blocks);
+        }
+
+      /* collect the non-zero counters and clear the block bitmap */
+      unsigned int const blocks = (indexed_count + dbindex_counter_block - 1)
+        / dbindex_counter_block;
+      for(unsigned int w = 0; w < (blocks + 63) / 64; w++)
+        {
+          uint64_t bits = si->kmers_blocks[w];
+          while (bits)
+            {
+              unsigned int const block = (64 * w) + __builtin_ctzll(bits);
+              bits &= bits - 1;
+              unsigned int const first = block * dbindex_counter_block;
+              unsigned int const last =
+                MIN(first + dbindex_counter_block, indexed_count);
+              for(unsigned int i = first; i < last; i++)
+                {
+                  if (si->kmers[i])
+                    {
+                      si->kmers_touched[si->kmers_touched_count++] = i;
+                    }
+                }
+            }
+          si->kmers_blocks[w] = 0;
+        }
+      return;
+    }
 
   for(unsigned int i = 0; i < si->kmersamplecount; i++)
     {
@@ -238,36 +380,38 @@ auto search_topscores(struct searchinfo_s * si) -> void
 
       if (bitmap)
         {
-#ifdef __x86_64__
-          if (ssse3_present)
-            {
-              increment_counters_from_bitmap_ssse3(si->kmers,
-                                                   bitmap, indexed_count);
-            }
-          else
-            {
-              increment_counters_from_bitmap_sse2(si->kmers,
-                                                  bitmap, indexed_count);
-            }
-#else
-          increment_counters_from_bitmap(si->kmers, bitmap, indexed_count);
-#endif
+          search_increment_counters_from_bitmap(si->kmers,
+                                                bitmap, indexed_count);
         }
       else
         {
-          unsigned int * list = dbindex_getmatchlist(kmer);
-          unsigned int const count = dbindex_getmatchcount(kmer);
-          for(unsigned int j = 0; j < count; j++)
-            {
-              si->kmers[list[j]]++;
-            }
+          dbindex_increment_counters(kmer, si->kmers);
         }
     }
+}
+
+auto search_topscores(struct searchinfo_s * si) -> void
+{
+  /*
+    Count the kmer hits in each database sequence and
+    make a sorted list of a given number (th)
+    of the database sequences with the highest number of matching kmers.
+    These are stored in the min heap array.
+  */
 
   const int minmatches = MIN(opt_minwordmatches, si->kmersamplecount);
 
-  for(int i = 0; i < indexed_count; i++)
+  /* targets without kmer hits are candidates when minmatches is zero */
+  search_count_kmers(si, minmatches > 0);
+
+  minheap_empty(si->m);
+
+  unsigned int const candidates =
+    si->kmers_sparse ? si->kmers_touched_count : dbindex_getcount();
+
+  for(unsigned int j = 0; j < candidates; j++)
     {
+      unsigned int const i = si->kmers_sparse ? si->kmers_touched[j] : j;
       count_t const count = si->kmers[i];
       if (count >= minmatches)
         {
@@ -286,6 +430,218 @@ auto search_topscores(struct searchinfo_s * si) -> void
   minheap_sort(si->m);
 }
 
+auto search_kmers_init_batch(struct searchinfo_s * si) -> void
+{
+  /*
+    Allocate the kmer counters needed by search_topscores_batch: one
+    per database sequence of a tile, and the list of those touched by
+    a sparse query within the tile. Without tiles (compressed index),
+    the counters of search_topscores are allocated instead.
+  */
+
+  if (dbindex_iscompressed())
+    {
+      search_kmers_init(si, dbindex_getcount());
+      return;
+    }
+
+  unsigned int const count = MIN(dbindex_getcount(), search_tile_size);
+
+  si->kmers = (count_t *) xmalloc((count * sizeof(count_t)) + 32);
+  memset(si->kmers, 0, (count * sizeof(count_t)) + 32);
+  si->kmers_blocks = nullptr;
+  si->kmers_touched_alloc = count;
+  si->kmers_touched = (unsigned int *) xmalloc
+    (si->kmers_touched_alloc * sizeof(unsigned int));
+  si->kmers_touched_count = 0;
+  si->kmers_sparse = true;
+}
+
+auto search_batch_sparse(struct searchinfo_s * si) -> bool
+{
+  /*
+    A query of a batch is counted sparsely when all its sampled kmers
+    have posting lists that together match only a small part of the
+    database, as in search_count_kmers, and targets without kmer hits
+    cannot be candidates.
+  */
+
+  if (opt_minwordmatches == 0 or si->kmersamplecount == 0)
+    {
+      return false;
+    }
+
+  uint64_t matches = 0;
+  for(unsigned int i = 0; i < si->kmersamplecount; i++)
+    {
+      unsigned int const kmer = si->kmersample[i];
+      if (dbindex_getbitmap(kmer))
+        {
+          return false;
+        }
+      matches += dbindex_getmatchcount(kmer);
+    }
+
+  return matches <= dbindex_getcount() / search_sparse_ratio;
+}
+
+auto search_topscores_batch(struct searchinfo_s * * si_list,
+                            int const count) -> void
+{
+  /*
+    Same result as search_topscores for each query in the batch, but
+    the database is processed in tiles of search_tile_size sequences.
+    All queries are counted against one tile before moving to the
+    next, so the counters of a tile stay in cache instead of the
+    whole counter array being streamed through memory for each query.
+    Queries matching few targets only visit and clear the counters
+    they touch in each tile. The min heaps are filled in the same
+    order as by search_topscores, so the results are identical.
+  */
+
+  if (dbindex_iscompressed())
+    {
+      /* the packed posting lists can only be decoded from the start */
+      for (int q = 0; q < count; q++)
+        {
+          search_topscores(si_list[q]);
+        }
+      return;
+    }
+
+  unsigned int const indexed_count = dbindex_getcount();
+
+  /* per query and sample kmer: position in the kmer match list */
+  std::vector<std::vector<unsigned int>> cursors(count);
+  std::vector<bool> sparse(count);
+
+  for (int q = 0; q < count; q++)
+    {
+      minheap_empty(si_list[q]->m);
+      cursors[q].assign(si_list[q]->kmersamplecount, 0);
+      sparse[q] = search_batch_sparse(si_list[q]);
+    }
+
+  for (unsigned int tile_start = 0;
+       tile_start < indexed_count;
+       tile_start += search_tile_size)
+    {
+      unsigned int const tile_end =
+        MIN(indexed_count, tile_start + search_tile_size);
+      unsigned int const tile_count = tile_end - tile_start;
+
+      for (int q = 0; q < count; q++)
+        {
+          struct searchinfo_s * si = si_list[q];
+          count_t * counters = si->kmers;
+          const int minmatches = MIN(opt_minwordmatches, si->kmersamplecount);
+
+          if (sparse[q])
+            {
+              /* the counters are left zeroed after a sparse tile */
+              if (not si->kmers_sparse)
+                {
+                  memset(counters, 0, tile_count * sizeof(count_t));
+                  si->kmers_sparse = true;
+                }
+
+              unsigned int touched = 0;
+              for(unsigned int i = 0; i < si->kmersamplecount; i++)
+                {
+                  unsigned int const kmer = si->kmersample[i];
+                  unsigned int const * list = dbindex_getmatchlist(kmer);
+                  unsigned int const matches = dbindex_getmatchcount(kmer);
+                  unsigned int j = cursors[q][i];
+                  while ((j < matches) and (list[j] < tile_end))
+                    {
+                      unsigned int const offset = list[j] - tile_start;
+                      if (counters[offset]++ == 0)
+                        {
+                          si->kmers_touched[touched++] = offset;
+                        }
+                      ++j;
+                    }
+                  cursors[q][i] = j;
+                }
+
+              std::sort(si->kmers_touched, si->kmers_touched + touched);
+
+              for(unsigned int t = 0; t < touched; t++)
+                {
+                  unsigned int const i = si->kmers_touched[t];
+                  count_t const kmercount = counters[i];
+                  counters[i] = 0;
+                  if (kmercount >= minmatches)
+                    {
+                      unsigned int const seqno =
+                        dbindex_getmapping(tile_start + i);
+                      unsigned int const length = db_getsequencelen(seqno);
+
+                      elem_t novel;
+                      novel.count = kmercount;
+                      novel.seqno = seqno;
+                      novel.length = length;
+
+                      minheap_add(si->m, & novel);
+                    }
+                }
+              continue;
+            }
+
+          memset(counters, 0, tile_count * sizeof(count_t));
+          si->kmers_sparse = false;
+
+          for(unsigned int i = 0; i < si->kmersamplecount; i++)
+            {
+              unsigned int const kmer = si->kmersample[i];
+              unsigned char * bitmap = dbindex_getbitmap(kmer);
+
+              if (bitmap)
+                {
+                  /* tile_start is a multiple of 16 */
+                  search_increment_counters_from_bitmap(counters,
+                                                        bitmap + (tile_start / 8),
+                                                        tile_count);
+                }
+              else
+                {
+                  unsigned int const * list = dbindex_getmatchlist(kmer);
+                  unsigned int const matches = dbindex_getmatchcount(kmer);
+                  unsigned int j = cursors[q][i];
+                  while ((j < matches) and (list[j] < tile_end))
+                    {
+                      counters[list[j] - tile_start]++;
+                      ++j;
+                    }
+                  cursors[q][i] = j;
+                }
+            }
+
+          for(unsigned int i = 0; i < tile_count; i++)
+            {
+              count_t const kmercount = counters[i];
+              if (kmercount >= minmatches)
+                {
+                  unsigned int const seqno = dbindex_getmapping(tile_start + i);
+                  unsigned int const length = db_getsequencelen(seqno);
+
+                  elem_t novel;
+                  novel.count = kmercount;
+                  novel.seqno = seqno;
+                  novel.length = length;
+
+                  minheap_add(si->m, & novel);
+                }
+            }
+        }
+    }
+
+  for (int q = 0; q < count; q++)
+    {
+      minheap_sort(si_list[q]->m);
+    }
+}
+
 auto seqncmp(char * a, char * b, uint64_t n) -> int
 {
   for(unsigned int i = 0; i < n; i++)
@@ -305,6 +661,95 @@ auto seqncmp(char * a, char * b, uint64_t n) -> int
 }
 
 
+auto align_trim_finish(struct hit * hit) -> void
+{
+  /* fill in the info excluding the terminal gaps trimmed below */
+
+  if (hit->trim_q_left >= hit->nwalignmentlength)
+    {
+      hit->trim_q_right = 0;
+    }
+
+  if (hit->trim_t_left >= hit->nwalignmentlength)
+    {
+      hit->trim_t_right = 0;
+    }
+
+  hit->internal_alignmentlength = hit->nwalignmentlength
+    - hit->trim_q_left - hit->trim_t_left
+    - hit->trim_q_right - hit->trim_t_right;
+
+  hit->internal_indels = hit->nwindels
+    - hit->trim_q_left - hit->trim_t_left
+    - hit->trim_q_right - hit->trim_t_right;
+
+  hit->internal_gaps = hit->nwgaps
+    - ((hit->trim_q_left  + hit->trim_t_left)  > 0 ? 1 : 0)
+    - ((hit->trim_q_right + hit->trim_t_right) > 0 ? 1 : 0);
+
+  /* CD-HIT */
+  hit->id0 = hit->shortest > 0 ? 100.0 * hit->matches / hit->shortest : 0.0;
+  /* all diffs */
+  hit->id1 = hit->nwalignmentlength > 0 ?
+    100.0 * hit->matches / hit->nwalignmentlength : 0.0;
+  /* internal diffs */
+  hit->id2 = hit->internal_alignmentlength > 0 ?
+    100.0 * hit->matches / hit->internal_alignmentlength : 0.0;
+  /* Marine Biology Lab */
+  hit->id3 = MAX(0.0, 100.0 * (1.0 - (1.0 * (hit->mismatches + hit->nwgaps) /
+                                      hit->longest)));
+  /* BLAST */
+  hit->id4 = hit->nwalignmentlength > 0 ?
+    100.0 * hit->matches / hit->nwalignmentlength : 0.0;
+
+  switch (opt_iddef)
+    {
+    case 0:
+      hit->id = hit->id0;
+      break;
+    case 1:
+      hit->id = hit->id1;
+      break;
+    case 2:
+      hit->id = hit->id2;
+      break;
+    case 3:
+      hit->id = hit->id3;
+      break;
+    case 4:
+      hit->id = hit->id4;
+      break;
+    }
+}
+
+auto align_trim_runs(struct hit * hit, int64_t left, int64_t right) -> void
+{
+  /*
+    Trim a hit aligned without alignment string, from the lengths of
+    its terminal gaps: positive for gaps in the target (D), negative
+    for gaps in the query (I), as returned by search16_stats.
+    The lengths in the alignment string are those of a cigar.
+  */
+
+  auto const cigar_length = [](int64_t const run) -> int {
+    int length = 1;
+    if (run > 1)
+      {
+        length += snprintf(nullptr, 0, "%" PRId64, run);
+      }
+    return length;
+  };
+
+  hit->trim_aln_left = (left != 0) ? cigar_length(std::llabs(left)) : 0;
+  hit->trim_q_left = (left > 0) ? left : 0;
+  hit->trim_t_left = (left < 0) ? - left : 0;
+  hit->trim_aln_right = (right != 0) ? cigar_length(std::llabs(right)) : 0;
+  hit->trim_q_right = (right > 0) ? right : 0;
+  hit->trim_t_right = (right < 0) ? - right : 0;
+
+  align_trim_finish(hit);
+}
+
 auto align_trim(struct hit * hit) -> void
 {
   /* trim alignment and fill in info */
@@ -371,61 +816,7 @@ auto align_trim(struct hit * hit) -> void
         }
     }
 
-  if (hit->trim_q_left >= hit->nwalignmentlength)
-    {
-      hit->trim_q_right = 0;
-    }
-
-  if (hit->trim_t_left >= hit->nwalignmentlength)
-    {
-      hit->trim_t_right = 0;
-    }
-
-  hit->internal_alignmentlength = hit->nwalignmentlength
-    - hit->trim_q_left - hit->trim_t_left
-    - hit->trim_q_right - hit->trim_t_right;
-
-  hit->internal_indels = hit->nwindels
-    - hit->trim_q_left - hit->trim_t_left
-    - hit->trim_q_right - hit->trim_t_right;
-
-  hit->internal_gaps = hit->nwgaps
-    - ((hit->trim_q_left  + hit->trim_t_left)  > 0 ? 1 : 0)
-    - ((hit->trim_q_right + hit->trim_t_right) > 0 ? 1 : 0);
-
-  /* CD-HIT */
-  hit->id0 = hit->shortest > 0 ? 100.0 * hit->matches / hit->shortest : 0.0;
-  /* all diffs */
-  hit->id1 = hit->nwalignmentlength > 0 ?
-    100.0 * hit->matches / hit->nwalignmentlength : 0.0;
-  /* internal diffs */
-  hit->id2 = hit->internal_alignmentlength > 0 ?
-    100.0 * hit->matches / hit->internal_alignmentlength : 0.0;
-  /* Marine Biology Lab */
-  hit->id3 = MAX(0.0, 100.0 * (1.0 - (1.0 * (hit->mismatches + hit->nwgaps) /
-                                      hit->longest)));
-  /* BLAST */
-  hit->id4 = hit->nwalignmentlength > 0 ?
-    100.0 * hit->matches / hit->nwalignmentlength : 0.0;
-
-  switch (opt_iddef)
-    {
-    case 0:
-      hit->id = hit->id0;
-      break;
-    case 1:
-      hit->id = hit->id1;
-      break;
-    case 2:
-      hit->id = hit->id2;
-      break;
-    case 3:
-      hit->id = hit->id3;
-      break;
-    case 4:
-      hit->id = hit->id4;
-      break;
-    }
+  align_trim_finish(hit);
 }
 
 auto search_acceptable_unaligned(struct searchinfo_s * si,
@@ -528,91 +919,523 @@ auto search_acceptable_aligned(struct searchinfo_s * si,
       /* maxdiffs */
       (hit->mismatches + hit->internal_indels <= opt_maxdiffs))
     {
-      if (opt_cluster_unoise)
-        {
-          const auto mismatches = hit->mismatches;
-          const double skew = 1.0 * si->qsize / db_getabundance(hit->target);
-          const double beta = 1.0 / pow(2, (1.0 * opt_unoise_alpha * mismatches) + 1);
+      if (opt_cluster_unoise)
+        {
+          const auto mismatches = hit->mismatches;
+          const double skew = 1.0 * si->qsize / db_getabundance(hit->target);
+          const double beta = 1.0 / pow(2, (1.0 * opt_unoise_alpha * mismatches) + 1);
+
+          if (skew <= beta or mismatches == 0)
+            {
+              /* accepted */
+              hit->accepted = true;
+              hit->weak = false;
+              return true;
+            }
+          else
+            {
+              /* rejected, but weak hit */
+              hit->rejected = true;
+              hit->weak = true;
+              return false;
+            }
+        }
+      else
+        {
+          if (hit->id >= 100.0 * opt_id)
+            {
+              /* accepted */
+              hit->accepted = true;
+              hit->weak = false;
+              return true;
+            }
+          else
+            {
+              /* rejected, but weak hit */
+              hit->rejected = true;
+              hit->weak = true;
+              return false;
+            }
+        }
+    }
+  else
+    {
+      /* rejected */
+      hit->rejected = true;
+      hit->weak = false;
+      return false;
+    }
+}
+
+auto search_reachable_id(struct searchinfo_s * si,
+                         int64_t dseqlen,
+                         unsigned int maxmatches) -> bool
+{
+  /*
+    Given an upper bound on the number of matches, determine whether
+    the identity of an alignment with the target may reach the weak
+    identity threshold (never above --id). Mirrors the computation in
+    align_trim. Only the identity definitions with a denominator bounded
+    below by the sequence lengths can be tested; with the other ones,
+    terminal gaps are excluded and any target may reach the threshold.
+  */
+
+  int64_t const shortest = MIN(si->qseqlen, dseqlen);
+  int64_t const longest = MAX(si->qseqlen, dseqlen);
+
+  switch (opt_iddef)
+    {
+    case 0:
+      return (shortest == 0) or
+        (100.0 * maxmatches / shortest >= 100.0 * opt_weak_id);
+    case 1:
+    case 4:
+      return (longest == 0) or
+        (100.0 * maxmatches / longest >= 100.0 * opt_weak_id);
+    default:
+      return true;
+    }
+}
+
+auto search_reachable_diffs(struct searchinfo_s * si,
+                            int64_t dseqlen,
+                            int64_t mindiffs) -> bool
+{
+  /*
+    Given a lower bound on the number of differences (mismatches and
+    indels, including terminal gaps), determine whether the identity
+    of an alignment with the target may reach the weak identity
+    threshold. As qlen + dlen = 2 * matches + mismatches + diffs, the
+    matches are at most (qlen + dlen - diffs) / 2. Same identity
+    definitions as in search_reachable_id.
+  */
+
+  int64_t const shortest = MIN(si->qseqlen, dseqlen);
+  int64_t const longest = MAX(si->qseqlen, dseqlen);
+  int64_t const maxmatches =
+    MAX(0, MIN(shortest, (si->qseqlen + dseqlen - mindiffs) / 2));
+
+  switch (opt_iddef)
+    {
+    case 0:
+      return (shortest == 0) or
+        (100.0 * maxmatches / shortest >= 100.0 * opt_weak_id);
+    case 1:
+    case 4:
+      return (longest == 0) or (maxmatches + mindiffs == 0) or
+        ((100.0 * maxmatches / longest >= 100.0 * opt_weak_id) and
+         (100.0 * maxmatches / (maxmatches + mindiffs) >=
+          100.0 * opt_weak_id));
+    default:
+      return true;
+    }
+}
+
+auto search_diffs_qprep(struct searchinfo_s * si) -> void
+{
+  /*
+    Prepare the query for search_diffs_within: one bit per query
+    position and per 4-bit nucleotide code, set when the position may
+    match that code. Blocks of 64 positions are stored contiguously
+    for each code. They are followed by the bottom row bit, and the
+    vertical differences of each block, and the bottom row number and
+    score of each block are kept in qdiffs, so that the targets are
+    compared without allocations.
+  */
+
+  int64_t const blocks = (si->qseqlen + 63) / 64;
+  si->qpeq = (uint64_t *) xmalloc(19 * blocks * sizeof(uint64_t));
+  memset(si->qpeq, 0, 16 * blocks * sizeof(uint64_t));
+  si->qdiffs = (int64_t *) xmalloc(2 * blocks * sizeof(int64_t));
+
+  uint64_t * bottom = si->qpeq + (16 * blocks);
+  int64_t * bottom_row = si->qdiffs;
+  for (int64_t b = 0; b < blocks; b++)
+    {
+      bottom[b] = 1ULL << 63;
+      bottom_row[b] = MIN(64 * (b + 1), si->qseqlen);
+    }
+  if (blocks > 0)
+    {
+      bottom[blocks - 1] = 1ULL << ((si->qseqlen - 1) % 64);
+    }
+
+  for (int64_t i = 0; i < si->qseqlen; i++)
+    {
+      unsigned int const q = chrmap_4bit[(int) (si->qsequence[i])];
+      uint64_t const bit = 1ULL << (i % 64);
+      for (unsigned int c = 1; c < 16; c++)
+        {
+          if (q & c)
+            {
+              si->qpeq[(c * blocks) + (i / 64)] |= bit;
+            }
+        }
+    }
+}
+
+inline auto search_diffs_block(uint64_t & pv,
+                               uint64_t & mv,
+                               uint64_t eq,
+                               uint64_t const bottom,
+                               int const hin) -> int
+{
+  /*
+    Advance one block of 64 rows by one column with the bit-vector
+    algorithm of Myers (1999), as formulated by Hyyro (2003). The
+    vertical differences are kept as positive (pv) and negative (mv)
+    bit-vectors. Takes the horizontal difference entering the top of
+    the block and returns the one at the bottom row.
+  */
+
+  uint64_t const hin_neg = (hin < 0) ? 1 : 0;
+  uint64_t const hin_pos = (hin > 0) ? 1 : 0;
+  uint64_t const xv = eq | mv;
+  eq |= hin_neg;
+  uint64_t const xh = (((eq & pv) + pv) ^ pv) | eq;
+  uint64_t ph = mv | ~(xh | pv);
+  uint64_t mh = pv & xh;
+
+  int hout = 0;
+  if (ph & bottom)
+    {
+      hout = 1;
+    }
+  else if (mh & bottom)
+    {
+      hout = -1;
+    }
+
+  ph = (ph << 1) | hin_pos;
+  mh = (mh << 1) | hin_neg;
+  pv = mh | ~(xv | ph);
+  mv = ph & xv;
+
+  return hout;
+}
+
+auto search_diffs_within(struct searchinfo_s * si,
+                         char * dseq,
+                         int64_t dseqlen,
+                         int64_t maxdiffs) -> bool
+{
+  /*
+    Determine whether the edit distance (unit cost mismatches and
+    indels, including terminal gaps) between the query and the target
+    is at most maxdiffs. The distance is a lower bound on the number
+    of differences in any global alignment of the two sequences.
+
+    Only the blocks of the query that may hold values of at most
+    maxdiffs are computed (Ukkonen's cut-off), so the cost is about
+    dseqlen * maxdiffs / 64 steps, and the target is rejected as soon
+    as no block remains.
+  */
+
+  int64_t const qlen = si->qseqlen;
+
+  if (qlen == 0 or dseqlen == 0)
+    {
+      return MAX(qlen, dseqlen) <= maxdiffs;
+    }
+
+  int64_t const blocks = (qlen + 63) / 64;
+  uint64_t const * bottom = si->qpeq + (16 * blocks);
+  uint64_t * pv = si->qpeq + (17 * blocks);
+  uint64_t * mv = si->qpeq + (18 * blocks);
+  int64_t const * bottom_row = si->qdiffs;
+  int64_t * score = si->qdiffs + blocks;
+
+  for (int64_t b = 0; b < blocks; b++)
+    {
+      pv[b] = ~0ULL;
+      mv[b] = 0;
+      score[b] = bottom_row[b];
+    }
+
+  /* the last block with cells that may be within the limit */
+  int64_t last = MIN(blocks - 1, maxdiffs / 64);
+
+  for (int64_t j = 0; j < dseqlen; j++)
+    {
+      uint64_t const * peq =
+        si->qpeq + (chrmap_4bit[(int) (dseq[j])] * blocks);
+
+      /* the top row (an empty query prefix) costs one per column */
+      int hout = 1;
+      for (int64_t b = 0; b <= last; b++)
+        {
+          hout = search_diffs_block(pv[b], mv[b], peq[b], bottom[b], hout);
+          score[b] += hout;
+        }
+
+      if ((last < blocks - 1) and
+          ((score[last] <= maxdiffs) or (score[last] - hout <= maxdiffs)))
+        {
+          /* extend the computation to the next block, assuming the
+             cells of the previous column increase by one per row */
+          int64_t const next = last + 1;
+          pv[next] = ~0ULL;
+          mv[next] = 0;
+          score[next] = score[last] - hout +
+            (bottom_row[next] - bottom_row[last]);
+          score[next] += search_diffs_block(pv[next], mv[next], peq[next],
+                                            bottom[next], hout);
+          last = next;
+        }
+      else
+        {
+          /* drop blocks where all cells exceed the limit */
+          while ((last >= 0) and (score[last] >= maxdiffs + 64))
+            {
+              --last;
+            }
+          if (last < 0)
+            {
+              return false;
+            }
+        }
+    }
+
+  return (last == blocks - 1) and (score[last] <= maxdiffs);
+}
+
+auto search_diffs_reject(struct searchinfo_s * si, int target) -> bool
+{
+  /*
+    Reject targets that cannot reach the weak identity threshold
+    given the edit distance with the query. The largest distance that
+    may still reach it is found by bisection.
+  */
+
+  int64_t const dseqlen = db_getsequencelen(target);
+
+  if (search_reachable_diffs(si, dseqlen, si->qseqlen + dseqlen))
+    {
+      return false;
+    }
+
+  if (not search_reachable_diffs(si, dseqlen, 0))
+    {
+      return true;
+    }
+
+  int64_t low = 0;
+  int64_t high = si->qseqlen + dseqlen;
+  while (high - low > 1)
+    {
+      int64_t const mid = (low + high) / 2;
+      if (search_reachable_diffs(si, dseqlen, mid))
+        {
+          low = mid;
+        }
+      else
+        {
+          high = mid;
+        }
+    }
+
+  return not search_diffs_within(si, db_getsequence(target), dseqlen, low);
+}
+
+auto search_lma(struct searchinfo_s * si) -> LinearMemoryAligner *
+{
+  /*
+    The linear memory aligner is only needed for the few alignments
+    the SIMD aligner cannot do and for banded alignments. It is
+    created on first use and kept, with its buffers and score matrix,
+    until search_lma_exit is called at the end of the thread.
+  */
+
+  if (si->lma == nullptr)
+    {
+      si->lma = new LinearMemoryAligner;
+
+      si->lma_scorematrix = si->lma->scorematrix_create(opt_match,
+                                                        opt_mismatch);
+
+      si->lma->set_parameters(si->lma_scorematrix,
+                              opt_gap_open_query_left,
+                              opt_gap_open_target_left,
+                              opt_gap_open_query_interior,
+                              opt_gap_open_target_interior,
+                              opt_gap_open_query_right,
+                              opt_gap_open_target_right,
+                              opt_gap_extension_query_left,
+                              opt_gap_extension_target_left,
+                              opt_gap_extension_query_interior,
+                              opt_gap_extension_target_interior,
+                              opt_gap_extension_query_right,
+                              opt_gap_extension_target_right);
+    }
+
+  return si->lma;
+}
+
+auto search_lma_exit(struct searchinfo_s * si) -> void
+{
+  if (si->lma)
+    {
+      delete si->lma;
+      si->lma = nullptr;
+    }
+  if (si->lma_scorematrix)
+    {
+      xfree(si->lma_scorematrix);
+      si->lma_scorematrix = nullptr;
+    }
+}
+
+auto search_alignments_needed() -> bool
+{
+  /*
+    Do the outputs show the alignment strings of the hits? If not,
+    the hits are aligned with search16_stats, without traceback, and
+    their alignment strings are left empty (nullptr).
+  */
+
+  return opt_alnout or opt_fastapairs or opt_samout or opt_uc or
+    opt_msaout or opt_consout or opt_profile or
+    (opt_userout and userfields_need_alignment());
+}
+
+/* copy a cigar string into the arena of the search, if any */
+
+auto search_cigar(struct searchinfo_s * si, char const * cigar) -> char *
+{
+  if (si->arena)
+    {
+      return arena_strdup(si->arena, cigar);
+    }
+  return xstrdup(cigar);
+}
 
-          if (skew <= beta or mismatches == 0)
-            {
-              /* accepted */
-              hit->accepted = true;
-              hit->weak = false;
-              return true;
-            }
-          else
-            {
-              /* rejected, but weak hit */
-              hit->rejected = true;
-              hit->weak = true;
-              return false;
-            }
-        }
-      else
-        {
-          if (hit->id >= 100.0 * opt_id)
-            {
-              /* accepted */
-              hit->accepted = true;
-              hit->weak = false;
-              return true;
-            }
-          else
-            {
-              /* rejected, but weak hit */
-              hit->rejected = true;
-              hit->weak = true;
-              return false;
-            }
-        }
+auto search_cigar_free(struct searchinfo_s * si, char * cigar) -> void
+{
+  /* cigars in an arena are released all at once by arena_reset */
+  if (cigar and not si->arena)
+    {
+      xfree(cigar);
     }
-  else
+}
+
+auto search_aligner_prep(struct searchinfo_s * si) -> void
+{
+  /* the queries of a batch share one aligner; prepare it for this
+     query if another one used it last */
+  if (si->aligner_query and (*si->aligner_query != si))
     {
-      /* rejected */
-      hit->rejected = true;
-      hit->weak = false;
-      return false;
+      search16_qprep(si->s, si->qsequence, si->qseqlen);
+      *si->aligner_query = si;
     }
 }
 
-auto align_delayed(struct searchinfo_s * si) -> void
+auto align_delayed_select(struct searchinfo_s * si) -> void
 {
-  /* compute global alignment */
+  /* choose the delayed targets to align, and how */
 
-  unsigned int target_list[MAXDELAYED];
-  CELL  nwscore_list[MAXDELAYED];
-  unsigned short nwalignmentlength_list[MAXDELAYED];
-  unsigned short nwmatches_list[MAXDELAYED];
-  unsigned short nwmismatches_list[MAXDELAYED];
-  unsigned short nwgaps_list[MAXDELAYED];
-  char * nwcigar_list[MAXDELAYED];
+  unsigned int * target_list = si->delayed.target_list;
+  unsigned int maxmatches_list[MAXDELAYED];
 
   int target_count = 0;
 
   for(int x = si->finalized; x < si->hit_count; x++)
     {
       struct hit * hit = si->hits + x;
+      if (si->qpeq and (not hit->rejected) and
+          search_diffs_reject(si, hit->target))
+        {
+          /* too many differences with the query */
+          hit->rejected = true;
+          hit->weak = false;
+        }
       if (not hit->rejected)
         {
           target_list[target_count++] = hit->target;
         }
     }
 
-  if (target_count)
+  if (target_count and (opt_weak_id > 0.0) and
+      ((opt_iddef == 0) or (opt_iddef == 1) or (opt_iddef == 4)))
+    {
+      /* reject targets that cannot reach the identity threshold
+         with a cheap bound before the full alignment */
+
+      search_aligner_prep(si);
+      search8(si->s, target_count, target_list, maxmatches_list);
+
+      int j = 0;
+      int kept = 0;
+      for(int x = si->finalized; x < si->hit_count; x++)
+        {
+          struct hit * hit = si->hits + x;
+          if (not hit->rejected)
+            {
+              if (search_reachable_id(si,
+                                      db_getsequencelen(hit->target),
+                                      maxmatches_list[j]))
+                {
+                  target_list[kept++] = hit->target;
+                }
+              else
+                {
+                  hit->rejected = true;
+                  hit->weak = false;
+                }
+              ++j;
+            }
+        }
+      target_count = kept;
+    }
+
+  /*
+    With --band, targets sharing enough k-mers with the query on a
+    diagonal are aligned within a band around that diagonal, the
+    other ones with the SIMD aligner.
+  */
+
+  bool * banded_list = si->delayed.banded_list;
+  int64_t * diagonal_list = si->delayed.diagonal_list;
+  int simd_count = 0;
+
+  for (int t = 0; t < target_count; t++)
     {
-      search16(si->s,
-               target_count,
-               target_list,
-               nwscore_list,
-               nwalignmentlength_list,
-               nwmatches_list,
-               nwmismatches_list,
-               nwgaps_list,
-               nwcigar_list);
+      banded_list[t] = false;
+      if (si->kh)
+        {
+          int diagonal_hits = 0;
+          diagonal_list[t] = kh_find_best_offset(si->kh,
+                                                 opt_hspw,
+                                                 db_getsequence(target_list[t]),
+                                                 db_getsequencelen(target_list[t]),
+                                                 & diagonal_hits);
+          banded_list[t] = (diagonal_hits >= opt_minhsp);
+        }
+      if (not banded_list[t])
+        {
+          target_list[simd_count++] = target_list[t];
+        }
     }
 
+  si->delayed.simd_count = simd_count;
+}
+
+auto align_delayed_finish(struct searchinfo_s * si) -> void
+{
+  /* complete the hits with the alignments of the delayed targets */
+
+  bool const * banded_list = si->delayed.banded_list;
+  int64_t const * diagonal_list = si->delayed.diagonal_list;
+  CELL const * nwscore_list = si->delayed.nwscore_list;
+  unsigned short const * nwalignmentlength_list =
+    si->delayed.nwalignmentlength_list;
+  unsigned short const * nwmatches_list = si->delayed.nwmatches_list;
+  unsigned short const * nwmismatches_list = si->delayed.nwmismatches_list;
+  unsigned short const * nwgaps_list = si->delayed.nwgaps_list;
+  char * * nwcigar_list = si->delayed.nwcigar_list;
+  int const simd_count = si->delayed.simd_count;
+
   int i = 0;
+  int k = 0;
 
   for(int x = si->finalized; x < si->hit_count; x++)
     {
@@ -628,7 +1451,7 @@ auto align_delayed(struct searchinfo_s * si) -> void
           else
             {
               int64_t const target = hit->target;
-              int64_t nwscore = nwscore_list[i];
+              int64_t nwscore = 0;
 
               char * nwcigar = nullptr;
               int64_t nwalignmentlength = 0;
@@ -636,9 +1459,51 @@ auto align_delayed(struct searchinfo_s * si) -> void
               int64_t nwmismatches = 0;
               int64_t nwgaps = 0;
 
+              /* aligned without alignment string by search16_stats */
+              bool stats = false;
+              int64_t lead = 0;
+              int64_t tail = 0;
+
               int64_t const dseqlen = db_getsequencelen(target);
 
-              if (nwscore == std::numeric_limits<short>::max())
+              if (banded_list[i])
+                {
+                  char * dseq = db_getsequence(target);
+
+                  LinearMemoryAligner * lma = search_lma(si);
+
+                  nwcigar = search_cigar(si,
+                                         lma->align_banded(si->qsequence,
+                                                           dseq,
+                                                           si->qseqlen,
+                                                           dseqlen,
+                                                           diagonal_list[i],
+                                                           opt_band));
+
+                  lma->alignstats(nwcigar,
+                                  si->qsequence,
+                                  dseq,
+                                  & nwscore,
+                                  & nwalignmentlength,
+                                  & nwmatches,
+                                  & nwmismatches,
+                                  & nwgaps);
+                }
+              else if (nwscore_list[k] == std::numeric_limits<short>::min())
+                {
+                  /* The SIMD aligner abandoned this target early
+                     (--xdrop_nw), it cannot be a good hit */
+
+                  search_cigar_free(si, nwcigar_list[k]);
+                  ++k;
+                  ++i;
+
+                  hit->rejected = true;
+                  hit->weak = false;
+                  si->rejects++;
+                  continue;
+                }
+              else if (nwscore_list[k] == std::numeric_limits<short>::max())
                 {
                   /* In case the SIMD aligner cannot align,
                      perform a new alignment with the
@@ -646,32 +1511,38 @@ auto align_delayed(struct searchinfo_s * si) -> void
 
                   char * dseq = db_getsequence(target);
 
-                  if (nwcigar_list[i])
-                    {
-                      xfree(nwcigar_list[i]);
-                    }
-
-                  nwcigar = xstrdup(si->lma->align(si->qsequence,
-                                                   dseq,
-                                                   si->qseqlen,
-                                                   dseqlen));
-
-                  si->lma->alignstats(nwcigar,
-                                      si->qsequence,
-                                      dseq,
-                                      & nwscore,
-                                      & nwalignmentlength,
-                                      & nwmatches,
-                                      & nwmismatches,
-                                      & nwgaps);
+                  search_cigar_free(si, nwcigar_list[k]);
+                  ++k;
+
+                  LinearMemoryAligner * lma = search_lma(si);
+
+                  nwcigar = search_cigar(si,
+                                         lma->align(si->qsequence,
+                                                    dseq,
+                                                    si->qseqlen,
+                                                    dseqlen));
+
+                  lma->alignstats(nwcigar,
+                                  si->qsequence,
+                                  dseq,
+                                  & nwscore,
+                                  & nwalignmentlength,
+                                  & nwmatches,
+                                  & nwmismatches,
+                                  & nwgaps);
                 }
               else
                 {
-                  nwalignmentlength = nwalignmentlength_list[i];
-                  nwmatches = nwmatches_list[i];
-                  nwmismatches = nwmismatches_list[i];
-                  nwgaps = nwgaps_list[i];
-                  nwcigar = nwcigar_list[i];
+                  nwscore = nwscore_list[k];
+                  nwalignmentlength = nwalignmentlength_list[k];
+                  nwmatches = nwmatches_list[k];
+                  nwmismatches = nwmismatches_list[k];
+                  nwgaps = nwgaps_list[k];
+                  nwcigar = nwcigar_list[k];
+                  stats = (nwcigar == nullptr);
+                  lead = si->delayed.nwlead_list[k];
+                  tail = si->delayed.nwtail_list[k];
+                  ++k;
                 }
 
               hit->aligned = true;
@@ -689,7 +1560,14 @@ auto align_delayed(struct searchinfo_s * si) -> void
               hit->mismatches = hit->nwdiff - hit->nwindels;
 
               /* trim alignment and compute numbers excluding terminal gaps */
-              align_trim(hit);
+              if (stats)
+                {
+                  align_trim_runs(hit, lead, tail);
+                }
+              else
+                {
+                  align_trim(hit);
+                }
 
               /* test accept/reject criteria after alignment */
               if (search_acceptable_aligned(si, hit))
@@ -707,54 +1585,66 @@ auto align_delayed(struct searchinfo_s * si) -> void
     }
 
   /* free ignored alignments */
-  while (i < target_count)
+  while (k < simd_count)
     {
-      xfree(nwcigar_list[i++]);
+      search_cigar_free(si, nwcigar_list[k++]);
     }
 
   si->finalized = si->hit_count;
 }
 
-auto search_onequery(struct searchinfo_s * si, int seqmask) -> void
+auto align_delayed(struct searchinfo_s * si) -> void
 {
-  si->hit_count = 0;
+  /* compute global alignment */
 
-  search16_qprep(si->s, si->qsequence, si->qseqlen);
+  align_delayed_select(si);
 
-  si->lma = new LinearMemoryAligner;
+  align_delayed_batch(& si, 1);
 
-  int64_t * scorematrix = si->lma->scorematrix_create(opt_match, opt_mismatch);
+  align_delayed_finish(si);
+}
 
-  si->lma->set_parameters(scorematrix,
-                          opt_gap_open_query_left,
-                          opt_gap_open_target_left,
-                          opt_gap_open_query_interior,
-                          opt_gap_open_target_interior,
-                          opt_gap_open_query_right,
-                          opt_gap_open_target_right,
-                          opt_gap_extension_query_left,
-                          opt_gap_extension_target_left,
-                          opt_gap_extension_query_interior,
-                          opt_gap_extension_target_interior,
-                          opt_gap_extension_query_right,
-                          opt_gap_extension_target_right);
+auto search_candidates_begin(struct searchinfo_s * si) -> void
+{
+  /* prepare the analysis of the targets with the most kmer hits */
 
-  /* extract unique kmer samples from query*/
-  unique_count(si->uh, opt_wordlength,
-               si->qseqlen, si->qsequence,
-               &si->kmersamplecount, &si->kmersample, seqmask);
+  si->hit_count = 0;
 
-  /* find database sequences with the most kmer hits */
-  search_topscores(si);
+  search16_qprep(si->s, si->qsequence, si->qseqlen);
+  if (si->aligner_query)
+    {
+      *si->aligner_query = si;
+    }
+
+  si->kh = nullptr;
+  if (opt_band > 0)
+    {
+      si->kh = kh_init();
+      kh_insert_kmers(si->kh, opt_hspw, si->qsequence, si->qseqlen);
+    }
+
+  si->qpeq = nullptr;
+  si->qdiffs = nullptr;
+  if ((opt_weak_id > 0.0) and
+      ((opt_iddef == 0) or (opt_iddef == 1) or (opt_iddef == 4)))
+    {
+      search_diffs_qprep(si);
+    }
 
-  /* analyse targets with the highest number of kmer hits */
   si->accepts = 0;
   si->rejects = 0;
   si->finalized = 0;
+}
+
+auto search_candidates_delay(struct searchinfo_s * si) -> bool
+{
+  /* add candidates to the hits until enough alignments are delayed,
+     returns false when the analysis of the query is complete */
 
   int delayed = 0;
 
-  while ((si->finalized + delayed < opt_maxaccepts + opt_maxrejects - 1) &&
+  while ((delayed < (int) MAXDELAYED) &&
+         (si->finalized + delayed < opt_maxaccepts + opt_maxrejects - 1) &&
          (si->rejects < opt_maxrejects) &&
          (si->accepts < opt_maxaccepts) &&
          (not minheap_isempty(si->m)))
@@ -783,20 +1673,344 @@ auto search_onequery(struct searchinfo_s * si, int seqmask) -> void
         }
 
       si->hit_count++;
+    }
+
+  return delayed > 0;
+}
+
+auto search_candidates_end(struct searchinfo_s * si) -> void
+{
+  if (si->kh)
+    {
+      kh_exit(si->kh);
+      si->kh = nullptr;
+    }
+
+  if (si->qpeq)
+    {
+      xfree(si->qpeq);
+      si->qpeq = nullptr;
+      xfree(si->qdiffs);
+      si->qdiffs = nullptr;
+    }
+}
+
+auto search_candidates(struct searchinfo_s * si) -> void
+{
+  /* analyse targets with the highest number of kmer hits */
+
+  search_candidates_begin(si);
+
+  while (search_candidates_delay(si))
+    {
+      align_delayed(si);
+    }
+
+  search_candidates_end(si);
+}
+
+auto search_onequery(struct searchinfo_s * si, int seqmask) -> void
+{
+  /* extract unique kmer samples from query*/
+  unique_count(si->uh, opt_wordlength,
+               si->qseqlen, si->qsequence,
+               &si->kmersamplecount, &si->kmersample, seqmask);
+
+  /* find database sequences with the most kmer hits */
+  search_topscores(si);
+
+  search_candidates(si);
+}
+
+auto align_delayed_pairs(struct s16info_s * s,
+                         bool const stats,
+                         std::vector<char *> & qseqs,
+                         std::vector<int> & qlens,
+                         std::vector<unsigned int> & seqnos,
+                         std::vector<struct delayed_s *> const & owner,
+                         std::vector<int> const & slot) -> void
+{
+  /* align pairs with search16_stats or search16_pairs, and store the
+     results in the delayed lists of their queries */
+
+  unsigned int const pairs = seqnos.size();
+
+  if (pairs == 0)
+    {
+      return;
+    }
+
+  std::vector<CELL> nwscore_list(pairs);
+  std::vector<unsigned short> nwalignmentlength_list(pairs);
+  std::vector<unsigned short> nwmatches_list(pairs);
+  std::vector<unsigned short> nwmismatches_list(pairs);
+  std::vector<unsigned short> nwgaps_list(pairs);
+  std::vector<char *> nwcigar_list(pairs, nullptr);
+  std::vector<short> nwlead_list(pairs, 0);
+  std::vector<short> nwtail_list(pairs, 0);
+
+  if (stats)
+    {
+      search16_stats(s,
+                     pairs,
+                     qseqs.data(),
+                     qlens.data(),
+                     seqnos.data(),
+                     nwscore_list.data(),
+                     nwalignmentlength_list.data(),
+                     nwmatches_list.data(),
+                     nwmismatches_list.data(),
+                     nwgaps_list.data(),
+                     nwlead_list.data(),
+                     nwtail_list.data());
+    }
+  else
+    {
+      search16_pairs(s,
+                     pairs,
+                     qseqs.data(),
+                     qlens.data(),
+                     seqnos.data(),
+                     nwscore_list.data(),
+                     nwalignmentlength_list.data(),
+                     nwmatches_list.data(),
+                     nwmismatches_list.data(),
+                     nwgaps_list.data(),
+                     nwcigar_list.data());
+    }
+
+  for (unsigned int p = 0; p < pairs; p++)
+    {
+      struct delayed_s * d = owner[p];
+      int const k = slot[p];
+      d->nwscore_list[k] = nwscore_list[p];
+      d->nwalignmentlength_list[k] = nwalignmentlength_list[p];
+      d->nwmatches_list[k] = nwmatches_list[p];
+      d->nwmismatches_list[k] = nwmismatches_list[p];
+      d->nwgaps_list[k] = nwgaps_list[p];
+      d->nwcigar_list[k] = nwcigar_list[p];
+      d->nwlead_list[k] = nwlead_list[p];
+      d->nwtail_list[k] = nwtail_list[p];
+    }
+}
+
+auto align_delayed_batch(struct searchinfo_s * * si_list,
+                         int const count) -> void
+{
+  /*
+    Align the delayed targets of several queries. A query with only a
+    few targets leaves most of the channels of search16 empty, so the
+    pairs of all the queries are aligned together by search16_pairs,
+    with a different query in each channel. The few pairs that could
+    overflow are aligned by search16 with their own query. The x-drop
+    test of --xdrop_nw is only done by search16, so the queries are
+    aligned separately when it is used.
+
+    When no alignment strings are needed, the large pairs are aligned
+    by search16_stats instead. It finds the same alignments without
+    the direction bits and the traceback, so its memory does not grow
+    with the product of the lengths. It does several times more work
+    per cell, so the smaller pairs keep the direction bits.
+  */
 
-      if (delayed == MAXDELAYED)
+  bool const stats = si_list[0]->stats_only and (opt_xdrop_nw == 0);
+
+  int queries = 0;
+  bool large = false;
+  for (int q = 0; q < count; q++)
+    {
+      struct searchinfo_s * si = si_list[q];
+      struct delayed_s * d = & si->delayed;
+      if (d->simd_count)
         {
-          align_delayed(si);
-          delayed = 0;
+          ++queries;
+        }
+      for (int k = 0; stats and (k < d->simd_count); k++)
+        {
+          if (int64_t(si->qseqlen) * db_getsequencelen(d->target_list[k])
+              >= search_stats_min_cells)
+            {
+              large = true;
+            }
         }
     }
-  if (delayed > 0)
+
+  if (queries == 0)
     {
-      align_delayed(si);
+      return;
+    }
+
+  if ((not large) and ((queries == 1) or (opt_xdrop_nw > 0)))
+    {
+      for (int q = 0; q < count; q++)
+        {
+          struct delayed_s * d = & si_list[q]->delayed;
+          if (d->simd_count)
+            {
+              search_aligner_prep(si_list[q]);
+              search16(si_list[q]->s,
+                       d->simd_count,
+                       d->target_list,
+                       d->nwscore_list,
+                       d->nwalignmentlength_list,
+                       d->nwmatches_list,
+                       d->nwmismatches_list,
+                       d->nwgaps_list,
+                       d->nwcigar_list);
+            }
+        }
+      return;
+    }
+
+  /* pairs aligned with direction bits (0) and without traceback (1) */
+  std::vector<char *> qseqs[2];
+  std::vector<int> qlens[2];
+  std::vector<unsigned int> seqnos[2];
+  std::vector<struct delayed_s *> owner[2];
+  std::vector<int> slot[2];
+  struct s16info_s * s = nullptr;
+
+  for (int q = 0; q < count; q++)
+    {
+      struct searchinfo_s * si = si_list[q];
+      struct delayed_s * d = & si->delayed;
+
+      unsigned int rest_list[MAXDELAYED];
+      int rest_slot[MAXDELAYED];
+      int rest_count = 0;
+
+      for (int k = 0; k < d->simd_count; k++)
+        {
+          unsigned int const target = d->target_list[k];
+          uint64_t const dlen = db_getsequencelen(target);
+          if (search16_pairable(si->s, si->qseqlen, dlen))
+            {
+              int const set = (stats and
+                               (int64_t(si->qseqlen) * int64_t(dlen)
+                                >= search_stats_min_cells)) ? 1 : 0;
+              qseqs[set].push_back(si->qsequence);
+              qlens[set].push_back(si->qseqlen);
+              seqnos[set].push_back(target);
+              owner[set].push_back(d);
+              slot[set].push_back(k);
+              if (not s)
+                {
+                  s = si->s;
+                }
+            }
+          else
+            {
+              rest_list[rest_count] = target;
+              rest_slot[rest_count] = k;
+              ++rest_count;
+            }
+        }
+
+      if (rest_count)
+        {
+          CELL nwscore_list[MAXDELAYED];
+          unsigned short nwalignmentlength_list[MAXDELAYED];
+          unsigned short nwmatches_list[MAXDELAYED];
+          unsigned short nwmismatches_list[MAXDELAYED];
+          unsigned short nwgaps_list[MAXDELAYED];
+          char * nwcigar_list[MAXDELAYED];
+
+          search_aligner_prep(si);
+          search16(si->s,
+                   rest_count,
+                   rest_list,
+                   nwscore_list,
+                   nwalignmentlength_list,
+                   nwmatches_list,
+                   nwmismatches_list,
+                   nwgaps_list,
+                   nwcigar_list);
+
+          for (int r = 0; r < rest_count; r++)
+            {
+              int const k = rest_slot[r];
+              d->nwscore_list[k] = nwscore_list[r];
+              d->nwalignmentlength_list[k] = nwalignmentlength_list[r];
+              d->nwmatches_list[k] = nwmatches_list[r];
+              d->nwmismatches_list[k] = nwmismatches_list[r];
+              d->nwgaps_list[k] = nwgaps_list[r];
+              d->nwcigar_list[k] = nwcigar_list[r];
+            }
+        }
+    }
+
+  for (int set = 0; set < 2; set++)
+    {
+      align_delayed_pairs(s, set == 1,
+                          qseqs[set], qlens[set], seqnos[set],
+                          owner[set], slot[set]);
+    }
+
+  /* the pairs may have overwritten the query prepared in the aligner */
+  if (si_list[0]->aligner_query)
+    {
+      *si_list[0]->aligner_query = nullptr;
+    }
+}
+
+auto search_batch(struct searchinfo_s * * si_list,
+                  int const count,
+                  int const seqmask) -> void
+{
+  for (int q = 0; q < count; q++)
+    {
+      struct searchinfo_s * si = si_list[q];
+      unique_count(si->uh, opt_wordlength,
+                   si->qseqlen, si->qsequence,
+                   &si->kmersamplecount, &si->kmersample, seqmask);
+    }
+
+  search_topscores_batch(si_list, count);
+
+  /* each query gets at most one hit per candidate; the hits are
+     allocated from the arena, released after the batch is output */
+
+  for (int q = 0; q < count; q++)
+    {
+      struct searchinfo_s * si = si_list[q];
+      si->hits = (struct hit *)
+        arena_alloc(si->arena, (si->m->count + 1) * sizeof(struct hit));
+    }
+
+  /* analyse the candidates of all queries in steps, and align the
+     targets delayed in each step together */
+
+  std::vector<struct searchinfo_s *> active(si_list, si_list + count);
+
+  for (auto * si : active)
+    {
+      search_candidates_begin(si);
     }
 
-  delete si->lma;
-  xfree(scorematrix);
+  while (not active.empty())
+    {
+      int pending = 0;
+      for (auto * si : active)
+        {
+          if (search_candidates_delay(si))
+            {
+              align_delayed_select(si);
+              active[pending++] = si;
+            }
+          else
+            {
+              search_candidates_end(si);
+            }
+        }
+      active.resize(pending);
+
+      align_delayed_batch(active.data(), pending);
+
+      for (auto * si : active)
+        {
+          align_delayed_finish(si);
+        }
+    }
 }
 
 auto search_findbest2_byid(struct searchinfo_s * si_p,
@@ -887,7 +2101,15 @@ auto search_joinhits(struct searchinfo_s * si_p,
     }
 
   /* allocate new array of hits */
-  auto * hits = (struct hit *) xmalloc(a * sizeof(struct hit));
+  struct hit * hits = nullptr;
+  if (si_p->arena)
+    {
+      hits = (struct hit *) arena_alloc(si_p->arena, a * sizeof(struct hit));
+    }
+  else
+    {
+      hits = (struct hit *) xmalloc(a * sizeof(struct hit));
+    }
 
   /* copy over the hits to be kept */
   a = 0;
@@ -903,7 +2125,7 @@ auto search_joinhits(struct searchinfo_s * si_p,
             }
           else if (h->aligned)
             {
-              xfree(h->nwalignment);
+              search_cigar_free(si, h->nwalignment);
             }
         }
     }
@@ -59,6 +59,7 @@
 */
 
 #include <array>
+#include <cstdint>  // int64_t
 #include <vector>
 
 struct uhandle_s;
@@ -66,6 +67,21 @@ struct uhandle_s;
 /* the number of alignments that can be delayed */
 constexpr auto MAXDELAYED = 8U;
 
+/* use sparse counting if the kmers match at most 1/8 of the database */
+constexpr auto search_sparse_ratio = 8U;
+
+/* the number of queries counted together by search_batch */
+constexpr auto search_batch_size = 8;
+
+/* bytes of min heaps a thread may use for the other queries of a batch */
+constexpr auto search_batch_heap_budget = 1U << 20U;
+
+/* database sequences per tile in search_topscores_batch, multiple of 16 */
+constexpr auto search_tile_size = 8192U;
+
+/* pairs with more cells are aligned without traceback when possible */
+constexpr auto search_stats_min_cells = INT64_C(1) << 20;
+
 /* Default minimum number of word matches for word lengths 3-15 */
 constexpr std::array<int, 16> minwordmatches_defaults =
   {{ -1, -1, -1, 18, 17, 16, 15, 14, 12, 11, 10,  9,  8,  7,  5,  3 }};
@@ -123,6 +139,23 @@ struct hit
 /* type of kmer hit counter element remember possibility of overflow */
 using count_t = unsigned short;
 
+/* targets of a query waiting for alignment, and the alignments */
+struct delayed_s
+{
+  unsigned int target_list[MAXDELAYED];   /* targets for the SIMD aligner */
+  int simd_count;                         /* number of targets above */
+  bool banded_list[MAXDELAYED];           /* aligned in a band instead */
+  int64_t diagonal_list[MAXDELAYED];      /* diagonal of the band */
+  short nwscore_list[MAXDELAYED];
+  unsigned short nwalignmentlength_list[MAXDELAYED];
+  unsigned short nwmatches_list[MAXDELAYED];
+  unsigned short nwmismatches_list[MAXDELAYED];
+  unsigned short nwgaps_list[MAXDELAYED];
+  char * nwcigar_list[MAXDELAYED];        /* null if aligned without cigar */
+  short nwlead_list[MAXDELAYED];          /* terminal gaps, without cigar */
+  short nwtail_list[MAXDELAYED];
+};
+
 struct searchinfo_s
 {
   int query_no = 0;                 /* query number, zero-based */
@@ -137,23 +170,60 @@ struct searchinfo_s
   unsigned int kmersamplecount = 0; /* number of kmer samples from query */
   unsigned int * kmersample = nullptr;    /* list of kmers sampled from query */
   count_t * kmers = nullptr;              /* list of kmer counts for each db seq */
+  uint64_t * kmers_blocks = nullptr;      /* bit per block of touched counters */
+  unsigned int * kmers_touched = nullptr; /* db seqs with non-zero counts */
+  unsigned int kmers_touched_alloc = 0; /* size of the list above */
+  unsigned int kmers_touched_count = 0; /* number of db seqs in the list above */
+  bool kmers_sparse = false;        /* only the touched counters are non-zero */
   std::vector<struct hit> hits_v; /* vector of hits */
   struct hit * hits = nullptr;            /* list of hits */
   int hit_count = 0;                /* number of hits in the above list */
   struct uhandle_s * uh = nullptr;        /* unique kmer finder instance */
   struct s16info_s * s = nullptr;         /* SIMD aligner instance */
+  struct searchinfo_s * * aligner_query = nullptr; /* query last prepared in
+                                                      an aligner shared by a batch */
   struct nwinfo_s * nw = nullptr;         /* NW aligner instance */
   LinearMemoryAligner * lma = nullptr;    /* Linear memory aligner instance pointer */
+  int64_t * lma_scorematrix = nullptr;    /* score matrix of the aligner above */
+  struct kh_handle_s * kh = nullptr;      /* query k-mers for banded alignment */
+  uint64_t * qpeq = nullptr;        /* query bit-vectors for edit distances */
+  int64_t * qdiffs = nullptr;       /* block rows and scores for the above */
+  struct arena_s * arena = nullptr; /* optional memory for cigars and hits */
+  bool stats_only = false;          /* hits need no alignment strings */
   int accepts = 0;                  /* number of accepts */
   int rejects = 0;                  /* number of rejects */
   struct minheap_s * m = nullptr;   /* min heap with the top kmer db seqs */
   int finalized = 0;
+  struct delayed_s delayed;         /* alignments of the delayed targets */
 };
 
+auto search_kmers_init(struct searchinfo_s * si, unsigned int count) -> void;
+
+auto search_kmers_exit(struct searchinfo_s * si) -> void;
+
+auto search_count_kmers(struct searchinfo_s * si, bool allow_sparse) -> void;
+
 auto search_topscores(struct searchinfo_s * si) -> void;
 
 auto search_onequery(struct searchinfo_s * si, int seqmask) -> void;
 
+auto search_lma_exit(struct searchinfo_s * si) -> void;
+auto search_alignments_needed() -> bool;
+auto search_cigar(struct searchinfo_s * si, char const * cigar) -> char *;
+auto search_cigar_free(struct searchinfo_s * si, char * cigar) -> void;
+
+auto search_kmers_init_batch(struct searchinfo_s * si) -> void;
+
+auto search_topscores_batch(struct searchinfo_s * * si_list,
+                            int count) -> void;
+
+auto align_delayed_batch(struct searchinfo_s * * si_list,
+                         int count) -> void;
+
+auto search_batch(struct searchinfo_s * * si_list,
+                  int count,
+                  int seqmask) -> void;
+
 auto search_findbest2_byid(struct searchinfo_s * si_p,
                            struct searchinfo_s * si_m) -> struct hit *;
 
@@ -168,6 +238,8 @@ auto search_acceptable_aligned(struct searchinfo_s * si,
 
 auto align_trim(struct hit * hit) -> void;
 
+auto align_trim_runs(struct hit * hit, int64_t left, int64_t right) -> void;
+
 auto search_joinhits(struct searchinfo_s * si_p,
                      struct searchinfo_s * si_m,
                      struct hit * * hits,
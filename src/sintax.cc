@@ -275,44 +275,12 @@ auto sintax_search_topscores(struct searchinfo_s * si) -> void
     ties will instead be chosen randomly.
   */
 
-  /* count kmer hits in the database sequences */
-  const int indexed_count = dbindex_getcount();
-
-  /* zero counts */
-  memset(si->kmers, 0, indexed_count * sizeof(count_t));
-
-  for (unsigned int i = 0; i < si->kmersamplecount; i++)
-    {
-      unsigned int const kmer = si->kmersample[i];
-      unsigned char * bitmap = dbindex_getbitmap(kmer);
-
-      if (bitmap)
-        {
-#ifdef __x86_64__
-          if (ssse3_present)
-            {
-              increment_counters_from_bitmap_ssse3(si->kmers,
-                                                   bitmap, indexed_count);
-            }
-          else
-            {
-              increment_counters_from_bitmap_sse2(si->kmers,
-                                                  bitmap, indexed_count);
-            }
-#else
-          increment_counters_from_bitmap(si->kmers, bitmap, indexed_count);
-#endif
-        }
-      else
-        {
-          unsigned int * list = dbindex_getmatchlist(kmer);
-          unsigned int const count = dbindex_getmatchcount(kmer);
-          for (unsigned int j = 0; j < count; j++)
-            {
-              si->kmers[list[j]]++;
-            }
-        }
-    }
+  /*
+    Sequences without kmer hits never become the best one, but with
+    sintax_random every tie at zero consumes a random number, so all
+    the counters must then be scanned.
+  */
+  search_count_kmers(si, not opt_sintax_random);
 
   unsigned int tophits = 0;
 
@@ -321,8 +289,12 @@ auto sintax_search_topscores(struct searchinfo_s * si) -> void
   best.seqno = 0;
   best.length = 0;
 
-  for (int i = 0; i < indexed_count; i++)
+  unsigned int const candidates =
+    si->kmers_sparse ? si->kmers_touched_count : dbindex_getcount();
+
+  for (unsigned int j = 0; j < candidates; j++)
     {
+      unsigned int const i = si->kmers_sparse ? si->kmers_touched[j] : j;
       count_t const count = si->kmers[i];
       unsigned int const seqno = dbindex_getmapping(i);
       unsigned int const length = db_getsequencelen(best.seqno);
@@ -549,7 +521,7 @@ auto sintax_thread_init(struct searchinfo_s * si) -> void
 {
   /* thread specific initialiation */
   si->uh = unique_init();
-  si->kmers = (count_t *) xmalloc((seqcount * sizeof(count_t)) + 32);
+  search_kmers_init(si, seqcount);
   si->m = minheap_init(tophits);
   si->hits = nullptr;
   si->qsize = 1;
@@ -566,7 +538,7 @@ auto sintax_thread_exit(struct searchinfo_s * si) -> void
   /* thread specific clean up */
   unique_exit(si->uh);
   minheap_exit(si->m);
-  xfree(si->kmers);
+  search_kmers_exit(si);
   if (si->query_head)
     {
       xfree(si->query_head);
@@ -643,6 +615,9 @@ auto sintax() -> void
       fatal("No output file specified with --tabbedout");
     }
 
+  /* keep the k-mer index compressed while it is built or read */
+  dbindex_setcompressed(opt_compress_index);
+
   /* check if db may be an UDB file */
 
   bool const is_udb = udb_detect_isudb(opt_db);
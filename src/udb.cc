@@ -78,6 +78,66 @@ constexpr auto blocksize = 4096U * 4096U;
 
 static unsigned int udb_dbaccel = 0;
 
+/*
+  UDB version 2 is a vsearch-specific layout designed to be mapped
+  into memory and used as is. All sections start on a page boundary
+  and are stored exactly as they are laid out in memory, so no
+  parsing, copying or bitmap creation is needed when it is read.
+  The file is only portable between builds with the same byte order
+  and the same size of seqinfo_t.
+
+  page 0                fixed header (udb_v2_header_s)
+  kmercount_p           4^wordlength uint32 word match counts
+  kmerhash_p            4^wordlength + 1 uint64 offsets into kmerindex
+  kmerindex_p           uint32 sequence numbers for all words
+  bitmapkmers_p         uint32 words that have a bitmap
+  bitmaps_p             one padded bitmap per word listed above
+  seqindex_p            seqinfo_t for each sequence
+  data_p                zero-terminated headers and sequences
+*/
+
+constexpr uint32_t udb_v1_signature = 0x55444246; /* FBDU UDBF */
+constexpr uint32_t udb_v2_signature = 0x5544424d; /* MBDU UDBM */
+constexpr uint32_t udb_v2_signature_end = 0x5544426d; /* mBDU UDBm */
+constexpr uint64_t udb_v2_alignment = 4096;
+constexpr uint64_t udb_v2_bitmap_alignment = 64;
+
+struct udb_v2_header_s
+{
+  uint32_t signature;
+  uint32_t version;
+  uint32_t wordlength;
+  uint32_t seqcount;
+  uint32_t bitmapcount;
+  uint32_t seqinfo_size;
+  uint64_t nucleotides;
+  uint64_t longest;
+  uint64_t shortest;
+  uint64_t longestheader;
+  uint64_t kmerindexsize;
+  uint64_t bitmapbytes;
+  uint64_t kmercount_p;
+  uint64_t kmerhash_p;
+  uint64_t kmerindex_p;
+  uint64_t bitmapkmers_p;
+  uint64_t bitmaps_p;
+  uint64_t seqindex_p;
+  uint64_t data_p;
+  uint64_t datalen;
+  uint64_t filesize;
+  uint32_t dbaccel;
+  uint32_t signature_end;
+};
+
+static_assert(sizeof(struct udb_v2_header_s) <= udb_v2_alignment,
+              "UDB v2 header must fit in the first page");
+
+inline auto udb_v2_align(uint64_t const offset,
+                         uint64_t const alignment) -> uint64_t
+{
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
 struct wordfreq
 {
   unsigned int kmer;
@@ -174,7 +234,6 @@ auto udb_detect_isudb(const char * filename) -> bool
     It must be an uncompressed regular file, not a pipe.
   */
 
-  constexpr static uint32_t udb_file_signature {0x55444246};
   constexpr static uint64_t expected_n_bytes {sizeof(uint32_t)};
 
   xstat_t fs;
@@ -201,7 +260,8 @@ auto udb_detect_isudb(const char * filename) -> bool
   uint64_t const bytesread = read(fd, & magic, expected_n_bytes);
   close(fd);
 
-  if ((bytesread == expected_n_bytes) && (magic == udb_file_signature))
+  if ((bytesread == expected_n_bytes) &&
+      ((magic == udb_v1_signature) || (magic == udb_v2_signature)))
     {
       return true;
     }
@@ -209,6 +269,121 @@ auto udb_detect_isudb(const char * filename) -> bool
   return false;
 }
 
+auto udb_v2_check_header(struct udb_v2_header_s const & header,
+                         uint64_t const filesize) -> bool
+{
+  /* check signatures, parameters and that all sections are aligned,
+     in order and within the file */
+
+  if ((header.signature != udb_v2_signature) ||
+      (header.signature_end != udb_v2_signature_end) ||
+      (header.version != 2) ||
+      (header.wordlength < 3) ||
+      (header.wordlength > 15) ||
+      (header.seqcount == 0) ||
+      (header.seqinfo_size != sizeof(seqinfo_t)) ||
+      (header.filesize != filesize))
+    {
+      return false;
+    }
+
+  uint64_t const hashsize = 1ULL << (2 * header.wordlength);
+  uint64_t const bitmapsize = (header.seqcount + 127 + 7) / 8; // pad for xmm
+
+  /* reject sizes whose section lengths below would overflow */
+
+  if ((header.kmerindexsize > filesize / 4) ||
+      ((header.bitmapcount > 0) &&
+       ((header.bitmapbytes < bitmapsize) ||
+        (header.bitmapbytes > filesize / header.bitmapcount))))
+    {
+      return false;
+    }
+
+  uint64_t const sections[][2] =
+    {
+      { header.kmercount_p, 4 * hashsize },
+      { header.kmerhash_p, 8 * (hashsize + 1) },
+      { header.kmerindex_p, 4 * header.kmerindexsize },
+      { header.bitmapkmers_p, 4ULL * header.bitmapcount },
+      { header.bitmaps_p, header.bitmapbytes * header.bitmapcount },
+      { header.seqindex_p, sizeof(seqinfo_t) * header.seqcount },
+      { header.data_p, header.datalen }
+    };
+
+  uint64_t end = udb_v2_alignment;
+  for (auto const & section : sections)
+    {
+      if ((section[0] % udb_v2_alignment != 0) ||
+          (section[0] < end) ||
+          (section[0] > filesize) ||
+          (section[1] > filesize - section[0]))
+        {
+          return false;
+        }
+      end = section[0] + section[1];
+    }
+
+  return (end == filesize);
+}
+
+auto udb_v2_check_index(struct udb_v2_header_s const & header,
+                        char const * base) -> bool
+{
+  /* check once that the word match lists, the bitmap words and the
+     sequence index stay within their sections; the lists themselves
+     are only paged in when used */
+
+  uint64_t const hashsize = 1ULL << (2 * header.wordlength);
+  auto const * counts = (unsigned int const *) (base + header.kmercount_p);
+  auto const * offsets = (uint64_t const *) (base + header.kmerhash_p);
+
+  if (offsets[0] != 0)
+    {
+      return false;
+    }
+
+  for (uint64_t i = 0; i < hashsize; i++)
+    {
+      if ((offsets[i + 1] < offsets[i]) ||
+          (offsets[i + 1] > header.kmerindexsize) ||
+          (offsets[i + 1] - offsets[i] != counts[i]))
+        {
+          return false;
+        }
+    }
+
+  if (offsets[hashsize] != header.kmerindexsize)
+    {
+      return false;
+    }
+
+  auto const * bitmapkmers = (unsigned int const *) (base + header.bitmapkmers_p);
+  for (uint64_t i = 0; i < header.bitmapcount; i++)
+    {
+      if (bitmapkmers[i] >= hashsize)
+        {
+          return false;
+        }
+    }
+
+  auto const * index = (seqinfo_t const *) (base + header.seqindex_p);
+  for (uint64_t i = 0; i < header.seqcount; i++)
+    {
+      seqinfo_t const & info = index[i];
+      if ((info.header_p >= header.datalen) ||
+          (info.headerlen >= header.datalen - info.header_p) ||
+          (info.seq_p >= header.datalen) ||
+          (info.seqlen >= header.datalen - info.seq_p))
+        {
+          return false;
+        }
+    }
+
+  /* no string can run past the end of the data */
+  return (base[header.data_p + header.datalen - 1] == 0);
+}
+
 auto udb_info() -> void
 {
   /* Read UDB header and show basic info */
@@ -229,48 +404,284 @@ auto udb_info() -> void
       fatal("Unable to read from UDB file or invalid UDB file");
     }
 
-  if ((buffer[0]  != 0x55444246) ||
-      (buffer[2] != 32) ||
-      (buffer[4] < 3) ||
-      (buffer[4] > 15) ||
-      (buffer[13] == 0) ||
-      (buffer[17] != 0x0000746e) ||
-      (buffer[49] != 0x55444266))
+  unsigned int seqs = 0;
+  unsigned int bits = 32;
+  unsigned int wordwidth = 0;
+  unsigned int slots = 0;
+  unsigned int dbstep = 1;
+  unsigned int dbaccel = 0;
+
+  if (buffer[0] == udb_v2_signature)
     {
-      fatal("Invalid UDB file");
+      xstat_t fs;
+      if (xfstat(fd_udbinfo, & fs))
+        {
+          fatal("Unable to get status for UDB file");
+        }
+
+      struct udb_v2_header_s header;
+      memcpy(& header, buffer, sizeof(header));
+      if (! udb_v2_check_header(header, fs.st_size))
+        {
+          fatal("Invalid UDB file");
+        }
+
+      seqs = header.seqcount;
+      wordwidth = header.wordlength;
+      dbaccel = header.dbaccel;
+    }
+  else
+    {
+      if ((buffer[0]  != udb_v1_signature) ||
+          (buffer[2] != 32) ||
+          (buffer[4] < 3) ||
+          (buffer[4] > 15) ||
+          (buffer[13] == 0) ||
+          (buffer[17] != 0x0000746e) ||
+          (buffer[49] != 0x55444266))
+        {
+          fatal("Invalid UDB file");
+        }
+
+      seqs = buffer[13];
+      bits = buffer[2];
+      wordwidth = buffer[4];
+      slots = buffer[11];
+      dbstep = buffer[5];
+      dbaccel = buffer[6];
     }
 
   if (! opt_quiet)
     {
-      fprintf(stderr, "           Seqs  %u\n", buffer[13]);
-      fprintf(stderr, "     SeqIx bits  %u\n", buffer[2]);
+      fprintf(stderr, "           Seqs  %u\n", seqs);
+      fprintf(stderr, "     SeqIx bits  %u\n", bits);
       fprintf(stderr, "          Alpha  nt (4)\n");
-      fprintf(stderr, "     Word width  %u\n", buffer[4]);
-      fprintf(stderr, "          Slots  %u\n", buffer[11]);
+      fprintf(stderr, "     Word width  %u\n", wordwidth);
+      fprintf(stderr, "          Slots  %u\n", slots);
       fprintf(stderr, "      Dict size  %u (%.1fk)\n",
-              (1U << (2 * buffer[4])),
-              (1U << (2 * buffer[4])) * 1.0 / 1000.0);
-      fprintf(stderr, "         DBstep  %u\n", buffer[5]);
-      fprintf(stderr, "        DBAccel  %u%%\n", buffer[6]);
+              (1U << (2 * wordwidth)),
+              (1U << (2 * wordwidth)) * 1.0 / 1000.0);
+      fprintf(stderr, "         DBstep  %u\n", dbstep);
+      fprintf(stderr, "        DBAccel  %u%%\n", dbaccel);
     }
 
   if (opt_log)
     {
-      fprintf(fp_log, "           Seqs  %u\n", buffer[13]);
-      fprintf(fp_log, "     SeqIx bits  %u\n", buffer[2]);
+      fprintf(fp_log, "           Seqs  %u\n", seqs);
+      fprintf(fp_log, "     SeqIx bits  %u\n", bits);
       fprintf(fp_log, "          Alpha  nt (4)\n");
-      fprintf(fp_log, "     Word width  %u\n", buffer[4]);
-      fprintf(fp_log, "          Slots  %u\n", buffer[11]);
+      fprintf(fp_log, "     Word width  %u\n", wordwidth);
+      fprintf(fp_log, "          Slots  %u\n", slots);
       fprintf(fp_log, "      Dict size  %u (%.1fk)\n",
-              (1U << (2 * buffer[4])),
-              (1U << (2 * buffer[4])) * 1.0 / 1000.0);
-      fprintf(fp_log, "         DBstep  %u\n", buffer[5]);
-      fprintf(fp_log, "        DBAccel  %u%%\n", buffer[6]);
+              (1U << (2 * wordwidth)),
+              (1U << (2 * wordwidth)) * 1.0 / 1000.0);
+      fprintf(fp_log, "         DBstep  %u\n", dbstep);
+      fprintf(fp_log, "        DBAccel  %u%%\n", dbaccel);
     }
 
   close(fd_udbinfo);
 }
 
+auto udb_show_stats() -> void
+{
+  if (! opt_quiet)
+    {
+      if (db_getsequencecount() > 0)
+        {
+          fprintf(stderr,
+                  "%" PRIu64 " nt in %" PRIu64 " seqs, min %" PRIu64 ", max %" PRIu64 ", avg %.0f\n",
+                  db_getnucleotidecount(),
+                  db_getsequencecount(),
+                  db_getshortestsequence(),
+                  db_getlongestsequence(),
+                  db_getnucleotidecount() * 1.0 / db_getsequencecount());
+        }
+      else
+        {
+          fprintf(stderr,
+                  "%" PRIu64 " nt in %" PRIu64 " seqs\n",
+                  db_getnucleotidecount(),
+                  db_getsequencecount());
+        }
+    }
+
+  if (opt_log)
+    {
+      if (db_getsequencecount() > 0)
+        {
+          fprintf(fp_log,
+                  "%" PRIu64 " nt in %" PRIu64 " seqs, min %" PRIu64 ", max %" PRIu64 ", avg %.0f\n\n",
+                  db_getnucleotidecount(),
+                  db_getsequencecount(),
+                  db_getshortestsequence(),
+                  db_getlongestsequence(),
+                  db_getnucleotidecount() * 1.0 / db_getsequencecount());
+        }
+      else
+        {
+          fprintf(fp_log,
+                  "%" PRIu64 " nt in %" PRIu64 " seqs\n\n",
+                  db_getnucleotidecount(),
+                  db_getsequencecount());
+        }
+    }
+}
+
+auto udb_read_v2(int const fd_udb,
+                 uint64_t const filesize,
+                 bool const create_bitmaps,
+                 bool const parse_abundances) -> void
+{
+  /* map an UDB version 2 file and use its sections in place */
+
+  if (filesize < udb_v2_alignment)
+    {
+      fatal("Invalid UDB file");
+    }
+
+  auto * base = (char *) xmmap_read(fd_udb, filesize);
+  if (base == nullptr)
+    {
+      fatal("Unable to map UDB file into memory");
+    }
+
+  struct udb_v2_header_s header;
+  memcpy(& header, base, sizeof(header));
+
+  if (! udb_v2_check_header(header, filesize))
+    {
+      fatal("Invalid UDB file");
+    }
+
+  unsigned int const seqcount = header.seqcount;
+  udb_dbaccel = header.dbaccel;
+
+  if (header.wordlength != opt_wordlength)
+    {
+      fprintf(stderr, "\nWARNING: Wordlength adjusted to %u as indicated in UDB file\n", header.wordlength);
+      opt_wordlength = header.wordlength;
+    }
+
+  kmerhashsize = 1U << (2 * header.wordlength);
+  kmerindexsize = header.kmerindexsize;
+  kmercount = (unsigned int *) (base + header.kmercount_p);
+  kmerhash = (uint64_t *) (base + header.kmerhash_p);
+  kmerindex = (unsigned int *) (base + header.kmerindex_p);
+
+  if (! udb_v2_check_index(header, base))
+    {
+      fatal("Invalid UDB file");
+    }
+
+  /* point bitmaps into the mapping, no need to rebuild them */
+
+  kmerbitmap = (struct bitmap_s * *) xmalloc(kmerhashsize * sizeof(struct bitmap_s **));
+  memset(kmerbitmap, 0, kmerhashsize * sizeof(struct bitmap_s **));
+
+  if (create_bitmaps)
+    {
+      auto * bitmapkmers = (unsigned int *) (base + header.bitmapkmers_p);
+      for (unsigned int i = 0; i < header.bitmapcount; i++)
+        {
+          unsigned int const kmer = bitmapkmers[i];
+          auto * a_bitmap = (struct bitmap_s *) xmalloc(sizeof(struct bitmap_s));
+          a_bitmap->size = seqcount + 127; // pad for xmm
+          a_bitmap->bitmap = (unsigned char *)
+            (base + header.bitmaps_p + (i * header.bitmapbytes));
+          kmerbitmap[kmer] = a_bitmap;
+        }
+    }
+
+  seqindex = (seqinfo_t *) (base + header.seqindex_p);
+  datap = base + header.data_p;
+
+  /* abundances were parsed when the file was made; the mapping is
+     read-only, so they are ignored rather than overwritten */
+
+  dbindex_setmapped(base, filesize);
+  db_setmapped(true);
+  db_setabundances(parse_abundances);
+
+  progress_update(filesize);
+  progress_done();
+
+  if (dbindex_compressing())
+    {
+      dbindex_pack_mapped();
+    }
+
+  /* set database info */
+
+  dbindex_uh = unique_init();
+
+  db_setinfo(false,
+             seqcount,
+             header.nucleotides,
+             header.longest,
+             header.shortest,
+             header.longestheader);
+
+  /* make mapping from indexno to seqno */
+
+  dbindex_map = (unsigned int *) xmalloc(seqcount * sizeof(unsigned int));
+  dbindex_count = seqcount;
+
+  for (unsigned int i = 0; i < seqcount; i++)
+    {
+      dbindex_map[i] = i;
+    }
+}
+
+auto udb_read_packed(int const fd_udb,
+                     uint64_t pos,
+                     unsigned int const seqcount,
+                     bool const create_bitmaps) -> uint64_t
+{
+  /*
+    Read the word match lists of a version 1 file a slice of the
+    words at a time, create the bitmaps of the most frequent words
+    from them, and keep the other lists packed only (see
+    dbindex_setcompressed). Returns the new file position.
+  */
+
+  unsigned int const bitmap_mincount = seqcount / 8;
+  std::vector<unsigned int> lists;
+
+  dbindex_pack_begin();
+
+  unsigned int first = 0;
+  while (first < kmerhashsize)
+    {
+      unsigned int const last = dbindex_pack_slice(first);
+      uint64_t const matches =
+        kmerhash[last - 1] + kmercount[last - 1] - kmerhash[first];
+      lists.resize(matches);
+      pos += largeread(fd_udb, lists.data(), 4 * matches, pos);
+
+      for (unsigned int i = first; create_bitmaps and (i < last); i++)
+        {
+          if (kmercount[i] >= bitmap_mincount)
+            {
+              unsigned int const * list = lists.data() + (kmerhash[i] - kmerhash[first]);
+              kmerbitmap[i] = bitmap_init(seqcount+127); // pad for xmm
+              bitmap_reset_all(kmerbitmap[i]);
+              for (unsigned j = 0; j < kmercount[i]; j++)
+                {
+                  bitmap_set(kmerbitmap[i], list[j]);
+                }
+            }
+        }
+
+      dbindex_pack_lists(first, last, lists.data());
+      progress_update(pos);
+      first = last;
+    }
+
+  dbindex_pack_end();
+
+  return pos;
+}
+
 auto udb_read(const char * filename,
               bool create_bitmaps,
               bool parse_abundances) -> void
@@ -322,7 +733,16 @@ auto udb_read(const char * filename,
 
   pos += largeread(fd_udb, buffer, 4 * 50, pos);
 
-  if ((buffer[0]  != 0x55444246) ||
+  if (buffer[0] == udb_v2_signature)
+    {
+      udb_read_v2(fd_udb, filesize, create_bitmaps, parse_abundances);
+      close(fd_udb);
+      xfree(prompt);
+      udb_show_stats();
+      return;
+    }
+
+  if ((buffer[0]  != udb_v1_signature) ||
       (buffer[2] != 32) ||
       (buffer[4] < 3) ||
       (buffer[4] > 15) ||
@@ -372,9 +792,16 @@ auto udb_read(const char * filename,
 
   /* sequence numbers for word matches */
 
-  kmerindex = (unsigned int *) xmalloc(kmerindexsize * 4);
+  if (dbindex_compressing())
+    {
+      pos = udb_read_packed(fd_udb, pos, seqcount, create_bitmaps);
+    }
+  else
+    {
+      kmerindex = (unsigned int *) xmalloc(kmerindexsize * 4);
 
-  pos += largeread(fd_udb, kmerindex, 4 * kmerindexsize, pos);
+      pos += largeread(fd_udb, kmerindex, 4 * kmerindexsize, pos);
+    }
 
   /* new header */
 
@@ -489,6 +916,11 @@ auto udb_read(const char * filename,
   progress_done();
   xfree(prompt);
 
+  if (dbindex_iscompressed())
+    {
+      dbindex_show_packed();
+    }
+
   /* move sequences and insert zero at end of each sequence */
 
   progress_init("Reorganizing data in memory", seqcount);
@@ -507,7 +939,7 @@ auto udb_read(const char * filename,
 
   /* Create bitmaps for the most frequent words */
 
-  if (create_bitmaps)
+  if (create_bitmaps and not dbindex_iscompressed())
     {
       progress_init("Creating bitmaps", kmerhashsize);
       unsigned int const bitmap_mincount = seqcount / 8;
@@ -574,47 +1006,7 @@ auto udb_read(const char * filename,
 
   /* some stats */
 
-  if (! opt_quiet)
-    {
-      if (seqcount > 0)
-        {
-          fprintf(stderr,
-                  "%" PRIu64 " nt in %" PRIu64 " seqs, min %" PRIu64 ", max %" PRIu64 ", avg %.0f\n",
-                  db_getnucleotidecount(),
-                  db_getsequencecount(),
-                  db_getshortestsequence(),
-                  db_getlongestsequence(),
-                  db_getnucleotidecount() * 1.0 / db_getsequencecount());
-        }
-      else
-        {
-          fprintf(stderr,
-                  "%" PRIu64 " nt in %" PRIu64 " seqs\n",
-                  db_getnucleotidecount(),
-                  db_getsequencecount());
-        }
-    }
-
-  if (opt_log)
-    {
-      if (seqcount > 0)
-        {
-          fprintf(fp_log,
-                  "%" PRIu64 " nt in %" PRIu64 " seqs, min %" PRIu64 ", max %" PRIu64 ", avg %.0f\n\n",
-                  db_getnucleotidecount(),
-                  db_getsequencecount(),
-                  db_getshortestsequence(),
-                  db_getlongestsequence(),
-                  db_getnucleotidecount() * 1.0 / db_getsequencecount());
-        }
-      else
-        {
-          fprintf(fp_log,
-                  "%" PRIu64 " nt in %" PRIu64 " seqs\n\n",
-                  db_getnucleotidecount(),
-                  db_getsequencecount());
-        }
-    }
+  udb_show_stats();
 }
 
 auto udb_fasta() -> void
@@ -882,34 +1274,46 @@ auto udb_stats() -> void
   db_free();
 }
 
-auto udb_make() -> void
+auto udb_write_kmerindex(int const fd_output,
+                         uint64_t pos,
+                         std::vector<unsigned int> & buffer) -> uint64_t
 {
-  if (! opt_output) {
-    fatal("UDB output file must be specified with --output");
-  }
-
-  int fd_output = 0;
-
-  fd_output = xopen_write(opt_output);
-  if (! fd_output)
-    {
-      fatal("Unable to open output file for writing");
-    }
+  /* lists of sequence no's with matches for all words */
 
-  db_read(opt_makeudb_usearch, 1);
+  unsigned int const seqcount = db_getsequencecount();
+  uint64_t const kmerhashsize = 1U << (2 * static_cast<uint64_t>(opt_wordlength));
 
-  if (opt_dbmask == MASK_DUST)
-    {
-      dust_all();
-    }
-  else if ((opt_dbmask == MASK_SOFT) && (opt_hardmask))
+  for (unsigned int i = 0; i < kmerhashsize; i++)
     {
-      hardmask_all();
+      if (kmerbitmap[i])
+        {
+          memset(buffer.data(), 0, 4 * kmercount[i]);
+          unsigned int elements = 0;
+          for (unsigned int j = 0; j < seqcount; j++)
+            {
+              if (bitmap_get(kmerbitmap[i], j))
+                {
+                  buffer[elements++] = j;
+                }
+            }
+          pos += largewrite(fd_output, buffer.data(), 4 * elements, pos);
+        }
+      else
+        {
+          if (kmercount[i] > 0)
+            {
+              pos += largewrite(fd_output,
+                                kmerindex + kmerhash[i],
+                                4 * kmercount[i],
+                                pos);
+            }
+        }
     }
+  return pos;
+}
 
-  dbindex_prepare(1, opt_dbmask);
-  dbindex_addallsequences(opt_dbmask);
-
+auto udb_write_v1(int const fd_output) -> void
+{
   unsigned int const seqcount = db_getsequencecount();
   uint64_t const ntcount = db_getnucleotidecount();
 
@@ -946,7 +1350,7 @@ auto udb_make() -> void
   std::vector<unsigned int> buffer(buffersize);
 
   /* Header */
-  buffer[0]  = 0x55444246; /* FBDU UDBF */
+  buffer[0]  = udb_v1_signature; /* FBDU UDBF */
   buffer[2]  = 32; /* bits */
   buffer[4]  = opt_wordlength; /* default 8 */
   buffer[5]  = 1; /* dbstep */
@@ -965,32 +1369,7 @@ auto udb_make() -> void
   pos += largewrite(fd_output, buffer.data(), 1 * 4, pos);
 
   /* lists of sequence no's with matches for all words */
-  for (unsigned int i = 0; i < kmerhashsize; i++)
-    {
-      if (kmerbitmap[i])
-        {
-          memset(buffer.data(), 0, 4 * kmercount[i]);
-          unsigned int elements = 0;
-          for (unsigned int j = 0; j < seqcount; j++)
-            {
-              if (bitmap_get(kmerbitmap[i], j))
-                {
-                  buffer[elements++] = j;
-                }
-            }
-          pos += largewrite(fd_output, buffer.data(), 4 * elements, pos);
-        }
-      else
-        {
-          if (kmercount[i] > 0)
-            {
-              pos += largewrite(fd_output,
-                                kmerindex + kmerhash[i],
-                                4 * kmercount[i],
-                                pos);
-            }
-        }
-    }
+  pos = udb_write_kmerindex(fd_output, pos, buffer);
 
   /* New header */
   buffer[0] = 0x55444234; /* 4BDU UDB4 */
@@ -1037,6 +1416,167 @@ auto udb_make() -> void
       unsigned int const len = db_getsequencelen(i);
       pos += largewrite(fd_output, db_getsequence(i), len, pos);
     }
+}
+
+auto udb_write_v2(int const fd_output) -> void
+{
+  unsigned int const seqcount = db_getsequencecount();
+  uint64_t const kmerhashsize = 1U << (2 * static_cast<uint64_t>(opt_wordlength));
+
+  /* offsets of the full word match lists, words with a bitmap */
+
+  std::vector<uint64_t> offsets(kmerhashsize + 1);
+  std::vector<unsigned int> bitmapkmers;
+  uint64_t wordmatches = 0;
+  for (unsigned int i = 0; i < kmerhashsize; i++)
+    {
+      offsets[i] = wordmatches;
+      wordmatches += kmercount[i];
+      if (kmerbitmap[i])
+        {
+          bitmapkmers.push_back(i);
+        }
+    }
+  offsets[kmerhashsize] = wordmatches;
+
+  uint64_t datalen = 0;
+  for (unsigned int i = 0; i < seqcount; i++)
+    {
+      datalen += db_getheaderlen(i) + 1 + db_getsequencelen(i) + 1;
+    }
+
+  uint64_t const bitmapsize = (seqcount + 127 + 7) / 8; // pad for xmm
+
+  struct udb_v2_header_s header;
+  memset(& header, 0, sizeof(header));
+  header.signature = udb_v2_signature;
+  header.version = 2;
+  header.wordlength = opt_wordlength;
+  header.seqcount = seqcount;
+  header.bitmapcount = bitmapkmers.size();
+  header.seqinfo_size = sizeof(seqinfo_t);
+  header.nucleotides = db_getnucleotidecount();
+  header.longest = db_getlongestsequence();
+  header.shortest = db_getshortestsequence();
+  header.longestheader = db_getlongestheader();
+  header.kmerindexsize = wordmatches;
+  header.bitmapbytes = udb_v2_align(bitmapsize, udb_v2_bitmap_alignment);
+  header.kmercount_p = udb_v2_alignment;
+  header.kmerhash_p = udb_v2_align(header.kmercount_p + (4 * kmerhashsize),
+                                   udb_v2_alignment);
+  header.kmerindex_p = udb_v2_align(header.kmerhash_p + (8 * (kmerhashsize + 1)),
+                                    udb_v2_alignment);
+  header.bitmapkmers_p = udb_v2_align(header.kmerindex_p + (4 * wordmatches),
+                                      udb_v2_alignment);
+  header.bitmaps_p = udb_v2_align(header.bitmapkmers_p + (4 * bitmapkmers.size()),
+                                  udb_v2_alignment);
+  header.seqindex_p = udb_v2_align(header.bitmaps_p + (header.bitmapbytes * bitmapkmers.size()),
+                                   udb_v2_alignment);
+  header.data_p = udb_v2_align(header.seqindex_p + (sizeof(seqinfo_t) * seqcount),
+                               udb_v2_alignment);
+  header.datalen = datalen;
+  header.filesize = header.data_p + datalen;
+  header.dbaccel = 100;
+  header.signature_end = udb_v2_signature_end;
+
+  progress_init("Writing UDB file", header.filesize);
+
+  largewrite(fd_output, & header, sizeof(header), 0);
+
+  largewrite(fd_output, kmercount, 4 * kmerhashsize, header.kmercount_p);
+
+  largewrite(fd_output, offsets.data(), 8 * (kmerhashsize + 1), header.kmerhash_p);
+
+  std::vector<unsigned int> buffer(MAX(1, seqcount));
+  udb_write_kmerindex(fd_output, header.kmerindex_p, buffer);
+
+  if (! bitmapkmers.empty())
+    {
+      largewrite(fd_output, bitmapkmers.data(), 4 * bitmapkmers.size(), header.bitmapkmers_p);
+    }
+
+  for (std::size_t i = 0; i < bitmapkmers.size(); i++)
+    {
+      largewrite(fd_output,
+                 kmerbitmap[bitmapkmers[i]]->bitmap,
+                 bitmapsize,
+                 header.bitmaps_p + (i * header.bitmapbytes));
+    }
+
+  /* sequence index relative to the start of the data section,
+     with abundances already parsed from the headers */
+
+  std::vector<seqinfo_t> index(seqcount);
+  uint64_t data_pos = 0;
+  for (unsigned int i = 0; i < seqcount; i++)
+    {
+      int64_t const size = header_get_size(db_getheader(i), db_getheaderlen(i));
+      index[i].headerlen = db_getheaderlen(i);
+      index[i].seqlen = db_getsequencelen(i);
+      index[i].header_p = data_pos;
+      index[i].seq_p = data_pos + index[i].headerlen + 1;
+      index[i].qual_p = 0;
+      index[i].size = (size > 0) ? size : 1;
+      data_pos = index[i].seq_p + index[i].seqlen + 1;
+    }
+  largewrite(fd_output, index.data(), sizeof(seqinfo_t) * seqcount, header.seqindex_p);
+
+  /* zero-terminated headers and sequences, written in large blocks */
+
+  std::vector<char> block;
+  block.reserve(blocksize);
+  uint64_t pos = header.data_p;
+  for (unsigned int i = 0; i < seqcount; i++)
+    {
+      char const * hdr = db_getheader(i);
+      char const * seq = db_getsequence(i);
+      block.insert(block.end(), hdr, hdr + db_getheaderlen(i) + 1);
+      block.insert(block.end(), seq, seq + db_getsequencelen(i));
+      block.push_back(0);
+      if ((block.size() >= blocksize) || (i + 1 == seqcount))
+        {
+          pos += largewrite(fd_output, block.data(), block.size(), pos);
+          block.clear();
+        }
+    }
+}
+
+auto udb_make() -> void
+{
+  if (! opt_output) {
+    fatal("UDB output file must be specified with --output");
+  }
+
+  int fd_output = 0;
+
+  fd_output = xopen_write(opt_output);
+  if (! fd_output)
+    {
+      fatal("Unable to open output file for writing");
+    }
+
+  db_read(opt_makeudb_usearch, 1);
+
+  if (opt_dbmask == MASK_DUST)
+    {
+      dust_all();
+    }
+  else if ((opt_dbmask == MASK_SOFT) && (opt_hardmask))
+    {
+      hardmask_all();
+    }
+
+  dbindex_prepare(1, opt_dbmask);
+  dbindex_addallsequences(opt_dbmask);
+
+  if (opt_udb_version == 2)
+    {
+      udb_write_v2(fd_output);
+    }
+  else
+    {
+      udb_write_v1(fd_output);
+    }
 
   if (close(fd_output) != 0)
     {
@@ -180,3 +180,22 @@ auto parse_userfields_arg(char * arg) -> int
       ++p;
     }
 }
+
+auto userfields_need_alignment() -> bool
+{
+  // true if one of the requested fields is built from the alignment
+  // string (cigar) of the hit, not only from its statistics
+
+  for (int c = 0; c < userfields_requested_count; c++)
+    {
+      char const * name = userfields_names[userfields_requested[c]];
+      if ((std::strcmp(name, "aln") == 0) or
+          (std::strcmp(name, "caln") == 0) or
+          (std::strcmp(name, "qrow") == 0) or
+          (std::strcmp(name, "trow") == 0))
+        {
+          return true;
+        }
+    }
+  return false;
+}
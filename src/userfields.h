@@ -62,3 +62,5 @@ extern int * userfields_requested;
 extern int userfields_requested_count;
 
 auto parse_userfields_arg(char * arg) -> int;
+
+auto userfields_need_alignment() -> bool;
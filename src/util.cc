@@ -213,6 +213,165 @@ auto hash_cityhash128(char * sequence, uint64_t length) -> uint128
 }
 
 
+namespace {
+
+  // scratch space for sequences that must be rewritten before hashing
+  thread_local std::vector<char> hash_buffer;
+
+
+  auto hash_buffer_reserve(uint64_t length) -> char *
+  {
+    if (hash_buffer.size() < length + 1)
+      {
+        hash_buffer.resize(length + 1);
+      }
+    return hash_buffer.data();
+  }
+
+
+  auto is_normalized(char const * sequence, uint64_t length) -> bool
+  {
+    /* Check eight symbols at a time that no symbol is lower case
+       (bit 0x20 set) and that none is a U. For the IUPAC symbols
+       accepted by the sequence parsers this is the same as checking
+       that normalization leaves the sequence unchanged. The remaining
+       symbols are checked against the normalization map. */
+
+    static constexpr uint64_t ones = 0x0101010101010101ULL;
+    static constexpr uint64_t highs = 0x8080808080808080ULL;
+    static constexpr uint64_t lower_case_bits = ones * 0x20U;
+    static constexpr uint64_t all_u = ones * static_cast<unsigned char>('U');
+
+    uint64_t i = 0;
+    for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t))
+      {
+        uint64_t word = 0;
+        std::memcpy(&word, std::next(sequence, i), sizeof(uint64_t));
+        auto const u_bytes = word ^ all_u;
+        if (((word & lower_case_bits) != 0) or
+            (((u_bytes - ones) & ~u_bytes & highs) != 0))
+          {
+            return false;
+          }
+      }
+    for (; i < length; ++i)
+      {
+        auto const symbol = static_cast<unsigned char>(*std::next(sequence, i));
+        if (chrmap_normalize_vector[symbol] != symbol)
+          {
+            return false;
+          }
+      }
+    return true;
+  }
+
+
+  auto normalized_view(char * sequence, uint64_t length) -> char const *
+  {
+    /* return the sequence itself when it is already normalized,
+       otherwise a normalized copy in the scratch buffer */
+    if (is_normalized(sequence, length))
+      {
+        return sequence;
+      }
+    auto * normalized = hash_buffer_reserve(length);
+    string_normalize(normalized, sequence, length);
+    return normalized;
+  }
+
+
+  auto normalized_complement(unsigned char symbol) -> unsigned char
+  {
+    static std::vector<unsigned char> const map = [] {
+      std::vector<unsigned char> normalized_complement_map(chrmap_normalize_vector.size());
+      for (auto i = 0UL; i < normalized_complement_map.size(); ++i)
+        {
+          normalized_complement_map[i] = chrmap_complement_vector[chrmap_normalize_vector[i]];
+        }
+      return normalized_complement_map;
+    }();
+    return map[symbol];
+  }
+
+
+  auto normalized_rc_view(char * sequence, uint64_t length) -> char const *
+  {
+    /* normalize and reverse complement in a single pass */
+    auto * rc_seq = hash_buffer_reserve(length);
+    for (uint64_t i = 0; i < length; ++i)
+      {
+        auto const symbol = static_cast<unsigned char>(*std::next(sequence, length - 1 - i));
+        *std::next(rc_seq, i) = static_cast<char>(normalized_complement(symbol));
+      }
+    *std::next(rc_seq, length) = '\0';
+    return rc_seq;
+  }
+
+
+  auto is_reverse_canonical(char * sequence, uint64_t length) -> bool
+  {
+    /* Is the normalized reverse complement lexicographically smaller
+       than the normalized sequence? Both are read from the outer ends
+       towards the middle, so unoriented reads usually differ after a
+       symbol or two. As complementing is its own inverse, the second
+       half mirrors the first and needs no comparison. */
+    for (uint64_t i = 0; i < length - i; ++i)
+      {
+        auto const forward =
+          chrmap_normalize_vector[static_cast<unsigned char>(*std::next(sequence, i))];
+        auto const reverse =
+          normalized_complement(static_cast<unsigned char>(*std::next(sequence, length - 1 - i)));
+        if (forward != reverse)
+          {
+            return reverse < forward;
+          }
+      }
+    return false;
+  }
+
+}  // end of anonymous namespace
+
+
+auto hash_cityhash64_normalized(char * sequence, uint64_t length) -> uint64_t
+{
+  return CityHash64(normalized_view(sequence, length), length);
+}
+
+
+auto hash_cityhash64_normalized_rc(char * sequence, uint64_t length) -> uint64_t
+{
+  return CityHash64(normalized_rc_view(sequence, length), length);
+}
+
+
+auto hash_cityhash128_normalized(char * sequence, uint64_t length) -> uint128
+{
+  return CityHash128(normalized_view(sequence, length), length);
+}
+
+
+auto hash_cityhash128_normalized_rc(char * sequence, uint64_t length) -> uint128
+{
+  return CityHash128(normalized_rc_view(sequence, length), length);
+}
+
+
+auto hash_cityhash64_canonical(char * sequence, uint64_t length) -> uint64_t
+{
+  return is_reverse_canonical(sequence, length) ?
+    hash_cityhash64_normalized_rc(sequence, length) :
+    hash_cityhash64_normalized(sequence, length);
+}
+
+
+auto hash_cityhash128_canonical(char * sequence, uint64_t length) -> uint128
+{
+  return is_reverse_canonical(sequence, length) ?
+    hash_cityhash128_normalized_rc(sequence, length) :
+    hash_cityhash128_normalized(sequence, length);
+}
+
+
 auto show_rusage() -> void
 {
 #ifdef SHOW_RUSAGE
@@ -84,6 +84,17 @@ auto xstrchrnul(char * str, int target) -> char *;
 auto xsprintf(char * * ret, const char * format, ...) -> int;
 auto hash_cityhash64(char * sequence, uint64_t length) -> uint64_t;
 auto hash_cityhash128(char * sequence, uint64_t length) -> uint128;
+/* hash the upper case, U to T normalized form of a sequence (or of its
+   reverse complement) without allocating, as string_normalize followed
+   by hash_cityhash64/128 would */
+auto hash_cityhash64_normalized(char * sequence, uint64_t length) -> uint64_t;
+auto hash_cityhash64_normalized_rc(char * sequence, uint64_t length) -> uint64_t;
+auto hash_cityhash128_normalized(char * sequence, uint64_t length) -> uint128;
+auto hash_cityhash128_normalized_rc(char * sequence, uint64_t length) -> uint128;
+/* the same for a sequence and its reverse complement: the hash of
+   whichever normalized orientation is lexicographically smaller */
+auto hash_cityhash64_canonical(char * sequence, uint64_t length) -> uint64_t;
+auto hash_cityhash128_canonical(char * sequence, uint64_t length) -> uint128;
 auto show_rusage() -> void;
 
 auto progress_init(const char * prompt, uint64_t size) -> void;
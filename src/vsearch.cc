@@ -60,6 +60,7 @@
 
 #include "vsearch.h"
 #include "allpairs.h"
+#include "checkpoint.h"
 #include "chimera.h"
 #include "cluster.h"
 #include "cut.h"
@@ -107,6 +108,7 @@
 bool opt_bzip2_decompress = false;
 bool opt_clusterout_id = false;
 bool opt_clusterout_sort = false;
+bool opt_compress_index = false;
 bool opt_eeout;
 bool opt_fasta_score;
 bool opt_fastq_allowmergestagger;
@@ -121,6 +123,7 @@ bool opt_relabel_keep;
 bool opt_relabel_md5;
 bool opt_relabel_self;
 bool opt_relabel_sha1;
+bool opt_resume;
 bool opt_samheader;
 bool opt_sff_clip;
 bool opt_sintax_random;
@@ -136,6 +139,7 @@ char * opt_biomout;
 char * opt_blast6out;
 char * opt_borderline;
 char * opt_centroids;
+char * opt_checkpoint;
 char * opt_chimeras;
 char * opt_chimeras_alnout;
 char * opt_chimeras_denovo;
@@ -272,6 +276,8 @@ int opt_mindiffs;
 int opt_slots;
 int opt_uchimeout5;
 int opt_usersort;
+int64_t opt_band;
+int64_t opt_checkpoint_interval;
 int64_t opt_dbmask;
 int64_t opt_fasta_width;
 int64_t opt_fastq_ascii;
@@ -294,6 +300,7 @@ int64_t opt_fastq_trunclen_keep;
 int64_t opt_fastq_truncqual;
 int64_t opt_fulldp;
 int64_t opt_hardmask;
+int64_t opt_hspw;
 int64_t opt_iddef;
 int64_t opt_idprefix;
 int64_t opt_idsuffix;
@@ -309,7 +316,9 @@ int64_t opt_maxseqlength;
 int64_t opt_maxsize;
 int64_t opt_maxsubs;
 int64_t opt_maxuniquesize;
+int64_t opt_memory_limit;
 int64_t opt_mincols;
+int64_t opt_minhsp;
 int64_t opt_minseqlength;
 int64_t opt_minsize;
 int64_t opt_mintsize;
@@ -332,7 +341,9 @@ int64_t opt_threads;
 int64_t opt_top_hits_only;
 int64_t opt_topn;
 int64_t opt_uc_allhits;
+int64_t opt_udb_version;
 int64_t opt_wordlength;
+int64_t opt_xdrop_nw;
 
 /* Other variables */
 
@@ -350,6 +361,7 @@ int64_t sse42_present = 0;
 int64_t popcnt_present = 0;
 int64_t avx_present = 0;
 int64_t avx2_present = 0;
+int64_t avx512bw_present = 0;
 
 static char progheader[80];  //   static constexpr auto max_line_length = std::size_t{80};
 static char * cmdline;
@@ -400,12 +412,26 @@ auto cpu_features_detect() -> void
       sse41_present  = (c >> 19U) & 1U;
       sse42_present  = (c >> 20U) & 1U;
       popcnt_present = (c >> 23U) & 1U;
-      avx_present    = (c >> 28U) & 1U;
+
+      /* the wider registers must also be saved by the operating system */
+      unsigned int xcr0 = 0;
+      if ((c >> 27U) & 1U)
+        {
+          unsigned int xcr0_high = 0;
+          __asm__ __volatile__ ("xgetbv"
+                                : "=a" (xcr0), "=d" (xcr0_high)
+                                : "c" (0));
+        }
+      bool const ymm_enabled = (xcr0 & 0x06U) == 0x06U;
+      bool const zmm_enabled = (xcr0 & 0xe6U) == 0xe6U;
+
+      avx_present    = ymm_enabled ? (c >> 28U) & 1U : 0;
 
       if (maxlevel >= 7)
         {
           cpuid(7, 0, a, b, c, d);
-          avx2_present = (b >>  5U) & 1U;
+          avx2_present = ymm_enabled ? (b >>  5U) & 1U : 0;
+          avx512bw_present = zmm_enabled ? (b >> 16U) & (b >> 30U) & 1U : 0;
         }
     }
 #else
@@ -465,6 +491,10 @@ auto cpu_features_show() -> void
     {
       fprintf(stderr, " avx2");
     }
+  if (avx512bw_present)
+    {
+      fprintf(stderr, " avx512bw");
+    }
   fprintf(stderr, "\n");
 }
 
@@ -781,10 +811,13 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
   opt_alignwidth = 80;
   opt_allpairs_global = nullptr;
   opt_alnout = nullptr;
+  opt_band = 0;
   opt_biomout = nullptr;
   opt_blast6out = nullptr;
   opt_borderline = nullptr;
   opt_centroids = nullptr;
+  opt_checkpoint = nullptr;
+  opt_checkpoint_interval = 300;
   opt_chimeras = nullptr;
   opt_chimeras_denovo = nullptr;
   opt_chimeras_diff_pct = 0.0;
@@ -877,6 +910,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
   opt_gap_open_target_right=2;
   opt_gzip_decompress = false;
   opt_hardmask = 0;
+  opt_hspw = 8;
   opt_id = -1.0;
   opt_iddef = 2;
   opt_idprefix = 0;
@@ -915,12 +949,14 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
   opt_maxsl = dbl_max;
   opt_maxsubs = int_max;
   opt_maxuniquesize = int64_max;
+  opt_memory_limit = 0;
   opt_mid = 0.0;
   opt_min_unmasked_pct = 0.0;
   opt_mincols = 0;
   opt_mindiffs = 3;
   opt_mindiv = 0.8;
   opt_minh = 0.28;
+  opt_minhsp = 16;
   opt_minqt = 0.0;
   opt_minseqlength = -1;
   opt_minsize = 0;
@@ -953,6 +989,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
   opt_relabel_md5 = false;
   opt_relabel_self = false;
   opt_relabel_sha1 = false;
+  opt_resume = false;
   opt_reverse = nullptr;
   opt_rightjust = 0;
   opt_rowlen = 64;
@@ -992,6 +1029,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
   opt_uchimeout = nullptr;
   opt_uchimeout5 = 0;
   opt_udb2fasta = nullptr;
+  opt_udb_version = 1;
   opt_udbinfo = nullptr;
   opt_udbstats = nullptr;
   opt_unoise_alpha = 2.0;
@@ -1000,6 +1038,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
   opt_usersort = 0;
   opt_weak_id = 10.0;
   opt_wordlength = 0;
+  opt_xdrop_nw = 0;
   opt_xee = false;
   opt_xlength = false;
   opt_xn = 8.0;
@@ -1020,6 +1059,8 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
       option_borderline,
       option_bzip2_decompress,
       option_centroids,
+      option_checkpoint,
+      option_checkpoint_interval,
       option_chimeras,
       option_chimeras_denovo,
       option_chimeras_diff_pct,
@@ -1033,6 +1074,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
       option_clusterout_id,
       option_clusterout_sort,
       option_clusters,
+      option_compress_index,
       option_cons_truncate,
       option_consout,
       option_cut,
@@ -1154,6 +1196,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
       option_maxsl,
       option_maxsubs,
       option_maxuniquesize,
+      option_memory_limit,
       option_mid,
       option_min_unmasked_pct,
       option_mincols,
@@ -1194,6 +1237,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
       option_relabel_self,
       option_relabel_sha1,
       option_rereplicate,
+      option_resume,
       option_reverse,
       option_rightjust,
       option_rowlen,
@@ -1236,6 +1280,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
       option_uchimeout,
       option_uchimeout5,
       option_udb2fasta,
+      option_udb_version,
       option_udbinfo,
       option_udbstats,
       option_unoise_alpha,
@@ -1267,6 +1312,8 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
       {"borderline",            required_argument, nullptr, 0 },
       {"bzip2_decompress",      no_argument,       nullptr, 0 },
       {"centroids",             required_argument, nullptr, 0 },
+      {"checkpoint",            required_argument, nullptr, 0 },
+      {"checkpoint_interval",   required_argument, nullptr, 0 },
       {"chimeras",              required_argument, nullptr, 0 },
       {"chimeras_denovo",       required_argument, nullptr, 0 },
       {"chimeras_diff_pct",     required_argument, nullptr, 0 },
@@ -1280,6 +1327,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
       {"clusterout_id",         no_argument,       nullptr, 0 },
       {"clusterout_sort",       no_argument,       nullptr, 0 },
       {"clusters",              required_argument, nullptr, 0 },
+      {"compress_index",        no_argument,       nullptr, 0 },
       {"cons_truncate",         no_argument,       nullptr, 0 },
       {"consout",               required_argument, nullptr, 0 },
       {"cut",                   required_argument, nullptr, 0 },
@@ -1401,6 +1449,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
       {"maxsl",                 required_argument, nullptr, 0 },
       {"maxsubs",               required_argument, nullptr, 0 },
       {"maxuniquesize",         required_argument, nullptr, 0 },
+      {"memory_limit",          required_argument, nullptr, 0 },
       {"mid",                   required_argument, nullptr, 0 },
       {"min_unmasked_pct",      required_argument, nullptr, 0 },
       {"mincols",               required_argument, nullptr, 0 },
@@ -1441,6 +1490,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
       {"relabel_self",          no_argument,       nullptr, 0 },
       {"relabel_sha1",          no_argument,       nullptr, 0 },
       {"rereplicate",           required_argument, nullptr, 0 },
+      {"resume",                no_argument,       nullptr, 0 },
       {"reverse",               required_argument, nullptr, 0 },
       {"rightjust",             no_argument,       nullptr, 0 },
       {"rowlen",                required_argument, nullptr, 0 },
@@ -1483,6 +1533,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
       {"uchimeout",             required_argument, nullptr, 0 },
       {"uchimeout5",            no_argument,       nullptr, 0 },
       {"udb2fasta",             required_argument, nullptr, 0 },
+      {"udb_version",           required_argument, nullptr, 0 },
       {"udbinfo",               required_argument, nullptr, 0 },
       {"udbstats",              required_argument, nullptr, 0 },
       {"unoise_alpha",          required_argument, nullptr, 0 },
@@ -1515,6 +1566,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
       if (options_index < options_count)
         {
           options_selected[options_index] = true;
+          checkpoint_option(long_options[options_index].name, optarg);
         }
 
       switch(options_index)
@@ -2061,6 +2113,10 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
           opt_clusterout_sort = true;
           break;
 
+        case option_compress_index:
+          opt_compress_index = true;
+          break;
+
         case option_borderline:
           opt_borderline = optarg;
           break;
@@ -2290,23 +2346,19 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
           break;
 
         case option_xdrop_nw:
-          /* xdrop_nw ignored */
-          fprintf(stderr, "WARNING: Option --xdrop_nw is ignored\n");
+          opt_xdrop_nw = args_getlong(optarg);
           break;
 
         case option_minhsp:
-          /* minhsp ignored */
-          fprintf(stderr, "WARNING: Option --minhsp is ignored\n");
+          opt_minhsp = args_getlong(optarg);
           break;
 
         case option_band:
-          /* band ignored */
-          fprintf(stderr, "WARNING: Option --band is ignored\n");
+          opt_band = args_getlong(optarg);
           break;
 
         case option_hspw:
-          /* hspw ignored */
-          fprintf(stderr, "WARNING: Option --hspw is ignored\n");
+          opt_hspw = args_getlong(optarg);
           break;
 
         case option_gzip_decompress:
@@ -2373,6 +2425,10 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
           opt_udb2fasta = optarg;
           break;
 
+        case option_udb_version:
+          opt_udb_version = args_getlong(optarg);
+          break;
+
         case option_udbinfo:
           opt_udbinfo = optarg;
           break;
@@ -2595,6 +2651,23 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
           opt_sintax_random = true;
           break;
 
+        case option_checkpoint:
+          opt_checkpoint = optarg;
+          break;
+
+        case option_checkpoint_interval:
+          opt_checkpoint_interval = args_getlong(optarg);
+          break;
+
+        case option_resume:
+          opt_resume = true;
+          break;
+
+        case option_memory_limit:
+          opt_memory_limit = args_getlong(optarg);
+          parameters.opt_memory_limit = args_getlong(optarg);
+          break;
+
         default:
           fatal("Internal error in option parsing");
         }
@@ -2675,7 +2748,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
     The first line is the command and the lines below are the valid options.
   */
 
-  const int valid_options[][98] =
+  const int valid_options[][101] =
     {
       {
         option_allpairs_global,
@@ -2767,6 +2840,8 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
         option_abskew,
         option_alignwidth,
         option_alnout,
+        option_checkpoint,
+        option_checkpoint_interval,
         option_chimeras,
         option_chimeras_diff_pct,
         option_chimeras_length_min,
@@ -2792,6 +2867,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
         option_relabel_md5,
         option_relabel_self,
         option_relabel_sha1,
+        option_resume,
         option_sample,
         option_sizein,
         option_sizeout,
@@ -2809,11 +2885,14 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
         option_blast6out,
         option_bzip2_decompress,
         option_centroids,
+        option_checkpoint,
+        option_checkpoint_interval,
         option_clusterout_id,
         option_clusterout_sort,
         option_clusters,
         option_cons_truncate,
         option_consout,
+        option_db,
         option_fasta_width,
         option_fastapairs,
         option_fulldp,
@@ -2872,6 +2951,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
         option_relabel_md5,
         option_relabel_self,
         option_relabel_sha1,
+        option_resume,
         option_rightjust,
         option_rowlen,
         option_samheader,
@@ -2906,11 +2986,14 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
         option_blast6out,
         option_bzip2_decompress,
         option_centroids,
+        option_checkpoint,
+        option_checkpoint_interval,
         option_clusterout_id,
         option_clusterout_sort,
         option_clusters,
         option_cons_truncate,
         option_consout,
+        option_db,
         option_fasta_width,
         option_fastapairs,
         option_fulldp,
@@ -2969,6 +3052,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
         option_relabel_md5,
         option_relabel_self,
         option_relabel_sha1,
+        option_resume,
         option_rightjust,
         option_rowlen,
         option_samheader,
@@ -3003,11 +3087,14 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
         option_blast6out,
         option_bzip2_decompress,
         option_centroids,
+        option_checkpoint,
+        option_checkpoint_interval,
         option_clusterout_id,
         option_clusterout_sort,
         option_clusters,
         option_cons_truncate,
         option_consout,
+        option_db,
         option_fasta_width,
         option_fastapairs,
         option_fulldp,
@@ -3066,6 +3153,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
         option_relabel_md5,
         option_relabel_self,
         option_relabel_sha1,
+        option_resume,
         option_rightjust,
         option_rowlen,
         option_samheader,
@@ -3101,6 +3189,8 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
         option_blast6out,
         option_bzip2_decompress,
         option_centroids,
+        option_checkpoint,
+        option_checkpoint_interval,
         option_clusterout_id,
         option_clusterout_sort,
         option_clusters,
@@ -3165,6 +3255,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
         option_relabel_md5,
         option_relabel_self,
         option_relabel_sha1,
+        option_resume,
         option_rightjust,
         option_rowlen,
         option_samheader,
@@ -3229,6 +3320,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
         option_log,
         option_maxseqlength,
         option_maxuniquesize,
+        option_memory_limit,
         option_minseqlength,
         option_minuniquesize,
         option_no_progress,
@@ -3261,6 +3353,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
         option_log,
         option_maxseqlength,
         option_maxuniquesize,
+        option_memory_limit,
         option_minseqlength,
         option_minuniquesize,
         option_no_progress,
@@ -3853,6 +3946,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
         option_log,
         option_maxseqlength,
         option_maxuniquesize,
+        option_memory_limit,
         option_minseqlength,
         option_minuniquesize,
         option_no_progress,
@@ -3901,6 +3995,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
         option_output,
         option_quiet,
         option_threads,
+        option_udb_version,
         option_wordlength,
         -1 },
 
@@ -4114,6 +4209,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
 
       { option_sintax,
         option_bzip2_decompress,
+        option_compress_index,
         option_db,
         option_dbmask,
         option_fastq_ascii,
@@ -4204,6 +4300,8 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
         option_abskew,
         option_alignwidth,
         option_borderline,
+        option_checkpoint,
+        option_checkpoint_interval,
         option_chimeras,
         option_dn,
         option_fasta_score,
@@ -4231,6 +4329,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
         option_relabel_md5,
         option_relabel_self,
         option_relabel_sha1,
+        option_resume,
         option_sample,
         option_sizein,
         option_sizeout,
@@ -4248,6 +4347,8 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
         option_abskew,
         option_alignwidth,
         option_borderline,
+        option_checkpoint,
+        option_checkpoint_interval,
         option_chimeras,
         option_dn,
         option_fasta_score,
@@ -4275,6 +4376,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
         option_relabel_md5,
         option_relabel_self,
         option_relabel_sha1,
+        option_resume,
         option_sample,
         option_sizein,
         option_sizeout,
@@ -4292,6 +4394,8 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
         option_abskew,
         option_alignwidth,
         option_borderline,
+        option_checkpoint,
+        option_checkpoint_interval,
         option_chimeras,
         option_dn,
         option_fasta_score,
@@ -4319,6 +4423,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
         option_relabel_md5,
         option_relabel_self,
         option_relabel_sha1,
+        option_resume,
         option_sample,
         option_sizein,
         option_sizeout,
@@ -4337,6 +4442,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
         option_alignwidth,
         option_borderline,
         option_chimeras,
+        option_compress_index,
         option_db,
         option_dbmask,
         option_dn,
@@ -4422,6 +4528,7 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
         option_biomout,
         option_blast6out,
         option_bzip2_decompress,
+        option_compress_index,
         option_db,
         option_dbmask,
         option_dbmatched,
@@ -4621,8 +4728,11 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
     }
 
   if (opt_allpairs_global or opt_cluster_fast or opt_cluster_size or
-      opt_cluster_smallmem or opt_cluster_unoise or opt_fastq_mergepairs or
-      opt_fastx_mask or opt_maskfasta or opt_search_exact or opt_sintax or
+      opt_cluster_smallmem or opt_cluster_unoise or
+      parameters.opt_derep_fulllength or parameters.opt_derep_id or
+      opt_fastq_mergepairs or opt_fastx_mask or
+      parameters.opt_fastx_uniques or opt_makeudb_usearch or
+      opt_maskfasta or opt_search_exact or opt_sintax or
       opt_uchime_ref or opt_usearch_global)
     {
       if (parameters.opt_threads == 0)
@@ -4695,6 +4805,46 @@ auto args_init(int argc, char ** argv, struct Parameters & parameters) -> void
       fatal("The argument to --wordlength must be in the range 3 to 15");
     }
 
+  if (opt_band < 0)
+    {
+      fatal("The argument to --band cannot be negative");
+    }
+
+  if ((opt_hspw < 3) or (opt_hspw > 15))
+    {
+      fatal("The argument to --hspw must be in the range 3 to 15");
+    }
+
+  if (opt_minhsp < 1)
+    {
+      fatal("The argument to --minhsp must be at least 1");
+    }
+
+  if (opt_xdrop_nw < 0)
+    {
+      fatal("The argument to --xdrop_nw cannot be negative");
+    }
+
+  if (opt_checkpoint_interval < 0)
+    {
+      fatal("The argument to --checkpoint_interval cannot be negative");
+    }
+
+  if (opt_resume and (not opt_checkpoint))
+    {
+      fatal("Option --resume requires --checkpoint");
+    }
+
+  if (opt_memory_limit < 0)
+    {
+      fatal("The argument to --memory_limit cannot be negative");
+    }
+
+  if ((opt_udb_version < 1) or (opt_udb_version > 2))
+    {
+      fatal("The argument to --udb_version must be 1 or 2");
+    }
+
   if ((opt_iddef < 0) or (opt_iddef > 4))
     {
       fatal("The argument to --iddef must in the range 0 to 4");
@@ -5073,10 +5223,13 @@ auto cmd_help(struct Parameters const & parameters) -> void {
           "  --chimeras_denovo FILENAME  detect chimeras de novo in long exact sequences\n"
           " Parameters\n"
           "  --abskew REAL               minimum abundance ratio (1.0)\n"
+          "  --checkpoint FILENAME       save progress to file to allow resuming the run\n"
+          "  --checkpoint_interval INT   seconds between checkpoints (300)\n"
           "  --chimeras_diff_pct         mismatch %% allowed in each chimeric region (0.0)\n"
           "  --chimeras_length_min       minimum length of each chimeric region (10)\n"
           "  --chimeras_parents_max      maximum number of parent sequences (3)\n"
           "  --chimeras_parts            number of parts to divide sequences (length/100)\n"
+          "  --resume                    resume the run saved in the checkpoint file\n"
           "  --sizein                    propagate abundance annotation from input\n"
           " Output\n"
           "  --alignwidth INT            width of alignments in alignment output file (60)\n"
@@ -5098,13 +5251,17 @@ auto cmd_help(struct Parameters const & parameters) -> void {
           "  --uchime3_denovo FILENAME   detect chimeras de novo in denoised amplicons\n"
           "  --uchime_ref FILENAME       detect chimeras using a reference database\n"
           " Data\n"
+          "  --compress_index            compress database k-mer index to save memory\n"
           "  --db FILENAME               reference database for --uchime_ref\n"
           " Parameters\n"
           "  --abskew REAL               minimum abundance ratio (2.0, 16.0 for uchime3)\n"
+          "  --checkpoint FILENAME       save progress to file to allow resuming the run\n"
+          "  --checkpoint_interval INT   seconds between checkpoints (300)\n"
           "  --dn REAL                   'no' vote pseudo-count (1.4)\n"
           "  --mindiffs INT              minimum number of differences in segment (3) *\n"
           "  --mindiv REAL               minimum divergence from closest parent (0.8) *\n"
           "  --minh REAL                 minimum score (0.28) * ignored in uchime2/3\n"
+          "  --resume                    resume the run saved in the checkpoint file\n"
           "  --sizein                    propagate abundance annotation from input\n"
           "  --self                      exclude identical labels for --uchime_ref\n"
           "  --selfid                    exclude identical sequences for --uchime_ref\n"
@@ -5132,10 +5289,14 @@ auto cmd_help(struct Parameters const & parameters) -> void {
           "  --cluster_smallmem FILENAME cluster already sorted sequences (see -usersort)\n"
           "  --cluster_unoise FILENAME   denoise Illumina amplicon reads\n"
           " Parameters (most searching options also apply)\n"
+          "  --checkpoint FILENAME       save progress to file to allow resuming the run\n"
+          "  --checkpoint_interval INT   seconds between checkpoints (300)\n"
           "  --cons_truncate             do not ignore terminal gaps in MSA for consensus\n"
+          "  --db FILENAME               existing centroids to extend, FASTA or UDB\n"
           "  --id REAL                   reject if identity lower, accepted values: 0-1.0\n"
           "  --iddef INT                 id definition, 0-4=CD-HIT,all,int,MBL,BLAST (2)\n"
           "  --qmask none|dust|soft      mask seqs with dust, soft or no method (dust)\n"
+          "  --resume                    resume the run saved in the checkpoint file\n"
           "  --sizein                    propagate abundance annotation from input\n"
           "  --strand plus|both          cluster using plus or both strands (plus)\n"
           "  --usersort                  indicate sequences not pre-sorted by length\n"
@@ -5181,6 +5342,7 @@ auto cmd_help(struct Parameters const & parameters) -> void {
           "  --rereplicate FILENAME      rereplicate sequences in the given FASTA file\n"
           " Parameters\n"
           "  --maxuniquesize INT         maximum abundance for output from dereplication\n"
+          "  --memory_limit INT          MB of memory, dereplicate larger input on disk\n"
           "  --minuniquesize INT         minimum abundance for output from dereplication\n"
           "  --sizein                    propagate abundance annotation from input\n"
           "  --strand plus|both          dereplicate plus or both strands (plus)\n"
@@ -5352,6 +5514,7 @@ auto cmd_help(struct Parameters const & parameters) -> void {
           "  --search_exact FILENAME     filename of queries for exact match search\n"
           "  --usearch_global FILENAME   filename of queries for global alignment search\n"
           " Data\n"
+          "  --compress_index            compress database k-mer index to save memory\n"
           "  --db FILENAME               name of UDB or FASTA database for search\n"
           " Parameters\n"
           "  --dbmask none|dust|soft     mask db with dust, soft or no method (dust)\n"
@@ -5466,6 +5629,7 @@ auto cmd_help(struct Parameters const & parameters) -> void {
           "Taxonomic classification\n"
           "  --sintax FILENAME           classify sequences in given FASTA/FASTQ file\n"
           " Parameters\n"
+          "  --compress_index            compress database k-mer index to save memory\n"
           "  --db FILENAME               taxonomic reference db in given FASTA or UDB file\n"
           "  --sintax_cutoff REAL        confidence value cutoff level (0.0)\n"
           "  --sintax_random             use random sequence, not shortest, if equal match\n"
@@ -5520,6 +5684,7 @@ auto cmd_help(struct Parameters const & parameters) -> void {
           " Parameters\n"
           "  --dbmask none|dust|soft     mask db with dust, soft or no method (dust)\n"
           "  --hardmask                  mask by replacing with N instead of lower case\n"
+          "  --udb_version INT           UDB file format, 2 is memory-mappable (1)\n"
           "  --wordlength INT            length of words for database index 3-15 (8)\n"
           " Output\n"
           "  --output FILENAME           UDB or FASTA output file\n"
@@ -228,6 +228,7 @@
 extern bool opt_bzip2_decompress;
 extern bool opt_clusterout_id;
 extern bool opt_clusterout_sort;
+extern bool opt_compress_index;
 extern bool opt_eeout;
 extern bool opt_fasta_score;
 extern bool opt_fastq_allowmergestagger;
@@ -242,6 +243,7 @@ extern bool opt_relabel_keep;
 extern bool opt_relabel_md5;
 extern bool opt_relabel_self;
 extern bool opt_relabel_sha1;
+extern bool opt_resume;
 extern bool opt_samheader;
 extern bool opt_sff_clip;
 extern bool opt_sintax_random;
@@ -257,6 +259,7 @@ extern char * opt_biomout;
 extern char * opt_blast6out;
 extern char * opt_borderline;
 extern char * opt_centroids;
+extern char * opt_checkpoint;
 extern char * opt_chimeras;
 extern char * opt_chimeras_denovo;
 extern char * opt_cluster_fast;
@@ -392,6 +395,8 @@ extern int opt_mindiffs;
 extern int opt_slots;
 extern int opt_uchimeout5;
 extern int opt_usersort;
+extern int64_t opt_band;
+extern int64_t opt_checkpoint_interval;
 extern int64_t opt_dbmask;
 extern int64_t opt_fasta_width;
 extern int64_t opt_fastq_ascii;
@@ -414,6 +419,7 @@ extern int64_t opt_fastq_trunclen_keep;
 extern int64_t opt_fastq_truncqual;
 extern int64_t opt_fulldp;
 extern int64_t opt_hardmask;
+extern int64_t opt_hspw;
 extern int64_t opt_iddef;
 extern int64_t opt_idprefix;
 extern int64_t opt_idsuffix;
@@ -429,7 +435,9 @@ extern int64_t opt_maxseqlength;
 extern int64_t opt_maxsize;
 extern int64_t opt_maxsubs;
 extern int64_t opt_maxuniquesize;
+extern int64_t opt_memory_limit;
 extern int64_t opt_mincols;
+extern int64_t opt_minhsp;
 extern int64_t opt_minseqlength;
 extern int64_t opt_minsize;
 extern int64_t opt_mintsize;
@@ -452,7 +460,9 @@ extern int64_t opt_threads;
 extern int64_t opt_top_hits_only;
 extern int64_t opt_topn;
 extern int64_t opt_uc_allhits;
+extern int64_t opt_udb_version;
 extern int64_t opt_wordlength;
+extern int64_t opt_xdrop_nw;
 
 extern int64_t altivec_present;
 extern int64_t mmx_present;
@@ -465,6 +475,7 @@ extern int64_t sse42_present;
 extern int64_t popcnt_present;
 extern int64_t avx_present;
 extern int64_t avx2_present;
+extern int64_t avx512bw_present;
 
 extern std::FILE * fp_log;
 
@@ -521,6 +532,7 @@ struct Parameters {
   int64_t opt_maxseqlength = default_maxseqlength;
   int64_t opt_maxsize = int64_max;
   int64_t opt_maxuniquesize = int64_max;
+  int64_t opt_memory_limit = 0;
   int64_t opt_minseqlength = -1;
   int64_t opt_minsize = 0;
   int64_t opt_minuniquesize = 1;